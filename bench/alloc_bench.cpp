@@ -0,0 +1,103 @@
+/*
+** Counts the heap allocations done per query by the fuzzy engine.
+** usage : alloc_bench [words] [queries] [fuzzy threshold]    (run from the repository root, it needs charmap.cm)
+*/
+#include "trie.hpp"
+#include "workload.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<unsigned long> g_allocations(0);
+
+// kept out of line, otherwise GCC sees free() on memory from the inlined operator new and reports a mismatch
+__attribute__((noinline)) void* operator new(std::size_t size)
+{
+  g_allocations++;
+  if (void* memory = std::malloc(size ? size : 1)) {
+    return memory;
+  }
+  throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* memory) noexcept
+{
+  std::free(memory);
+}
+
+__attribute__((noinline)) void operator delete(void* memory, std::size_t) noexcept
+{
+  std::free(memory);
+}
+
+template <typename Trie, typename Query>
+static void measure(const std::string& name, Trie& trie, std::vector<std::string>& queries, Query query)
+{
+  for (auto& keyword : queries) { // warm up the per-thread buffers
+    query(trie, keyword);
+  }
+
+  unsigned long before = g_allocations;
+  for (auto& keyword : queries) {
+    query(trie, keyword);
+  }
+  unsigned long allocations = g_allocations - before;
+
+  std::cout << name << " allocations_per_query=" << double(allocations) / queries.size() << '\n';
+}
+
+template <typename Trie>
+static void run(const std::string& layout, int words, int queryCount, int threshold)
+{
+  bench::Workload_t workload(42);
+  std::vector<std::string> dictionary = workload.dictionary(words);
+  std::vector<std::string> queries = workload.typoQueries(dictionary, queryCount, threshold);
+
+  Trie trie;
+  for (auto& word : dictionary) {
+    trie.putIndividualWord(word, word);
+  }
+  trie.setFuzzyLimitThreshold(threshold);
+  trie.buildActiveNodeSet(false);
+
+  std::cout << "# layout=" << layout << " words=" << words << " queries=" << queryCount << " threshold=" << threshold << '\n';
+
+  measure("searchSimilarKeyword", trie, queries, [](Trie& t, std::string keyword) { t.searchSimilarKeyword(keyword); });
+  measure("searchSimilarKeywordTopK(5)", trie, queries, [](Trie& t, std::string keyword) { t.searchSimilarKeywordTopK(keyword, 5); });
+  measure("autocompleteTopK(10)", trie, queries, [](Trie& t, std::string keyword) { t.autocompleteTopK(keyword, 10); });
+  measure("searchKeyword(views)", trie, queries, [](Trie& t, const std::string& keyword) {
+    static thread_local std::vector<trie::PayloadView_t> values;
+    t.searchKeyword(keyword, values);
+  });
+  measure("searchSimilarKeywordTopK(5, views)", trie, queries, [](Trie& t, const std::string& keyword) {
+    static thread_local std::vector<trie::TrieResponseView_t> responses;
+    t.searchSimilarKeywordTopK(keyword, 5, responses);
+  });
+  measure("autocompleteTopK(10, views)", trie, queries, [](Trie& t, const std::string& keyword) {
+    static thread_local std::vector<trie::TrieResponseView_t> responses;
+    t.autocompleteTopK(keyword, 10, responses);
+  });
+  measure("autocompleteRanked(10, views)", trie, queries, [](Trie& t, const std::string& keyword) {
+    static thread_local std::vector<trie::TrieResponseView_t> responses;
+    t.autocompleteRanked(keyword, 10, responses);
+  });
+  measure("forEachSimilarKeyword", trie, queries, [](Trie& t, const std::string& keyword) {
+    std::size_t found = 0;
+    t.forEachSimilarKeyword(keyword, [&](trie::PayloadView_t, int, unsigned int) { found++; });
+  });
+  measure("forEachCompletion(10)", trie, queries, [](Trie& t, const std::string& keyword) {
+    std::size_t found = 0;
+    t.forEachCompletion(keyword, 10, [&](trie::PayloadView_t, int, unsigned int) { found++; });
+  });
+}
+
+int main(int argc, char** argv)
+{
+  int words = argc > 1 ? std::atoi(argv[1]) : 100000;
+  int queries = argc > 2 ? std::atoi(argv[2]) : 2000;
+  int threshold = argc > 3 ? std::atoi(argv[3]) : 1;
+
+  run<trie::Trie_t>("pointer", words, queries, threshold);
+  run<trie::ArenaTrie_t>("arena", words, queries, threshold);
+  run<trie::RadixTrie_t>("radix", words, queries, threshold);
+}
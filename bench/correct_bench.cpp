@@ -0,0 +1,87 @@
+/*
+** Throughput of the document correction over a synthetic text, for every pool size up to `threads`.
+** usage : correct_bench [words] [megabytes] [fuzzy threshold] [threads] [chunk KiB] [engine]    (run from the repository
+** root, it needs charmap.cm and the stopwords)
+** The engine of the fuzzy lookups is `deletions` (default, the index being built first), `automaton` or `nodes`.
+** Every run is checked against a single-chunk correction of the whole text, so a reordered or lost chunk fails the bench.
+*/
+#include "corrector.hpp"
+#include "workload.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+static const char* engineName(trie::FuzzyEngine_t engine)
+{
+  return engine == trie::kEngineDeletions ? "deletions" : engine == trie::kEngineAutomaton ? "automaton" : "nodes";
+}
+
+template <typename Storage>
+static int run(const std::string& layout, std::size_t words, std::size_t megabytes, int threshold, std::size_t threads, std::size_t chunkKb, trie::FuzzyEngine_t engine)
+{
+  bench::Workload_t workload(42);
+  std::vector<std::string> dictionary = workload.dictionary(words);
+  std::vector<std::string> stopwords = { "the", "and", "that", "with", "para", "como", "mais", "uma" };
+  std::string text = workload.text(dictionary, stopwords, megabytes << 20);
+
+  trie::BasicTrie_t<Storage> trie;
+  for (auto& word : dictionary) {
+    trie.putIndividualWord(word, word);
+  }
+  trie.setFuzzyLimitThreshold(threshold);
+  trie.buildActiveNodeSet(false);
+  if (engine == trie::kEngineDeletions) {
+    trie.buildDeletionIndex(threshold);
+  }
+
+  trie::ThreadPool_t single(1);
+  trie::BasicCorrector_t<Storage> reference(trie, single);
+  reference.setFuzzyEngine(engine);
+  std::string expected = reference.correctText(text);
+
+  for (std::size_t count = 1; count <= threads; count *= 2) {
+    trie::ThreadPool_t pool(count);
+    trie::BasicCorrector_t<Storage> corrector(trie, pool);
+    corrector.setChunkSize(chunkKb << 10);
+    corrector.setFuzzyEngine(engine);
+
+    std::istringstream input(text);
+    std::ostringstream output;
+    trie::CorrectionStats_t stats = corrector.correct(input, output);
+
+    std::cout << "layout=" << layout << " engine=" << engineName(engine) << " words=" << words << " threshold=" << threshold << " threads=" << count << " chunk_kb=" << chunkKb << ' ';
+    stats.print(std::cout);
+    if (output.str() != expected) {
+      std::cerr << "correct_bench: the chunked output differs from the single-chunk one\n";
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char** argv)
+{
+  std::size_t words = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+  std::size_t megabytes = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 8;
+  int threshold = argc > 3 ? std::atoi(argv[3]) : 1;
+  std::size_t threads = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : std::max(std::thread::hardware_concurrency(), 1u);
+  std::size_t chunkKb = argc > 5 ? std::strtoull(argv[5], nullptr, 10) : 1024;
+  std::string engineArgument = argc > 6 ? argv[6] : "deletions";
+  trie::FuzzyEngine_t engine = trie::kEngineDeletions;
+  if (engineArgument == "automaton") {
+    engine = trie::kEngineAutomaton;
+  } else if (engineArgument == "nodes") {
+    engine = trie::kEngineActiveNodes;
+  } else if (engineArgument != "deletions") {
+    std::cerr << "correct_bench: unknown engine '" << engineArgument << "'\n";
+    return 1;
+  }
+
+  if (words == 0 || megabytes == 0 || threads == 0 || chunkKb == 0) {
+    std::cerr << "correct_bench: the arguments must be positive\n";
+    return 1;
+  }
+
+  return run<trie::PointerNodeStore_t>("pointer", words, megabytes, threshold, threads, chunkKb, engine)
+      || run<trie::ArenaNodeStore_t>("arena", words, megabytes, threshold, threads, chunkKb, engine);
+}
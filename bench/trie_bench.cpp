@@ -0,0 +1,497 @@
+/*
+** Throughput and latency of every operation of the trie over a synthetic dictionary and typo'd queries, one JSON object per
+** line on the standard output :
+**   {"op":"similar","layout":"arena","words":100000,"threshold":2,...,"p50_ns":..,"p99_ns":..,"p999_ns":..,"peak_rss_kb":..}
+** The workload only depends on the seed, so two builds can be compared line by line. The peak RSS is the one of the whole
+** process up to that record, run one dictionary size per process (as `make bench_run` does) to get it per size.
+**
+** usage : trie_bench [--words 10000,100000] [--queries 10000] [--thresholds 1,2,3] [--limit 10] [--layouts pointer,arena,radix,frozen]
+**                    [--ops put,update,build,exact,similar,autocomplete] [--seed 42] [--stats 0] [--cache 0] [--skew 0]
+**                    [--engines trie,deletions,automaton] [--prefix-table 0]
+** `--stats 1` attaches a stats collector to the trie (to measure its cost) and dumps it on the error output after each run,
+** the records getting the active and visited nodes per query (the layouts only differ by how fast they go through them).
+** `--cache MB` attaches a result cache of that size and dumps its counters the same way. `--skew 1` redraws the fuzzy queries
+** from their pool on a skewed rank, so some of them repeat as on real traffic (the warm up runs before, the cache starts warm).
+** `--engines` lists the engines measured on `similar` : the active node sets of the trie, the deletion index (built for
+** each threshold, the time of the build being the `index` op, its memory the `index_bytes` of the records after it) and
+** the Levenshtein automaton.
+** `--prefix-table MB` builds a prefix table of that size for each threshold (see `BasicTrie_t::buildPrefixTable`), its
+** log being a draw of typo'd queries apart from the measured ones : the build is the `prefixes` op, its memory the
+** `index_bytes` of the records after it.
+** `update` replaces the value of a word over and over (twice the dictionary size, at least `--queries` times) and fails
+** when the bytes of the values grew by more than a quarter, the replaced values having to be reclaimed.
+** The `frozen` layout is the arena trie compiled by `freeze` once the words are in, the compilation being the `freeze` op.
+** When the arena layout runs too, every query record of the frozen one is followed by a `compare` record putting its
+** memory (`structure_bytes` being the nodes and edges only, without the values) and latencies next to the arena ones.
+** `--limit 0` measures the unbounded `autocomplete` instead of `autocompleteTopK`. Run it from the repository root, it needs charmap.cm.
+*/
+#include "result_cache.hpp"
+#include "trie.hpp"
+#include "workload.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <sys/resource.h>
+
+struct Options_t {
+  std::vector<std::size_t> words;
+  std::size_t queries;
+  std::vector<int> thresholds;
+  std::size_t limit;
+  std::set<std::string> layouts;
+  std::set<std::string> ops;
+  uint64_t seed;
+  bool stats;
+  std::size_t cacheMegabytes;
+  bool skew;
+  std::vector<std::string> engines;
+  std::size_t prefixMegabytes;
+
+  Options_t()
+  : words({ 10000, 100000 })
+  , queries(10000)
+  , thresholds({ 1, 2, 3 })
+  , limit(10)
+  , layouts({ "pointer", "arena" })
+  , ops({ "put", "update", "build", "exact", "similar", "autocomplete" })
+  , seed(42)
+  , stats(false)
+  , cacheMegabytes(0)
+  , skew(false)
+  , engines({ "trie" })
+  , prefixMegabytes(0)
+  {
+  }
+};
+
+// parameters of a measure, written on every record
+struct Record_t {
+  std::string op;
+  std::string layout;
+  std::size_t words;
+  int threshold; // -1 when the operation does not depend on it
+  std::size_t limit;
+  uint64_t seed;
+  bool stats;
+  std::size_t cacheMegabytes;
+  bool skew;
+  std::string engine; // what answers the fuzzy queries
+  std::size_t prefixMegabytes;
+};
+
+static std::vector<std::string> splitList(const std::string& list)
+{
+  std::vector<std::string> items;
+  std::istringstream input(list);
+  std::string item;
+  while (std::getline(input, item, ',')) {
+    if (!item.empty()) {
+      items.push_back(item);
+    }
+  }
+  return items;
+}
+
+static Options_t parseOptions(int argc, char** argv)
+{
+  Options_t options;
+
+  for (int i = 1; i < argc; i++) {
+    std::string name = argv[i];
+    if (i + 1 >= argc) {
+      throw std::runtime_error("missing value for '" + name + "'");
+    }
+    std::string value = argv[++i];
+
+    if (name == "--words") {
+      options.words.clear();
+      for (auto& item : splitList(value)) {
+        options.words.push_back(std::strtoull(item.c_str(), nullptr, 10));
+      }
+    } else if (name == "--queries") {
+      options.queries = std::strtoull(value.c_str(), nullptr, 10);
+    } else if (name == "--thresholds") {
+      options.thresholds.clear();
+      for (auto& item : splitList(value)) {
+        options.thresholds.push_back(std::atoi(item.c_str()));
+      }
+    } else if (name == "--limit") {
+      options.limit = std::strtoull(value.c_str(), nullptr, 10);
+    } else if (name == "--layouts") {
+      auto layouts = splitList(value);
+      options.layouts = std::set<std::string>(layouts.begin(), layouts.end());
+    } else if (name == "--ops") {
+      auto ops = splitList(value);
+      options.ops = std::set<std::string>(ops.begin(), ops.end());
+    } else if (name == "--seed") {
+      options.seed = std::strtoull(value.c_str(), nullptr, 10);
+    } else if (name == "--stats") {
+      options.stats = std::atoi(value.c_str()) != 0;
+    } else if (name == "--cache") {
+      options.cacheMegabytes = std::strtoull(value.c_str(), nullptr, 10);
+    } else if (name == "--skew") {
+      options.skew = std::atoi(value.c_str()) != 0;
+    } else if (name == "--engines") {
+      options.engines = splitList(value);
+      for (auto& engine : options.engines) {
+        if (engine != "trie" && engine != "deletions" && engine != "automaton") {
+          throw std::runtime_error("unknown engine '" + engine + "'");
+        }
+      }
+    } else if (name == "--prefix-table") {
+      options.prefixMegabytes = std::strtoull(value.c_str(), nullptr, 10);
+    } else {
+      throw std::runtime_error("unknown option '" + name + "'");
+    }
+  }
+
+  if (options.queries == 0 || options.words.empty() || std::find(options.words.begin(), options.words.end(), 0) != options.words.end()) {
+    throw std::runtime_error("the dictionary sizes and the amount of queries must be positive");
+  }
+  return options;
+}
+
+static long peakRssKb()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss; // kilobytes on Linux
+}
+
+// the constructor of the trie reports the stopword files on the standard output, which carries the records
+struct QuietStdout_t {
+  std::ostringstream sink;
+  std::streambuf* previous;
+
+  QuietStdout_t()
+  : previous(std::cout.rdbuf(sink.rdbuf()))
+  {
+  }
+
+  ~QuietStdout_t()
+  {
+    std::cout.rdbuf(previous);
+  }
+};
+
+// nodes the queries put on their active sets and nodes they examined, summed over the depths and edit distances
+struct NodeTotals_t {
+  uint64_t active;
+  uint64_t visited;
+};
+
+static NodeTotals_t nodeTotals(const std::shared_ptr<trie::StatsCollector_t>& collector)
+{
+  NodeTotals_t totals = { 0, 0 };
+  if (collector) {
+    trie::StatsSnapshot_t snapshot = collector->snapshot();
+    for (auto& depth : snapshot.activeNodesByDepth) {
+      totals.active += depth.sum;
+    }
+    for (auto& distance : snapshot.visitedByDistance) {
+      totals.visited += distance.sum;
+    }
+  }
+  return totals;
+}
+
+// what a record of a layout is compared on, see `compare`
+struct Summary_t {
+  double opsPerSecond;
+  uint64_t p50;
+  uint64_t p99;
+  std::size_t bytes;
+  std::size_t structureBytes; // nodes and edges
+};
+
+// the summaries of the records so far, keyed by words, op, threshold and engine, then by layout
+static std::map<std::string, std::map<std::string, Summary_t>> summaries;
+
+// the `compare` record of the frozen layout against the arena one, when both measured the same thing
+static void compare(const std::string& key, const Record_t& record)
+{
+  auto found = summaries.find(key);
+  if (record.layout != "frozen" || found == summaries.end() || !found->second.count("arena")) {
+    return;
+  }
+
+  const Summary_t& frozen = found->second.at("frozen");
+  const Summary_t& arena = found->second.at("arena");
+  std::cout << "{\"op\":\"compare\",\"of\":\"" << record.op << "\""
+            << ",\"layout\":\"frozen\",\"baseline\":\"arena\""
+            << ",\"words\":" << record.words
+            << ",\"threshold\":" << record.threshold
+            << ",\"engine\":\"" << record.engine << "\""
+            << ",\"structure_bytes\":" << frozen.structureBytes
+            << ",\"baseline_structure_bytes\":" << arena.structureBytes
+            << ",\"structure_ratio\":" << double(frozen.structureBytes) / arena.structureBytes
+            << ",\"trie_bytes\":" << frozen.bytes
+            << ",\"baseline_trie_bytes\":" << arena.bytes
+            << ",\"ops_per_second\":" << frozen.opsPerSecond
+            << ",\"baseline_ops_per_second\":" << arena.opsPerSecond
+            << ",\"speedup\":" << frozen.opsPerSecond / arena.opsPerSecond
+            << ",\"p50_ns\":" << frozen.p50
+            << ",\"baseline_p50_ns\":" << arena.p50
+            << ",\"p99_ns\":" << frozen.p99
+            << ",\"baseline_p99_ns\":" << arena.p99 << "}" << std::endl;
+}
+
+static void report(const Record_t& record, std::vector<uint64_t>& latencies, double seconds, std::size_t results, const trie::MemoryUsage_t& usage, const NodeTotals_t& nodes)
+{
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&](double rank) { return latencies[std::min(latencies.size() - 1, static_cast<std::size_t>(rank * latencies.size()))]; };
+
+  std::cout << "{\"op\":\"" << record.op << "\""
+            << ",\"layout\":\"" << record.layout << "\""
+            << ",\"words\":" << record.words
+            << ",\"threshold\":" << record.threshold
+            << ",\"limit\":" << record.limit
+            << ",\"seed\":" << record.seed
+            << ",\"stats\":" << record.stats
+            << ",\"cache_mb\":" << record.cacheMegabytes
+            << ",\"skew\":" << record.skew
+            << ",\"engine\":\"" << record.engine << "\""
+            << ",\"prefix_mb\":" << record.prefixMegabytes
+            << ",\"samples\":" << latencies.size()
+            << ",\"seconds\":" << seconds
+            << ",\"ops_per_second\":" << (seconds > 0 ? latencies.size() / seconds : 0)
+            << ",\"p50_ns\":" << percentile(0.5)
+            << ",\"p99_ns\":" << percentile(0.99)
+            << ",\"p999_ns\":" << percentile(0.999)
+            << ",\"max_ns\":" << latencies.back()
+            << ",\"results_per_query\":" << double(results) / latencies.size();
+  if (record.stats) {
+    std::cout << ",\"active_nodes_per_query\":" << double(nodes.active) / latencies.size()
+              << ",\"visited_nodes_per_query\":" << double(nodes.visited) / latencies.size();
+  }
+  std::cout << ",\"trie_bytes\":" << usage.totalBytes()
+            << ",\"index_bytes\":" << usage.indexBytes
+            << ",\"peak_rss_kb\":" << peakRssKb() << "}" << std::endl;
+
+  if (record.op == "exact" || record.op == "similar" || record.op == "autocomplete") {
+    std::string key = std::to_string(record.words) + " " + record.op + " " + std::to_string(record.threshold) + " " + record.engine;
+    summaries[key][record.layout] = { seconds > 0 ? latencies.size() / seconds : 0, percentile(0.5), percentile(0.99), usage.totalBytes(), usage.nodeBytes + usage.edgeBytes };
+    compare(key, record);
+  }
+}
+
+// times fn(item) for every item, fn returning the amount of results it got, then reports them with the size of the trie (and of its indexes)
+// and, with `--stats 1`, the nodes the items went through on average
+template <typename Trie, typename Item, typename Fn>
+static void measure(const Record_t& record, const Trie& trie, const std::vector<Item>& items, Fn fn)
+{
+  std::vector<uint64_t> latencies;
+  std::size_t results = 0;
+  latencies.reserve(items.size());
+  NodeTotals_t before = nodeTotals(trie.statsCollector());
+
+  auto start = std::chrono::steady_clock::now();
+  for (auto& item : items) {
+    auto before = std::chrono::steady_clock::now();
+    results += fn(item);
+    latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - before).count());
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  NodeTotals_t after = nodeTotals(trie.statsCollector());
+  report(record, latencies, seconds, results, trie.memoryUsage(), { after.active - before.active, after.visited - before.visited });
+}
+
+// runs the queries once without timing them, so the per-thread buffers are grown and the caches warm
+template <typename Fn>
+static void warmUp(const std::vector<std::string>& queries, Fn fn)
+{
+  for (std::size_t i = 0; i < std::min<std::size_t>(queries.size(), 1000); i++) {
+    fn(queries[i]);
+  }
+}
+
+// the exact, fuzzy and completion queries of every threshold over the built trie, then the dumps of its stats and cache
+template <typename Trie>
+static void runQueries(Record_t record, Trie& built, const std::vector<std::string>& dictionary, bench::Workload_t& workload, const Options_t& options)
+{
+  record.op = "exact";
+  if (options.ops.count("exact")) {
+    std::vector<std::string> queries = workload.typoQueries(dictionary, options.queries, 1);
+    auto query = [&](const std::string& keyword) { return built.searchKeyword(keyword).second.size(); };
+    warmUp(queries, query);
+    measure(record, built, queries, query);
+  }
+
+  for (int threshold : options.thresholds) {
+    record.threshold = threshold;
+    built.setFuzzyLimitThreshold(threshold);
+
+    record.op = "build";
+    record.limit = 0;
+    if (options.ops.count("build")) {
+      std::vector<int> once(1);
+      measure(record, built, once, [&](int) {
+        built.buildActiveNodeSet(false);
+        return 0;
+      });
+    } else {
+      built.buildActiveNodeSet(false);
+    }
+
+    if (options.prefixMegabytes) {
+      record.op = "prefixes";
+      std::vector<std::string> log = workload.typoQueries(dictionary, options.queries, threshold);
+      std::vector<int> once(1);
+      measure(record, built, once, [&](int) { return built.buildPrefixTable(options.prefixMegabytes << 20, log, 1000); });
+    }
+
+    record.op = "similar";
+    if (options.ops.count("similar")) {
+      std::vector<std::string> queries = workload.typoQueries(dictionary, options.queries, threshold);
+      if (options.skew) {
+        queries = workload.skewed(queries, queries.size());
+      }
+
+      for (auto& engine : options.engines) {
+        trie::FuzzyEngine_t fuzzyEngine = engine == "deletions" ? trie::kEngineDeletions : engine == "automaton" ? trie::kEngineAutomaton : trie::kEngineActiveNodes;
+        record.engine = engine;
+        if (fuzzyEngine == trie::kEngineDeletions) {
+          record.op = "index";
+          std::vector<int> once(1);
+          measure(record, built, once, [&](int) {
+            built.buildDeletionIndex(threshold);
+            return 0;
+          });
+          record.op = "similar";
+        }
+
+        auto query = [&](const std::string& keyword) { return built.searchSimilarKeyword(keyword, fuzzyEngine).size(); };
+        warmUp(queries, query);
+        measure(record, built, queries, query);
+      }
+      record.engine = "trie";
+      built.buildDeletionIndex(-1);
+    }
+
+    record.op = "autocomplete";
+    record.limit = options.limit;
+    if (options.ops.count("autocomplete")) {
+      std::vector<std::string> queries = workload.prefixQueries(dictionary, options.queries);
+      if (options.skew) {
+        queries = workload.skewed(queries, queries.size());
+      }
+      std::size_t limit = options.limit;
+      auto query = [&](const std::string& keyword) { return limit ? built.autocompleteTopK(keyword, limit).size() : built.autocomplete(keyword).size(); };
+      warmUp(queries, query);
+      measure(record, built, queries, query);
+    }
+  }
+
+  if (options.stats || options.cacheMegabytes) {
+    std::cerr << "# layout=" << record.layout << " words=" << record.words << '\n';
+  }
+  if (options.stats) {
+    built.statsCollector()->dump(std::cerr);
+  }
+  if (options.cacheMegabytes) {
+    built.resultCache()->stats().print(std::cerr);
+  }
+}
+
+// builds the trie of the layout ("frozen" is the arena one compiled by `freeze`, the time of which is the `freeze` op) and queries it
+template <typename Trie>
+static void run(const std::string& layout, std::size_t words, const Options_t& options)
+{
+  bench::Workload_t workload(options.seed);
+  std::vector<std::string> dictionary = workload.dictionary(words);
+  Record_t record = { "", layout, words, -1, 0, options.seed, options.stats, options.cacheMegabytes, options.skew, "trie", options.prefixMegabytes };
+
+  std::unique_ptr<Trie> trie;
+  {
+    QuietStdout_t quiet;
+    trie.reset(new Trie());
+  }
+  if (options.stats) {
+    trie->setStatsCollector(std::make_shared<trie::StatsCollector_t>());
+  }
+  if (options.cacheMegabytes) {
+    trie->setResultCache(std::make_shared<trie::ResultCache_t>(options.cacheMegabytes << 20));
+  }
+
+  record.op = "put";
+  if (options.ops.count("put")) {
+    measure(record, *trie, dictionary, [&](const std::string& word) {
+      trie->putIndividualWord(word, word);
+      return 0;
+    });
+  } else {
+    for (auto& word : dictionary) {
+      trie->putIndividualWord(word, word);
+    }
+  }
+
+  record.op = "update";
+  if (options.ops.count("update")) {
+    std::size_t before = trie->memoryUsage().payloadBytes;
+    const std::string& word = dictionary.front();
+    std::vector<std::size_t> rounds(std::max(options.queries, 2 * words));
+    for (std::size_t i = 0; i < rounds.size(); i++) {
+      rounds[i] = i;
+    }
+    measure(record, *trie, rounds, [&](std::size_t round) {
+      trie->updateWord(word, word + "#" + std::to_string(round));
+      return 0;
+    });
+    trie->updateWord(word, word);
+
+    std::size_t after = trie->memoryUsage().payloadBytes;
+    if (after > before + before / 4 + (1 << 16)) { // the unused values are dropped once they are as many as the others
+      throw std::runtime_error("the values of the " + layout + " trie grew from " + std::to_string(before) + " to " + std::to_string(after) + " bytes under updates");
+    }
+  }
+  trie->shrinkToFit();
+
+  if (layout == "frozen") {
+    record.op = "freeze";
+    std::unique_ptr<trie::FrozenTrie_t> frozen;
+    std::vector<int> once(1);
+    measure(record, *trie, once, [&](int) {
+      frozen.reset(new trie::FrozenTrie_t(trie->freeze()));
+      return 0;
+    });
+    trie.reset();
+    runQueries(record, *frozen, dictionary, workload, options);
+  } else {
+    runQueries(record, *trie, dictionary, workload, options);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  try {
+    Options_t options = parseOptions(argc, argv);
+
+    if (!std::ifstream("charmap.cm")) {
+      throw std::runtime_error("charmap.cm not found, run the benchmark from the repository root");
+    }
+
+    for (std::size_t words : options.words) {
+      if (options.layouts.count("pointer")) {
+        run<trie::Trie_t>("pointer", words, options);
+      }
+      if (options.layouts.count("arena")) {
+        run<trie::ArenaTrie_t>("arena", words, options);
+      }
+      if (options.layouts.count("radix")) {
+        run<trie::RadixTrie_t>("radix", words, options);
+      }
+      if (options.layouts.count("frozen")) {
+        run<trie::ArenaTrie_t>("frozen", words, options);
+      }
+    }
+  } catch (const std::exception& error) {
+    std::cerr << "trie_bench: " << error.what() << '\n';
+    return 1;
+  }
+}
@@ -0,0 +1,177 @@
+#ifndef _ZYNTHETIC_BENCH_WORKLOAD_
+#define _ZYNTHETIC_BENCH_WORKLOAD_
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+  /*
+  ** Synthetic dictionaries and query workloads, deterministic for a given seed so two builds are measured on the same input.
+  ** The words follow a rough English letter frequency with lengths between 3 and 14, some of them with accented letters.
+  */
+  class Workload_t {
+    std::mt19937_64 m_random;
+
+    std::size_t uniform(std::size_t bound)
+    {
+      return std::uniform_int_distribution<std::size_t>(0, bound - 1)(m_random);
+    }
+
+    // index on [0, bound) drawn on a log-uniform rank : a few frequent items and a long tail, as Zipf
+    std::size_t skewedIndex(std::size_t bound)
+    {
+      double rank = std::pow(static_cast<double>(bound), std::uniform_real_distribution<double>(0, 1)(m_random));
+      return std::min(static_cast<std::size_t>(rank) - 1, bound - 1);
+    }
+
+  public:
+    explicit Workload_t(uint64_t seed)
+    : m_random(seed)
+    {
+    }
+
+    char letter()
+    {
+      static const char weighted[] = "eeeeeeeeeeeettttttttaaaaaaaaoooooooiiiiiiinnnnnnnsssssshhhhhhrrrrrrddddllllcccuuummwwffggyyppbbvkjxqz";
+      return weighted[uniform(sizeof(weighted) - 1)];
+    }
+
+    std::string word()
+    {
+      static const char* accented[] = { "á", "ã", "ç", "é", "ê", "í", "ó", "õ", "ú" };
+      std::size_t length = 3 + uniform(6) + uniform(6); // 3 to 13, centered on 8
+      std::string current;
+
+      for (std::size_t i = 0; i < length; i++) {
+        if (uniform(40) == 0) {
+          current += accented[uniform(sizeof(accented) / sizeof(accented[0]))];
+        } else {
+          current += letter();
+        }
+      }
+      return current;
+    }
+
+    std::vector<std::string> dictionary(std::size_t words)
+    {
+      std::vector<std::string> current;
+      current.reserve(words);
+      for (std::size_t i = 0; i < words; i++) {
+        current.push_back(word());
+      }
+      return current;
+    }
+
+    // replaces, inserts, deletes or swaps one character (bytes, so an accented letter may be broken as a real typo would)
+    std::string typo(std::string current)
+    {
+      std::size_t position = uniform(current.size() + 1);
+
+      switch (uniform(4)) {
+      case 0:
+        if (position < current.size()) {
+          current[position] = letter();
+        }
+        break;
+      case 1:
+        current.insert(current.begin() + position, letter());
+        break;
+      case 2:
+        if (position < current.size()) {
+          current.erase(current.begin() + position);
+        }
+        break;
+      default:
+        if (position + 1 < current.size()) {
+          std::swap(current[position], current[position + 1]);
+        }
+      }
+      return current;
+    }
+
+    // words of the dictionary with up to `maxTypos` typos each (a quarter of them kept exact)
+    std::vector<std::string> typoQueries(const std::vector<std::string>& dictionary, std::size_t queries, int maxTypos)
+    {
+      std::vector<std::string> current;
+      current.reserve(queries);
+
+      for (std::size_t i = 0; i < queries; i++) {
+        std::string query = dictionary[uniform(dictionary.size())];
+        int typos = uniform(4) == 0 ? 0 : 1 + static_cast<int>(uniform(std::max(maxTypos, 1)));
+        for (int j = 0; j < typos; j++) {
+          query = typo(query);
+        }
+        current.push_back(query);
+      }
+      return current;
+    }
+
+    // prefixes of 1 to 6 characters of dictionary words, a third of them with a typo
+    std::vector<std::string> prefixQueries(const std::vector<std::string>& dictionary, std::size_t queries)
+    {
+      std::vector<std::string> current;
+      current.reserve(queries);
+
+      for (std::size_t i = 0; i < queries; i++) {
+        const std::string& source = dictionary[uniform(dictionary.size())];
+        std::string query = source.substr(0, 1 + uniform(6));
+        current.push_back(uniform(3) == 0 ? typo(query) : query);
+      }
+      return current;
+    }
+
+    // `count` queries drawn from `pool` on a skewed rank, so the first ones of the pool repeat as popular queries do
+    std::vector<std::string> skewed(const std::vector<std::string>& pool, std::size_t count)
+    {
+      std::vector<std::string> current;
+      current.reserve(count);
+      for (std::size_t i = 0; i < count; i++) {
+        current.push_back(pool[skewedIndex(pool.size())]);
+      }
+      return current;
+    }
+
+    /*
+    ** Running text of about `bytes` bytes : dictionary words drawn on a skewed rank (see `skewedIndex`), one in ten with a typo, a stopword or a short word every few words, capitalized sentences with punctuation.
+    */
+    std::string text(const std::vector<std::string>& dictionary, const std::vector<std::string>& stopwords, std::size_t bytes)
+    {
+      static const char* shortWords[] = { "a", "e", "o", "i", "is", "to", "of", "em" };
+      static const char* separators[] = { " ", " ", " ", " ", " ", " ", ", ", "; ", " (", ") " };
+      std::string current;
+      bool sentenceStart = true;
+
+      while (current.size() < bytes) {
+        std::string word;
+        std::size_t kind = uniform(10);
+        if (kind < 2 && !stopwords.empty()) {
+          word = stopwords[uniform(stopwords.size())];
+        } else if (kind < 3) {
+          word = shortWords[uniform(sizeof(shortWords) / sizeof(shortWords[0]))];
+        } else {
+          word = dictionary[skewedIndex(dictionary.size())];
+          if (uniform(10) == 0) {
+            word = typo(word);
+          }
+        }
+
+        if (sentenceStart && !word.empty() && word[0] >= 'a' && word[0] <= 'z') {
+          word[0] = static_cast<char>(word[0] - 'a' + 'A');
+        }
+        current += word;
+
+        sentenceStart = uniform(12) == 0;
+        if (sentenceStart) {
+          current += uniform(15) == 0 ? ".\n" : ". ";
+        } else {
+          current += separators[uniform(sizeof(separators) / sizeof(separators[0]))];
+        }
+      }
+      return current;
+    }
+  };
+}
+#endif
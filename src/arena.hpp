@@ -0,0 +1,519 @@
+#ifndef _ZYNTHETIC_ARENA_
+#define _ZYNTHETIC_ARENA_
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "payload.hpp"
+
+namespace trie {
+
+  struct MemoryUsage_t {
+    std::size_t nodes; // amount of nodes on the structure
+    std::size_t edges; // amount of parent -> child links
+    std::size_t nodeBytes; // bytes spent on the nodes themselves
+    std::size_t edgeBytes; // bytes spent on the children containers
+    std::size_t payloadBytes; // bytes spent on the stored values
+    std::size_t wastedBytes; // bytes allocated but unused (free slots, relocated blocks)
+    std::size_t indexBytes; // bytes spent on the side indexes of the trie (deletion index, prefix table)
+
+    MemoryUsage_t()
+    : nodes(0)
+    , edges(0)
+    , nodeBytes(0)
+    , edgeBytes(0)
+    , payloadBytes(0)
+    , wastedBytes(0)
+    , indexBytes(0)
+    {
+    }
+
+    std::size_t totalBytes() const
+    {
+      return nodeBytes + edgeBytes + payloadBytes + wastedBytes + indexBytes;
+    }
+
+    void print(std::ostream& out, const std::string& layout) const
+    {
+      out << "[" << layout << "] nodes=" << nodes
+          << " edges=" << edges
+          << " node_bytes=" << nodeBytes
+          << " edge_bytes=" << edgeBytes
+          << " payload_bytes=" << payloadBytes
+          << " wasted_bytes=" << wastedBytes
+          << " index_bytes=" << indexBytes
+          << " total_bytes=" << totalBytes()
+          << " bytes_per_node=" << (nodes ? totalBytes() / nodes : 0) << '\n';
+    }
+  };
+
+  /*
+  ** Depths of the words of a subtree relative to its root (0 when the root ends a word itself), which bounds the length of
+  ** every word a fuzzy query can still reach through it. Depths saturate at 65534; an empty subtree has min > max.
+  */
+  struct WordDepths_t {
+    static const uint16_t kSaturated = UINT16_MAX - 1;
+
+    uint16_t min;
+    uint16_t max;
+
+    WordDepths_t()
+    : min(UINT16_MAX)
+    , max(0)
+    {
+    }
+
+    // a subtree holding the word of its root only
+    static WordDepths_t endOfWord()
+    {
+      WordDepths_t depths;
+      depths.min = depths.max = 0;
+      return depths;
+    }
+
+    bool empty() const
+    {
+      return min > max;
+    }
+
+    void widen(std::size_t depth)
+    {
+      uint16_t clamped = static_cast<uint16_t>(std::min<std::size_t>(depth, kSaturated));
+      min = std::min(min, clamped);
+      max = std::max(max, clamped);
+    }
+
+    // adds the words of a subtree whose root is `offset` levels below
+    void widen(WordDepths_t below, std::size_t offset)
+    {
+      if (!below.empty()) {
+        widen(below.min + offset);
+        widen(below.max + offset);
+      }
+    }
+  };
+
+  struct ArenaNode_t {
+    uint32_t content; // character code of the edge which leads to this node
+    uint32_t valueSlot; // index on the value table, ArenaNodeStore_t::kNoValue when it is not end of word
+    uint32_t firstEdge; // offset of the children block on the edge array
+    uint16_t edgeCount; // used slots of the children block
+    uint16_t edgeCapacity; // reserved slots of the children block
+    uint32_t maxScore; // highest score among the values of this subtree
+    WordDepths_t wordDepths; // depths of the words of this subtree
+
+    ArenaNode_t(uint32_t val)
+    : content(val)
+    , valueSlot(UINT32_MAX)
+    , firstEdge(0)
+    , edgeCount(0)
+    , edgeCapacity(0)
+    , maxScore(0)
+    {
+    }
+  };
+
+  struct ArenaEdge_t {
+    uint32_t code; // character code, the children block is sorted by it
+    uint32_t node; // id of the child
+  };
+
+  // first edge of the sorted block whose code is not lesser than `code` (any edge type with a `code` field)
+  template <typename Edge>
+  inline const Edge* findArenaEdge(const Edge* begin, uint32_t count, uint32_t code)
+  {
+    const Edge* end = begin + count;
+
+    if (count <= 8) { // small blocks : a linear scan beats the binary search
+      for (; begin != end && begin->code < code; begin++) {
+      }
+      return begin;
+    }
+
+    return std::lower_bound(begin, end, code, [](const Edge& edge, uint32_t val) { return edge.code < val; });
+  }
+
+  /*
+  ** Node storage where every node lives on a single contiguous vector and is addressed by a 32-bit id.
+  ** The children of a node are a sorted block of the edge array : when a block gets full it is moved to the
+  ** end of the array with the double of the capacity (the old slots are accounted as waste until `shrinkToFit`).
+  */
+  class ArenaNodeStore_t {
+    std::vector<ArenaNode_t> m_nodes; // m_nodes[0] is the lambda node
+    std::vector<ArenaEdge_t> m_edges; // children blocks
+    std::vector<std::vector<PayloadRef_t>> m_values; // values (and their scores) of the end of word nodes
+    PayloadArena_t m_payloads; // the bytes of every distinct value
+    std::size_t m_wastedEdges; // slots left behind by relocated blocks and removed nodes
+    std::vector<uint32_t> m_freeNodes; // ids of removed nodes, given again before growing m_nodes
+    std::vector<uint32_t> m_freeValues; // value slots of the nodes which stopped being an end of word
+
+    const ArenaEdge_t* findEdge(const ArenaNode_t& node, uint32_t code) const
+    {
+      return findArenaEdge(m_edges.data() + node.firstEdge, node.edgeCount, code);
+    }
+
+    // adds the edge to the sorted children block of `node`
+    void insertEdge(uint32_t node, uint32_t value, uint32_t child)
+    {
+      ArenaNode_t& current = m_nodes[node];
+
+      if (current.edgeCount == current.edgeCapacity) { // the block is full, so move it to the end with the double of the room
+        uint32_t newCapacity = current.edgeCapacity ? current.edgeCapacity * 2u : 1u;
+        uint32_t newFirst = static_cast<uint32_t>(m_edges.size());
+
+        m_edges.resize(m_edges.size() + newCapacity);
+        std::copy(m_edges.begin() + current.firstEdge, m_edges.begin() + current.firstEdge + current.edgeCount, m_edges.begin() + newFirst);
+
+        m_wastedEdges += current.edgeCapacity;
+        current.firstEdge = newFirst;
+        current.edgeCapacity = static_cast<uint16_t>(newCapacity);
+      }
+
+      ArenaEdge_t* begin = m_edges.data() + current.firstEdge;
+      ArenaEdge_t* position = begin + (findEdge(current, value) - begin);
+      std::copy_backward(position, begin + current.edgeCount, begin + current.edgeCount + 1);
+      position->code = value;
+      position->node = child;
+      current.edgeCount++;
+    }
+
+  public:
+    typedef uint32_t Node_t;
+    static const uint32_t kNullNode = UINT32_MAX;
+    static const uint32_t kNoValue = UINT32_MAX;
+
+    ArenaNodeStore_t()
+    : m_wastedEdges(0)
+    {
+      m_nodes.emplace_back(0);
+    }
+
+    // deep copy : the nodes and the payloads keep their ids, so the same edits give the same ids on both stores
+    ArenaNodeStore_t(const ArenaNodeStore_t&) = default;
+    ArenaNodeStore_t(ArenaNodeStore_t&&) = default;
+    ArenaNodeStore_t& operator=(ArenaNodeStore_t&&) = default;
+
+    static Node_t nullNode()
+    {
+      return kNullNode;
+    }
+
+    Node_t root() const
+    {
+      return 0;
+    }
+
+    Node_t getChild(Node_t node, unsigned int value) const
+    {
+      const ArenaNode_t& current = m_nodes[node];
+      const ArenaEdge_t* edge = findEdge(current, value);
+
+      if (edge != m_edges.data() + current.firstEdge + current.edgeCount && edge->code == value) {
+        return edge->node;
+      }
+      return kNullNode;
+    }
+
+    Node_t insertNReturnChild(Node_t node, unsigned int value)
+    {
+      Node_t child = getChild(node, value);
+
+      if (child != kNullNode) {
+        return child;
+      }
+
+      if (m_freeNodes.empty()) {
+        child = static_cast<Node_t>(m_nodes.size());
+        m_nodes.emplace_back(value);
+      } else {
+        child = m_freeNodes.back();
+        m_freeNodes.pop_back();
+        m_nodes[child] = ArenaNode_t(value);
+      }
+      insertEdge(node, value, child);
+
+      return child;
+    }
+
+    // the child must be a leaf without values, its children block is accounted as waste until `shrinkToFit`
+    void removeChild(Node_t node, unsigned int value)
+    {
+      ArenaNode_t& current = m_nodes[node];
+      ArenaEdge_t* begin = m_edges.data() + current.firstEdge;
+      ArenaEdge_t* edge = begin + (findEdge(current, value) - begin);
+
+      if (edge == begin + current.edgeCount || edge->code != value || m_nodes[edge->node].edgeCount || isEndOfWord(edge->node)) {
+        throw std::logic_error("only a leaf without values can be removed");
+      }
+
+      m_wastedEdges += m_nodes[edge->node].edgeCapacity;
+      m_freeNodes.push_back(edge->node);
+      std::copy(edge + 1, begin + current.edgeCount, edge);
+      current.edgeCount--;
+    }
+
+    template <typename Fn>
+    void forEachChild(Node_t node, Fn fn) const
+    {
+      const ArenaNode_t& current = m_nodes[node];
+      const ArenaEdge_t* edge = m_edges.data() + current.firstEdge;
+
+      for (const ArenaEdge_t* end = edge + current.edgeCount; edge != end; edge++) {
+        fn(edge->node);
+      }
+    }
+
+    unsigned int getContent(Node_t node) const
+    {
+      return m_nodes[node].content;
+    }
+
+    uint32_t getId(Node_t node) const
+    {
+      return node;
+    }
+
+    bool isEndOfWord(Node_t node) const
+    {
+      return m_nodes[node].valueSlot != kNoValue;
+    }
+
+    void addValue(Node_t node, PayloadView_t content, unsigned int score)
+    {
+      ArenaNode_t& current = m_nodes[node];
+
+      if (current.valueSlot == kNoValue && !m_freeValues.empty()) {
+        current.valueSlot = m_freeValues.back();
+        m_freeValues.pop_back();
+      } else if (current.valueSlot == kNoValue) {
+        current.valueSlot = static_cast<uint32_t>(m_values.size());
+        m_values.emplace_back();
+      }
+
+      m_values[current.valueSlot].push_back({ m_payloads.intern(content), score });
+    }
+
+    // renumbers the values once the payloads without uses are dropped (see `PayloadArena_t::compact`)
+    void reclaimPayloads()
+    {
+      if (!m_payloads.wasteful()) {
+        return;
+      }
+
+      std::vector<uint32_t> ids = m_payloads.compact();
+      for (auto& values : m_values) {
+        for (PayloadRef_t& value : values) {
+          value.id = ids[value.id];
+        }
+      }
+    }
+
+    // removes the value, the node stops being an end of word with its last value
+    bool removeValue(Node_t node, PayloadView_t content)
+    {
+      uint32_t slot = m_nodes[node].valueSlot;
+      if (slot == kNoValue) {
+        return false;
+      }
+
+      std::vector<PayloadRef_t>& values = m_values[slot];
+      auto found = std::find_if(values.begin(), values.end(), [&](const PayloadRef_t& value) { return m_payloads.get(value.id) == content; });
+      if (found == values.end()) {
+        return false;
+      }
+
+      m_payloads.release(found->id);
+      values.erase(found);
+      if (values.empty()) {
+        clearValues(node);
+      }
+      reclaimPayloads();
+      return true;
+    }
+
+    void clearValues(Node_t node)
+    {
+      uint32_t slot = m_nodes[node].valueSlot;
+      if (slot != kNoValue) {
+        for (const PayloadRef_t& value : m_values[slot]) {
+          m_payloads.release(value.id);
+        }
+        std::vector<PayloadRef_t>().swap(m_values[slot]);
+        m_freeValues.push_back(slot);
+        m_nodes[node].valueSlot = kNoValue;
+        reclaimPayloads();
+      }
+    }
+
+    // fn(PayloadView_t value, unsigned int score)
+    template <typename Fn>
+    void forEachValue(Node_t node, Fn fn) const
+    {
+      const ArenaNode_t& current = m_nodes[node];
+
+      if (current.valueSlot != kNoValue) {
+        for (const PayloadRef_t& value : m_values[current.valueSlot]) {
+          fn(m_payloads.get(value.id), value.score);
+        }
+      }
+    }
+
+    PayloadView_t payload(uint32_t id) const
+    {
+      return m_payloads.get(id);
+    }
+
+    std::size_t payloadCount() const
+    {
+      return m_payloads.size();
+    }
+
+    unsigned int getMaxScore(Node_t node) const
+    {
+      return m_nodes[node].maxScore;
+    }
+
+    void raiseMaxScore(Node_t node, unsigned int score)
+    {
+      m_nodes[node].maxScore = std::max(m_nodes[node].maxScore, score);
+    }
+
+    void setMaxScore(Node_t node, unsigned int score)
+    {
+      m_nodes[node].maxScore = score;
+    }
+
+    WordDepths_t getWordDepths(Node_t node) const
+    {
+      return m_nodes[node].wordDepths;
+    }
+
+    void widenWordDepths(Node_t node, WordDepths_t below, std::size_t offset)
+    {
+      m_nodes[node].wordDepths.widen(below, offset);
+    }
+
+    void setWordDepths(Node_t node, WordDepths_t depths)
+    {
+      m_nodes[node].wordDepths = depths;
+    }
+
+    // bound of the node ids, the ids of removed nodes are reused before it grows
+    std::size_t nodeCount() const
+    {
+      return m_nodes.size();
+    }
+
+    /*
+    ** Appends the nodes of `shard` (a store built apart, see `BasicBulkLoader_t`) and links its root children under the root
+    ** of this one, ids and edge offsets being shifted past the current ones. The first characters of the shard must be new here.
+    */
+    void splice(ArenaNodeStore_t& shard)
+    {
+      const ArenaNode_t& shardRoot = shard.m_nodes[0];
+      for (uint32_t i = 0; i < shardRoot.edgeCount; i++) {
+        if (getChild(root(), shard.m_edges[shardRoot.firstEdge + i].code) != kNullNode) {
+          throw std::logic_error("the spliced subtrees must start with new characters");
+        }
+      }
+
+      uint32_t nodeOffset = static_cast<uint32_t>(m_nodes.size()) - 1; // the shard root (id 0) is left behind
+      uint32_t edgeOffset = static_cast<uint32_t>(m_edges.size());
+      uint32_t valueOffset = static_cast<uint32_t>(m_values.size());
+
+      m_nodes.reserve(m_nodes.size() + shard.m_nodes.size() - 1);
+      for (auto node = shard.m_nodes.begin() + 1; node != shard.m_nodes.end(); node++) {
+        m_nodes.push_back(*node);
+        m_nodes.back().firstEdge += edgeOffset;
+        if (node->valueSlot != kNoValue) {
+          m_nodes.back().valueSlot += valueOffset;
+        }
+      }
+
+      m_edges.reserve(m_edges.size() + shard.m_edges.size());
+      for (const ArenaEdge_t& edge : shard.m_edges) {
+        m_edges.push_back({ edge.code, edge.node + nodeOffset });
+      }
+
+      std::vector<uint32_t> payloadIds = m_payloads.absorb(shard.m_payloads);
+      m_values.reserve(m_values.size() + shard.m_values.size());
+      for (auto& values : shard.m_values) {
+        for (PayloadRef_t& value : values) {
+          value.id = payloadIds[value.id];
+        }
+        m_values.push_back(std::move(values));
+      }
+      for (uint32_t node : shard.m_freeNodes) {
+        m_freeNodes.push_back(node + nodeOffset);
+      }
+      for (uint32_t slot : shard.m_freeValues) {
+        m_freeValues.push_back(slot + valueOffset);
+      }
+
+      for (uint32_t i = 0; i < shardRoot.edgeCount; i++) {
+        const ArenaEdge_t& edge = shard.m_edges[shardRoot.firstEdge + i];
+        insertEdge(root(), edge.code, edge.node + nodeOffset);
+      }
+
+      m_nodes[0].maxScore = std::max(m_nodes[0].maxScore, shardRoot.maxScore);
+      m_nodes[0].wordDepths.widen(shardRoot.wordDepths, 0);
+      m_wastedEdges += shard.m_wastedEdges + shardRoot.edgeCapacity; // the copied block of the shard root is not linked
+
+      shard = ArenaNodeStore_t();
+    }
+
+    // repack the children blocks in breadth-first order, dropping relocated slots and spare capacity
+    void shrinkToFit()
+    {
+      std::vector<ArenaEdge_t> packed;
+      std::queue<Node_t> pending;
+      packed.reserve(m_edges.size() - m_wastedEdges);
+      pending.push(root());
+
+      while (!pending.empty()) {
+        ArenaNode_t& current = m_nodes[pending.front()];
+        pending.pop();
+
+        uint32_t newFirst = static_cast<uint32_t>(packed.size());
+        for (uint32_t i = 0; i < current.edgeCount; i++) {
+          packed.push_back(m_edges[current.firstEdge + i]);
+          pending.push(m_edges[current.firstEdge + i].node);
+        }
+
+        current.firstEdge = newFirst;
+        current.edgeCapacity = current.edgeCount;
+      }
+
+      packed.shrink_to_fit();
+      m_edges.swap(packed);
+      m_nodes.shrink_to_fit();
+      m_wastedEdges = 0;
+    }
+
+    MemoryUsage_t memoryUsage() const
+    {
+      MemoryUsage_t usage;
+      usage.nodes = m_nodes.size() - m_freeNodes.size();
+      usage.nodeBytes = m_nodes.capacity() * sizeof(ArenaNode_t);
+
+      std::size_t usedEdges = 0;
+      for (const ArenaNode_t& node : m_nodes) {
+        usedEdges += node.edgeCount;
+      }
+      usage.edges = usedEdges;
+      usage.edgeBytes = usedEdges * sizeof(ArenaEdge_t);
+      usage.wastedBytes = (m_edges.capacity() - usedEdges) * sizeof(ArenaEdge_t);
+
+      usage.payloadBytes = m_values.capacity() * sizeof(m_values.front()) + m_payloads.memoryUsage();
+      for (const auto& values : m_values) {
+        usage.payloadBytes += values.capacity() * sizeof(PayloadRef_t);
+      }
+
+      return usage;
+    }
+  };
+}
+#endif
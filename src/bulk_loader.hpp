@@ -0,0 +1,391 @@
+#ifndef _ZYNTHETIC_BULK_LOADER_
+#define _ZYNTHETIC_BULK_LOADER_
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "thread_pool.hpp"
+#include "trie.hpp"
+
+namespace trie {
+
+  enum LoadPhase_t {
+    kLoadReading = 0, // streaming the file into the shards
+    kLoadSplicing, // moving the shards under the lambda node
+    kLoadIndexing, // building the initial active node set
+    kLoadDone
+  };
+
+  struct LoadProgress_t {
+    LoadPhase_t phase;
+    std::size_t bytesRead;
+    std::size_t totalBytes; // 0 when the size of the input is unknown
+    std::size_t lines;
+    std::size_t words; // words already inserted on the shards
+    double seconds; // since the load started
+
+    LoadProgress_t()
+    : phase(kLoadReading)
+    , bytesRead(0)
+    , totalBytes(0)
+    , lines(0)
+    , words(0)
+    , seconds(0)
+    {
+    }
+
+    double wordsPerSecond() const
+    {
+      return seconds > 0 ? words / seconds : 0;
+    }
+
+    void print(std::ostream& out) const
+    {
+      static const char* phases[] = { "reading", "splicing", "indexing", "done" };
+
+      out << "[load] phase=" << phases[phase]
+          << " lines=" << lines
+          << " words=" << words
+          << " bytes=" << bytesRead;
+      if (totalBytes) {
+        out << "/" << totalBytes << " (" << (100 * bytesRead / totalBytes) << "%)";
+      }
+      out << " seconds=" << seconds
+          << " words_per_second=" << static_cast<std::size_t>(wordsPerSecond())
+          << " mb_per_second=" << (seconds > 0 ? bytesRead / seconds / (1 << 20) : 0) << '\n';
+    }
+  };
+
+  /*
+  ** Streams a dictionary file into a trie using every thread of a pool. Each line is `word[\tpayload[\tscore]]` (the
+  ** payload defaults to the word itself, the score to 0).
+  ** The lines are sharded by the code of their first character : every shard is a separate node storage fed by one task at
+  ** a time, so the subtries grow in parallel without locks on the nodes, and once the input ends they are spliced under the
+  ** lambda node. The initial active node set is built once, at the end.
+  ** At most `maxPendingBatches` batches wait on the shards, which bounds the memory spent on lines read ahead.
+  */
+  template <typename Storage>
+  class BasicBulkLoader_t {
+  public:
+    typedef BasicTrie_t<Storage> Trie_t;
+
+  private:
+    struct BulkRecord_t {
+      uint32_t wordBegin;
+      uint32_t wordSize;
+      uint32_t payloadBegin;
+      uint32_t payloadSize;
+      unsigned int score;
+    };
+
+    struct Batch_t {
+      std::string text; // the lines of the batch, the records point into it
+      std::vector<BulkRecord_t> records;
+    };
+
+    struct Shard_t {
+      Storage nodes;
+      std::mutex lock; // guards the fields below
+      std::deque<Batch_t> pending;
+      bool scheduled; // a task is draining `pending`
+
+      Shard_t()
+      : scheduled(false)
+      {
+      }
+    };
+
+    Trie_t& m_trie;
+    ThreadPool_t& m_pool;
+    std::vector<std::unique_ptr<Shard_t>> m_shards; // indexed by the code of the first character
+    std::vector<Batch_t> m_filling; // batch being read for each shard
+    std::size_t m_batchSize;
+    std::size_t m_maxPendingBatches;
+    bool m_onlyFinalWords;
+    std::chrono::milliseconds m_progressInterval;
+    std::function<void(const LoadProgress_t&)> m_progress;
+
+    std::mutex m_stateLock; // guards the fields below
+    std::condition_variable m_batchDone;
+    std::size_t m_inFlight; // batches handed to the shards and not inserted yet
+    std::size_t m_drains; // drain tasks still running, the shards cannot go away before they end
+    std::size_t m_wordsInserted;
+    std::exception_ptr m_error;
+
+    Shard_t& shard(unsigned int code)
+    {
+      if (code >= m_shards.size()) {
+        m_shards.resize(code + 1);
+        m_filling.resize(code + 1);
+      }
+      if (!m_shards[code]) {
+        m_shards[code].reset(new Shard_t());
+      }
+      return *m_shards[code];
+    }
+
+    // splits `line` into its fields and appends it to the batch of its shard (whose code is set on `code`), false for an empty word
+    bool appendLine(const std::string& line, unsigned int& code)
+    {
+      std::size_t wordEnd = line.find('\t');
+      std::size_t wordSize = wordEnd == std::string::npos ? line.size() : wordEnd;
+
+      if (wordSize == 0) {
+        return false;
+      }
+
+      bool first = true;
+      forEachCodePoint(line.data(), std::min<std::size_t>(wordSize, 4), [&](uint32_t character) { // a character takes 4 bytes at most
+        if (first) {
+          code = m_trie.characterCode(character);
+          first = false;
+        }
+      });
+
+      shard(code);
+      Batch_t& batch = m_filling[code];
+      BulkRecord_t record;
+      record.wordBegin = static_cast<uint32_t>(batch.text.size());
+      record.wordSize = static_cast<uint32_t>(wordSize);
+      record.payloadBegin = record.wordBegin;
+      record.payloadSize = record.wordSize;
+      record.score = 0;
+
+      if (wordEnd != std::string::npos) {
+        std::size_t payloadEnd = line.find('\t', wordEnd + 1);
+        record.payloadBegin = record.wordBegin + static_cast<uint32_t>(wordEnd + 1);
+        record.payloadSize = static_cast<uint32_t>((payloadEnd == std::string::npos ? line.size() : payloadEnd) - wordEnd - 1);
+
+        if (payloadEnd != std::string::npos) {
+          record.score = static_cast<unsigned int>(std::strtoul(line.c_str() + payloadEnd + 1, nullptr, 10));
+        }
+      }
+
+      batch.text += line;
+      batch.records.push_back(record);
+      return true;
+    }
+
+    void insertBatch(Shard_t& target, const Batch_t& batch)
+    {
+      for (const BulkRecord_t& record : batch.records) {
+        m_trie.insertWord(target.nodes, PayloadView_t(batch.text.data() + record.wordBegin, record.wordSize),
+                          PayloadView_t(batch.text.data() + record.payloadBegin, record.payloadSize), record.score);
+      }
+    }
+
+    // inserts the pending batches of a shard until it runs dry, only one drain runs per shard
+    void drain(Shard_t& target)
+    {
+      for (;;) {
+        Batch_t batch;
+        {
+          std::unique_lock<std::mutex> guard(target.lock);
+          if (target.pending.empty()) {
+            target.scheduled = false;
+            guard.unlock();
+
+            std::lock_guard<std::mutex> state(m_stateLock); // the loader may be gone once this is released
+            m_drains--;
+            m_batchDone.notify_all();
+            return;
+          }
+          batch = std::move(target.pending.front());
+          target.pending.pop_front();
+        }
+
+        std::exception_ptr error;
+        try {
+          insertBatch(target, batch);
+        } catch (...) {
+          error = std::current_exception();
+        }
+
+        {
+          std::lock_guard<std::mutex> guard(m_stateLock);
+          if (error && !m_error) {
+            m_error = error;
+          }
+          m_inFlight--;
+          m_wordsInserted += batch.records.size();
+          m_batchDone.notify_all();
+        }
+      }
+    }
+
+    void dispatch(unsigned int code)
+    {
+      Batch_t& batch = m_filling[code];
+      if (batch.records.empty()) {
+        return;
+      }
+
+      {
+        std::unique_lock<std::mutex> guard(m_stateLock);
+        m_batchDone.wait(guard, [this] { return m_inFlight < m_maxPendingBatches; });
+        m_inFlight++;
+      }
+
+      Shard_t& target = *m_shards[code];
+      bool schedule;
+      {
+        std::lock_guard<std::mutex> guard(target.lock);
+        target.pending.push_back(std::move(batch));
+        schedule = !target.scheduled;
+        target.scheduled = true;
+      }
+      batch = Batch_t();
+
+      if (schedule) {
+        {
+          std::lock_guard<std::mutex> guard(m_stateLock);
+          m_drains++;
+        }
+        m_pool.submit([this, &target] { drain(target); });
+      }
+    }
+
+    void report(LoadProgress_t& progress, std::chrono::steady_clock::time_point start)
+    {
+      progress.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      {
+        std::lock_guard<std::mutex> guard(m_stateLock);
+        progress.words = m_wordsInserted;
+      }
+      if (m_progress) {
+        m_progress(progress);
+      }
+    }
+
+  public:
+    BasicBulkLoader_t(Trie_t& trie, ThreadPool_t& pool)
+    : m_trie(trie)
+    , m_pool(pool)
+    , m_batchSize(4096)
+    , m_maxPendingBatches(pool.size() * 4)
+    , m_onlyFinalWords(false)
+    , m_progressInterval(1000)
+    , m_inFlight(0)
+    , m_drains(0)
+    , m_wordsInserted(0)
+    {
+    }
+
+    // lines per batch handed to a shard (default : 4096)
+    void setBatchSize(std::size_t lines)
+    {
+      this->m_batchSize = std::max<std::size_t>(lines, 1);
+    }
+
+    // batches read ahead of the shards before the reading waits (default : 4 per pool thread)
+    void setMaxPendingBatches(std::size_t batches)
+    {
+      this->m_maxPendingBatches = std::max<std::size_t>(batches, 1);
+    }
+
+    // argument given to `buildActiveNodeSet` at the end (default : false)
+    void setOnlyFinalWords(bool onlyFinalWords)
+    {
+      this->m_onlyFinalWords = onlyFinalWords;
+    }
+
+    // fn(const LoadProgress_t&) is called from the loading thread at most once per interval and on every phase change
+    void setProgressCallback(std::function<void(const LoadProgress_t&)> fn, std::chrono::milliseconds interval = std::chrono::milliseconds(1000))
+    {
+      this->m_progress = fn;
+      this->m_progressInterval = interval;
+    }
+
+    LoadProgress_t load(const std::string& filename)
+    {
+      std::ifstream input(filename, std::ios::binary | std::ios::ate);
+      if (!input) {
+        throw std::runtime_error("cannot open dictionary file '" + filename + "'");
+      }
+
+      std::size_t totalBytes = static_cast<std::size_t>(input.tellg());
+      input.seekg(0);
+      return load(input, totalBytes);
+    }
+
+    // the trie must not be queried nor modified by anyone else until the load returns, and it must not run on a task of the pool
+    LoadProgress_t load(std::istream& input, std::size_t totalBytes = 0)
+    {
+      auto start = std::chrono::steady_clock::now();
+      auto lastReport = start;
+      LoadProgress_t progress;
+      progress.totalBytes = totalBytes;
+
+      std::string line;
+      unsigned int code;
+
+      while (std::getline(input, line)) {
+        progress.lines++;
+        progress.bytesRead += line.size() + 1;
+
+        if (!line.empty() && line.back() == '\r') {
+          line.pop_back();
+        }
+
+        if (appendLine(line, code) && m_filling[code].records.size() >= m_batchSize) {
+          dispatch(code);
+        }
+
+        if ((progress.lines & 0xFFF) == 0 && std::chrono::steady_clock::now() - lastReport >= m_progressInterval) {
+          lastReport = std::chrono::steady_clock::now();
+          report(progress, start);
+        }
+      }
+
+      for (unsigned int i = 0; i < m_filling.size(); i++) {
+        dispatch(i);
+      }
+
+      {
+        std::unique_lock<std::mutex> guard(m_stateLock);
+        m_batchDone.wait(guard, [this] { return m_inFlight == 0 && m_drains == 0; });
+        if (m_error) {
+          std::exception_ptr error = m_error;
+          m_error = nullptr;
+          m_wordsInserted = 0;
+          m_shards.clear();
+          m_filling.clear();
+          std::rethrow_exception(error);
+        }
+      }
+
+      progress.phase = kLoadSplicing;
+      report(progress, start);
+      for (auto& current : m_shards) {
+        if (current) {
+          m_trie.mergeShard(current->nodes);
+        }
+      }
+      m_shards.clear();
+      m_filling.clear();
+
+      progress.phase = kLoadIndexing;
+      report(progress, start);
+      m_trie.buildActiveNodeSet(m_onlyFinalWords);
+
+      progress.phase = kLoadDone;
+      report(progress, start);
+      m_wordsInserted = 0;
+      return progress;
+    }
+  };
+
+  typedef BasicBulkLoader_t<PointerNodeStore_t> BulkLoader_t;
+  typedef BasicBulkLoader_t<ArenaNodeStore_t> ArenaBulkLoader_t;
+  typedef BasicBulkLoader_t<RadixNodeStore_t> RadixBulkLoader_t;
+}
+#endif
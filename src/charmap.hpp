@@ -0,0 +1,108 @@
+#ifndef _ZYNTHETIC_CHARMAP_
+#define _ZYNTHETIC_CHARMAP_
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "utf8.hpp"
+
+namespace trie {
+
+  // base letter of a Latin-1 character, lowercase and without accents ('É' -> 'e', 'ß' -> 's'); other characters are kept
+  inline uint32_t foldLatin1(uint32_t character)
+  {
+    static const char accented[] = "aaaaaaaceeeeiiiidnooooo\xD7ouuuuy\xDEsaaaaaaaceeeeiiiidnooooo\xF7ouuuuy\xFEy"; // U+00C0 .. U+00FF
+
+    if (character >= 'A' && character <= 'Z') {
+      return character + ('a' - 'A');
+    }
+    if (character >= 0xC0 && character <= 0xFF) {
+      return static_cast<unsigned char>(accented[character - 0xC0]);
+    }
+    return character;
+  }
+
+  /*
+  ** Character -> charmap code. ASCII and Latin-1 are answered by a dense table, the few characters above U+00FF that the
+  ** charmap defines by a hash map. A Latin-1 character the charmap leaves out takes the code of its folded form (see
+  ** `foldLatin1`), so `encode` decodes, folds case and accents, and maps every character on a single pass with a single lookup.
+  ** Characters without a code map to 0.
+  */
+  class CharMap_t {
+    uint32_t m_dense[256]; // code of every Latin-1 character, folded ones included
+    bool m_defined[256]; // the dense entries given by `define` (the others are folded)
+    std::unordered_map<uint32_t, uint32_t> m_sparse; // characters above U+00FF
+
+    void refold()
+    {
+      for (uint32_t character = 0; character < 256; character++) {
+        if (!m_defined[character]) {
+          uint32_t folded = foldLatin1(character);
+          m_dense[character] = m_defined[folded] ? m_dense[folded] : 0;
+        }
+      }
+    }
+
+  public:
+    CharMap_t()
+    {
+      for (uint32_t character = 0; character < 256; character++) {
+        m_dense[character] = 0;
+        m_defined[character] = false;
+      }
+    }
+
+    // gives a code to the character, unless it already has one
+    void define(uint32_t character, uint32_t code)
+    {
+      if (character >= 256) {
+        m_sparse.emplace(character, code);
+        return;
+      }
+
+      if (!m_defined[character]) {
+        m_defined[character] = true;
+        m_dense[character] = code;
+        refold();
+      }
+    }
+
+    uint32_t code(uint32_t character) const
+    {
+      if (character < 256) {
+        return m_dense[character];
+      }
+
+      auto code = m_sparse.find(character);
+      return code != m_sparse.end() ? code->second : 0;
+    }
+
+    // fn(uint32_t code) for every character of an UTF-8 string
+    template <typename Fn>
+    void encode(const char* data, std::size_t size, Fn fn) const
+    {
+      forEachCodePoint(data, size, [&](uint32_t character) { fn(code(character)); });
+    }
+
+    void encode(const std::string& str, std::vector<unsigned int>& codes) const
+    {
+      codes.clear();
+      encode(str.data(), str.size(), [&](uint32_t code) { codes.push_back(code); });
+    }
+
+    // fn(uint32_t character, uint32_t code) for the characters given to `define`
+    template <typename Fn>
+    void forEachDefined(Fn fn) const
+    {
+      for (uint32_t character = 0; character < 256; character++) {
+        if (m_defined[character]) {
+          fn(character, m_dense[character]);
+        }
+      }
+      for (auto& character : m_sparse) {
+        fn(character.first, character.second);
+      }
+    }
+  };
+}
+#endif
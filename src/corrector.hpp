@@ -0,0 +1,443 @@
+#ifndef _ZYNTHETIC_CORRECTOR_
+#define _ZYNTHETIC_CORRECTOR_
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "thread_pool.hpp"
+#include "trie.hpp"
+#include "utf8.hpp"
+
+namespace trie {
+
+  // what a correction run did, every token being counted once on the first five fields after `tokens`
+  struct CorrectionStats_t {
+    std::size_t bytes; // text read
+    std::size_t tokens; // words of the text
+    std::size_t shortTokens; // shorter than IGNORE_WORD_LENGTH, copied
+    std::size_t stopwords; // copied
+    std::size_t exact; // words of the trie, copied
+    std::size_t corrected; // replaced by the closest value of the trie
+    std::size_t unknown; // nothing within the fuzzy threshold, copied
+    std::size_t lookups; // tokens sent to the trie, the repeated ones are answered by the memo
+    double seconds;
+
+    CorrectionStats_t()
+    : bytes(0)
+    , tokens(0)
+    , shortTokens(0)
+    , stopwords(0)
+    , exact(0)
+    , corrected(0)
+    , unknown(0)
+    , lookups(0)
+    , seconds(0)
+    {
+    }
+
+    CorrectionStats_t& operator+=(const CorrectionStats_t& other)
+    {
+      bytes += other.bytes;
+      tokens += other.tokens;
+      shortTokens += other.shortTokens;
+      stopwords += other.stopwords;
+      exact += other.exact;
+      corrected += other.corrected;
+      unknown += other.unknown;
+      lookups += other.lookups;
+      return *this;
+    }
+
+    void print(std::ostream& out) const
+    {
+      out << "[correct] bytes=" << bytes
+          << " tokens=" << tokens
+          << " short=" << shortTokens
+          << " stopwords=" << stopwords
+          << " exact=" << exact
+          << " corrected=" << corrected
+          << " unknown=" << unknown
+          << " lookups=" << lookups
+          << " seconds=" << seconds
+          << " mb_per_second=" << (seconds > 0 ? bytes / seconds / (1 << 20) : 0) << '\n';
+    }
+  };
+
+  /*
+  ** Streams text through a trie, replacing every misspelled word by the closest value of the trie and copying everything
+  ** else byte for byte. A token is a run of characters the charmap defines, the ASCII punctuation aside : the charmap gives it
+  ** a code for the queries which hold it, but it ends a word of running text. The short tokens and the stopwords are copied
+  ** without a lookup, the others are searched exactly first and fuzzily (`searchSimilarKeywordTopK`, one result, on a whole
+  ** word engine) only when they are not words of the trie. The verdicts are kept on a memo shared by the chunks, so a word
+  ** is looked up once per text whichever chunk it comes back in.
+  ** The input is read in chunks cut after a separator, each chunk is corrected by a task of the pool and the chunks are
+  ** written in their input order. At most `maxPendingChunks` chunks are in flight, which bounds the memory whatever the
+  ** size of the input.
+  */
+  template <typename Storage>
+  class BasicCorrector_t {
+  public:
+    typedef BasicTrie_t<Storage> Trie_t;
+
+  private:
+    enum Verdict_t {
+      kVerdictExact,
+      kVerdictCorrected,
+      kVerdictUnknown
+    };
+
+    struct Correction_t {
+      Verdict_t verdict;
+      PayloadView_t replacement; // value of the trie for kVerdictCorrected
+    };
+
+    /*
+    ** Part of the memo, the words being spread over the shards by their hash so the tasks of the pool seldom wait for each
+    ** other. A shard answers for the state of the trie it was filled on and empties itself once the trie changed.
+    */
+    struct MemoShard_t {
+      std::mutex lock;
+      std::unordered_map<std::string, Correction_t> verdicts;
+      uint64_t generation;
+
+      MemoShard_t()
+      : generation(0)
+      {
+      }
+    };
+
+    static const std::size_t kMemoShards = 64;
+
+    struct Chunk_t {
+      std::string text;
+      std::string output;
+      CorrectionStats_t stats;
+      std::exception_ptr error;
+      bool done;
+
+      Chunk_t()
+      : done(false)
+      {
+      }
+    };
+
+    const Trie_t& m_trie;
+    ThreadPool_t& m_pool;
+    bool m_latin1Word[256]; // the Latin-1 characters which belong to a token
+    std::unordered_set<std::string> m_stopWords; // lowercase, as `isStopWord` compares them
+    std::size_t m_longestStopWord; // bytes, longer tokens skip the stopword lookup
+    std::size_t m_chunkSize;
+    std::size_t m_maxPendingChunks;
+    FuzzyEngine_t m_engine;
+    std::size_t m_maxMemoWords; // per shard, the words past it are looked up every time
+    mutable std::unique_ptr<MemoShard_t[]> m_memo;
+
+    std::mutex m_stateLock; // guards the `done` flag of the chunks
+    std::condition_variable m_chunkDone;
+
+    bool isWordCharacter(uint32_t character) const
+    {
+      return character < 256 ? m_latin1Word[character] : m_trie.m_tables->characterMap.code(character) != 0;
+    }
+
+    // same answer as `isStopWord`, lowering the token on a reused buffer instead of a copy
+    bool isStopWord(const std::string& token, std::string& lowered) const
+    {
+      if (token.size() > m_longestStopWord) {
+        return false;
+      }
+
+      lowered.resize(token.size());
+      std::transform(token.begin(), token.end(), lowered.begin(), ::tolower);
+      return m_stopWords.find(lowered) != m_stopWords.end();
+    }
+
+    // length of the chunk to process now : up to the last ASCII separator, the partial token after it waits for the next read
+    std::size_t splitPoint(const std::string& text) const
+    {
+      for (std::size_t i = text.size(); i-- > 0;) {
+        unsigned char byte = static_cast<unsigned char>(text[i]);
+        if (byte < 0x80 && !isWordCharacter(byte)) { // an ASCII byte is never inside a multi-byte character
+          return i + 1;
+        }
+      }
+      return text.size(); // a single token longer than the chunk, split it
+    }
+
+    MemoShard_t& memoShard(const std::string& token) const
+    {
+      return m_memo[std::hash<std::string>()(token) % kMemoShards];
+    }
+
+    // verdict of the memo for the token, false when it has none for the current state of the trie
+    bool findVerdict(const std::string& token, Correction_t& correction) const
+    {
+      MemoShard_t& shard = memoShard(token);
+      std::lock_guard<std::mutex> guard(shard.lock);
+      if (shard.generation != m_trie.m_generation) {
+        shard.verdicts.clear();
+        shard.generation = m_trie.m_generation;
+        return false;
+      }
+
+      auto known = shard.verdicts.find(token);
+      if (known == shard.verdicts.end()) {
+        return false;
+      }
+      correction = known->second;
+      return true;
+    }
+
+    void keepVerdict(const std::string& token, const Correction_t& correction) const
+    {
+      MemoShard_t& shard = memoShard(token);
+      std::lock_guard<std::mutex> guard(shard.lock);
+      if (shard.generation == m_trie.m_generation && shard.verdicts.size() < m_maxMemoWords) {
+        shard.verdicts.emplace(token, correction);
+      }
+    }
+
+    // waits for the oldest chunk and writes it, unless a chunk failed already
+    void flushFront(std::deque<std::unique_ptr<Chunk_t>>& pending, std::ostream& out, CorrectionStats_t& total, std::exception_ptr& error)
+    {
+      Chunk_t& chunk = *pending.front();
+      {
+        std::unique_lock<std::mutex> guard(m_stateLock);
+        m_chunkDone.wait(guard, [&] { return chunk.done; });
+      }
+
+      if (chunk.error && !error) {
+        error = chunk.error;
+      }
+      if (!error) {
+        out.write(chunk.output.data(), chunk.output.size());
+        total += chunk.stats;
+      }
+      pending.pop_front();
+    }
+
+  public:
+    BasicCorrector_t(const Trie_t& trie, ThreadPool_t& pool)
+    : m_trie(trie)
+    , m_pool(pool)
+    , m_stopWords(trie.m_tables->stopWords.begin(), trie.m_tables->stopWords.end())
+    , m_longestStopWord(0)
+    , m_chunkSize(1 << 20)
+    , m_maxPendingChunks(2 * pool.size())
+    , m_engine(trie.deletionIndexDistance() >= trie.fuzzyLimitThreshold() ? kEngineDeletions : kEngineAutomaton)
+    , m_maxMemoWords((1 << 20) / kMemoShards)
+    , m_memo(new MemoShard_t[kMemoShards])
+    {
+      for (auto& stopword : m_stopWords) {
+        m_longestStopWord = std::max(m_longestStopWord, stopword.size());
+      }
+      for (uint32_t character = 0; character < 256; character++) {
+        m_latin1Word[character] = trie.m_tables->characterMap.code(character) != 0 && !(character < 0x80 && std::ispunct(character));
+      }
+    }
+
+    // bytes read per chunk (default : 1 MiB)
+    void setChunkSize(std::size_t bytes)
+    {
+      this->m_chunkSize = std::max<std::size_t>(bytes, 1);
+    }
+
+    // chunks read ahead of the output (default : 2 per pool thread)
+    void setMaxPendingChunks(std::size_t chunks)
+    {
+      this->m_maxPendingChunks = std::max<std::size_t>(chunks, 1);
+    }
+
+    /*
+    ** Engine of the fuzzy lookups (default : the deletion index when the trie has one covering its fuzzy threshold, the
+    ** automaton otherwise). The active node engine is the slowest on whole words, it is there to compare with.
+    */
+    void setFuzzyEngine(FuzzyEngine_t engine)
+    {
+      this->m_engine = engine;
+    }
+
+    FuzzyEngine_t fuzzyEngine() const
+    {
+      return this->m_engine;
+    }
+
+    // distinct words the memo keeps (default : 2^20), 0 turning it off
+    void setMaxMemoWords(std::size_t words)
+    {
+      this->m_maxMemoWords = (words + kMemoShards - 1) / kMemoShards;
+    }
+
+    /*
+    ** Appends the corrected `text` to `output`. Every token is looked up once for as long as the trie is not modified : the
+    ** verdicts are kept on the memo for the rest of the text and the following ones, running text repeating most of its words.
+    ** Any amount of threads can correct chunks at the same time.
+    */
+    void correctChunk(const std::string& text, std::string& output, CorrectionStats_t& stats) const
+    {
+      std::vector<PayloadView_t> values;
+      std::vector<TrieResponseView_t> responses;
+      std::string token;
+      std::string lowered;
+
+      const unsigned char* begin = reinterpret_cast<const unsigned char*>(text.data());
+      const unsigned char* end = begin + text.size();
+      const unsigned char* current = begin;
+      const unsigned char* copied = begin; // the text up to here is on the output already
+
+      output.reserve(output.size() + text.size() + text.size() / 16);
+      stats.bytes += text.size();
+
+      while (current != end) {
+        const unsigned char* tokenBegin = current;
+        if (!isWordCharacter(nextCodePoint(current, end))) {
+          continue;
+        }
+
+        std::size_t characters = 1;
+        for (const unsigned char* next = current; next != end && isWordCharacter(nextCodePoint(next, end)); current = next) {
+          characters++;
+        }
+
+        stats.tokens++;
+        if (characters < IGNORE_WORD_LENGTH) {
+          stats.shortTokens++;
+          continue;
+        }
+
+        token.assign(tokenBegin, current);
+        if (isStopWord(token, lowered)) {
+          stats.stopwords++;
+          continue;
+        }
+
+        Correction_t correction = { kVerdictUnknown, PayloadView_t() };
+        if (!findVerdict(token, correction)) {
+          if (m_trie.searchKeyword(token, values)) {
+            correction.verdict = kVerdictExact;
+          } else {
+            m_trie.searchSimilarKeywordTopK(token, 1, responses, m_engine);
+            if (!responses.empty()) {
+              correction = { kVerdictCorrected, responses.front().value };
+            }
+          }
+          stats.lookups++;
+          keepVerdict(token, correction);
+        }
+
+        switch (correction.verdict) {
+          case kVerdictExact:
+            stats.exact++;
+            break;
+          case kVerdictUnknown:
+            stats.unknown++;
+            break;
+          case kVerdictCorrected:
+            stats.corrected++;
+            output.append(reinterpret_cast<const char*>(copied), tokenBegin - copied);
+            output.append(correction.replacement.data, correction.replacement.size);
+            copied = current;
+            break;
+        }
+      }
+
+      output.append(reinterpret_cast<const char*>(copied), end - copied);
+    }
+
+    std::string correctText(const std::string& text) const
+    {
+      std::string output;
+      CorrectionStats_t stats;
+      correctChunk(text, output, stats);
+      return output;
+    }
+
+    CorrectionStats_t correct(const std::string& filename, std::ostream& out)
+    {
+      std::ifstream input(filename, std::ios::binary);
+      if (!input) {
+        throw std::runtime_error("cannot open text file '" + filename + "'");
+      }
+      return correct(input, out);
+    }
+
+    // the trie must not be modified until it returns, and it must not run on a task of the pool
+    CorrectionStats_t correct(std::istream& in, std::ostream& out)
+    {
+      auto start = std::chrono::steady_clock::now();
+      std::deque<std::unique_ptr<Chunk_t>> pending;
+      std::exception_ptr error;
+      CorrectionStats_t total;
+      std::string carry; // partial token at the end of the previous read
+
+      while (!error && in) {
+        std::unique_ptr<Chunk_t> chunk(new Chunk_t());
+        chunk->text.swap(carry);
+
+        std::size_t kept = chunk->text.size();
+        chunk->text.resize(kept + m_chunkSize);
+        in.read(&chunk->text[kept], m_chunkSize);
+        chunk->text.resize(kept + static_cast<std::size_t>(in.gcount()));
+
+        if (in) { // more to come
+          std::size_t cut = splitPoint(chunk->text);
+          carry.assign(chunk->text, cut, std::string::npos);
+          chunk->text.resize(cut);
+        }
+        if (chunk->text.empty()) {
+          continue;
+        }
+
+        if (pending.size() >= m_maxPendingChunks) {
+          flushFront(pending, out, total, error);
+        }
+
+        Chunk_t* current = chunk.get();
+        pending.push_back(std::move(chunk));
+        m_pool.submit([this, current] {
+          try {
+            correctChunk(current->text, current->output, current->stats);
+          } catch (...) {
+            current->error = std::current_exception();
+          }
+
+          std::lock_guard<std::mutex> guard(m_stateLock);
+          current->done = true;
+          m_chunkDone.notify_all();
+        });
+      }
+
+      while (!pending.empty()) { // the tasks point to the chunks, wait for every one of them
+        flushFront(pending, out, total, error);
+      }
+      if (error) {
+        std::rethrow_exception(error);
+      }
+      if (in.bad()) {
+        throw std::runtime_error("error while reading the text");
+      }
+
+      out.flush();
+      total.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      return total;
+    }
+  };
+
+  typedef BasicCorrector_t<PointerNodeStore_t> Corrector_t;
+  typedef BasicCorrector_t<ArenaNodeStore_t> ArenaCorrector_t;
+  typedef BasicCorrector_t<MappedNodeStore_t> MappedCorrector_t;
+  typedef BasicCorrector_t<RadixNodeStore_t> RadixCorrector_t;
+  typedef BasicCorrector_t<DawgNodeStore_t> FrozenCorrector_t;
+}
+#endif
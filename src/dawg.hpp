@@ -0,0 +1,446 @@
+#ifndef _ZYNTHETIC_DAWG_
+#define _ZYNTHETIC_DAWG_
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "arena.hpp"
+#include "payload.hpp"
+
+namespace trie {
+
+  // state of the minimized automaton : every prefix of the trie whose completions are the same words leads to it
+  struct DawgState_t {
+    uint32_t firstEdge; // offset of the children block on the edge array
+    uint16_t edgeCount;
+    uint16_t isFinal; // the state ends a word
+    uint32_t words; // words accepted from the state, the empty one included when it is final
+    WordDepths_t wordDepths; // depths of the accepted words, the same for every prefix leading to the state
+  };
+
+  struct DawgEdge_t {
+    uint32_t code; // character code, the children block is sorted by it
+    uint32_t state;
+  };
+
+  /*
+  ** A prefix of the frozen trie, only held while walking : its state, the id of the first word starting with it (its own
+  ** when it is a word) and its length. The words of a prefix are consecutive ids, so the word is counted on the way down
+  ** from the words of the states of the lower edges, and no two prefixes have the same first word and length.
+  */
+  struct DawgNode_t {
+    uint32_t state;
+    uint32_t word;
+    uint32_t depth;
+    uint32_t code; // character code of the edge which leads to the prefix
+
+    bool operator==(const DawgNode_t& other) const
+    {
+      return word == other.word && depth == other.depth;
+    }
+
+    bool operator!=(const DawgNode_t& other) const
+    {
+      return !(*this == other);
+    }
+
+    // the preorder of the trie the automaton was built from
+    bool operator<(const DawgNode_t& other) const
+    {
+      return word != other.word ? word < other.word : depth < other.depth;
+    }
+  };
+
+  /*
+  ** Read-only node storage compiled from a whole trie (see `BasicTrie_t::freeze`) : the minimized automaton of its words,
+  ** where the prefixes with the same completions share one state, so the common suffixes are stored once. Only the states
+  ** and their transitions are stored; a node is a prefix handle (`DawgNode_t`) computed on the way down.
+  ** The words are numbered in lexicographic order of their codes, which is the order the walk meets them in, a child taking
+  ** the first word of its parent plus the words of the parent itself and of its lower siblings (the perfect hash numbering
+  ** of the minimized automata). The id of a prefix is its rank on the preorder of the source trie, where the prefixes
+  ** starting with the same first word come one after the other by length : it is that length plus a base kept per word.
+  ** Their values
+  ** live on a side table indexed by word id, and the best score below a prefix is a range maximum over the scores of its
+  ** words (the ones of a prefix are consecutive ids), answered by a sparse table over blocks of words.
+  */
+  class DawgNodeStore_t {
+    static const uint32_t kScoreBlock = 32; // words per block of the range maximum
+
+    std::vector<DawgState_t> m_states;
+    std::vector<DawgEdge_t> m_edges;
+    uint32_t m_root;
+    std::vector<uint32_t> m_prefixBases; // m_prefixBases[word] : id of a prefix whose first word it is, minus its length
+    uint32_t m_nodeCount; // prefixes of the source trie
+    std::vector<uint32_t> m_firstValues; // m_firstValues[word] : first value of the word on m_values, one entry past the last word
+    std::vector<PayloadRef_t> m_values;
+    PayloadArena_t m_payloads; // the same ids as on the source trie
+    std::vector<uint32_t> m_wordScores; // highest score of every word
+    std::vector<std::vector<uint32_t>> m_blockScores; // m_blockScores[k][b] : highest score of the blocks [b, b + 2^k)
+
+    const DawgEdge_t* findEdge(const DawgState_t& state, uint32_t code) const
+    {
+      const DawgEdge_t* begin = m_edges.data() + state.firstEdge;
+      const DawgEdge_t* end = begin + state.edgeCount;
+
+      if (state.edgeCount <= 8) { // small blocks : a linear scan beats the binary search
+        for (; begin != end && begin->code < code; begin++) {
+        }
+        return begin;
+      }
+      return std::lower_bound(begin, end, code, [](const DawgEdge_t& edge, uint32_t val) { return edge.code < val; });
+    }
+
+    // the state of `final` with these children (codes ascending), shared with an equal one built before
+    uint32_t makeState(bool final, const std::pair<unsigned int, uint32_t>* children, std::size_t count, std::unordered_map<std::u32string, uint32_t>& registry)
+    {
+      std::u32string signature(1, final);
+      for (std::size_t i = 0; i < count; i++) {
+        signature += static_cast<char32_t>(children[i].first);
+        signature += static_cast<char32_t>(children[i].second);
+      }
+
+      auto found = registry.find(signature);
+      if (found != registry.end()) {
+        return found->second;
+      }
+
+      DawgState_t state;
+      state.firstEdge = static_cast<uint32_t>(m_edges.size());
+      state.edgeCount = static_cast<uint16_t>(count);
+      state.isFinal = final;
+      state.words = final;
+      if (final) {
+        state.wordDepths = WordDepths_t::endOfWord();
+      }
+
+      for (std::size_t i = 0; i < count; i++) {
+        const DawgState_t& child = m_states[children[i].second];
+        m_edges.push_back({ children[i].first, children[i].second });
+        state.words += child.words;
+        state.wordDepths.widen(child.wordDepths, 1);
+      }
+
+      m_states.push_back(state);
+      registry.emplace(signature, static_cast<uint32_t>(m_states.size() - 1));
+      return static_cast<uint32_t>(m_states.size() - 1);
+    }
+
+    // renumbers the states breadth first from the root, their edge blocks following the same order, so the states of the
+    // children of a state are mostly consecutive (the ones shared with an earlier parent stay where they were first met)
+    void repack()
+    {
+      std::vector<uint32_t> order(1, m_root);
+      std::vector<uint32_t> ids(m_states.size(), UINT32_MAX);
+      ids[m_root] = 0;
+
+      for (std::size_t head = 0; head < order.size(); head++) {
+        const DawgState_t& state = m_states[order[head]];
+        for (uint32_t i = state.firstEdge; i < state.firstEdge + state.edgeCount; i++) {
+          if (ids[m_edges[i].state] == UINT32_MAX) {
+            ids[m_edges[i].state] = static_cast<uint32_t>(order.size());
+            order.push_back(m_edges[i].state);
+          }
+        }
+      }
+
+      std::vector<DawgState_t> states;
+      std::vector<DawgEdge_t> edges;
+      states.reserve(order.size());
+      edges.reserve(m_edges.size());
+
+      for (uint32_t old : order) {
+        states.push_back(m_states[old]);
+        states.back().firstEdge = static_cast<uint32_t>(edges.size());
+        for (uint32_t i = m_states[old].firstEdge; i < m_states[old].firstEdge + m_states[old].edgeCount; i++) {
+          edges.push_back(m_edges[i]);
+          edges.back().state = ids[m_edges[i].state];
+        }
+      }
+
+      m_states.swap(states);
+      m_edges.swap(edges);
+      m_root = 0;
+    }
+
+    void buildScoreTable()
+    {
+      std::vector<uint32_t> blocks((m_wordScores.size() + kScoreBlock - 1) / kScoreBlock, 0);
+      for (std::size_t i = 0; i < m_wordScores.size(); i++) {
+        blocks[i / kScoreBlock] = std::max(blocks[i / kScoreBlock], m_wordScores[i]);
+      }
+
+      m_blockScores.push_back(std::move(blocks));
+      for (std::size_t span = 2; span <= m_blockScores[0].size(); span *= 2) {
+        const std::vector<uint32_t>& below = m_blockScores.back();
+        std::vector<uint32_t> level(m_blockScores[0].size() - span + 1);
+        for (std::size_t b = 0; b < level.size(); b++) {
+          level[b] = std::max(below[b], below[b + span / 2]);
+        }
+        m_blockScores.push_back(std::move(level));
+      }
+    }
+
+    // highest score of the words [begin, end)
+    unsigned int rangeScore(uint32_t begin, uint32_t end) const
+    {
+      uint32_t best = 0;
+      uint32_t firstBlock = (begin + kScoreBlock - 1) / kScoreBlock;
+      uint32_t lastBlock = end / kScoreBlock;
+
+      if (firstBlock >= lastBlock) {
+        for (uint32_t i = begin; i < end; i++) {
+          best = std::max(best, m_wordScores[i]);
+        }
+        return best;
+      }
+
+      for (uint32_t i = begin; i < firstBlock * kScoreBlock; i++) {
+        best = std::max(best, m_wordScores[i]);
+      }
+      for (uint32_t i = lastBlock * kScoreBlock; i < end; i++) {
+        best = std::max(best, m_wordScores[i]);
+      }
+
+      int level = 31 - __builtin_clz(lastBlock - firstBlock); // two spans of 2^level blocks cover the whole blocks
+      best = std::max(best, m_blockScores[level][firstBlock]);
+      return std::max(best, m_blockScores[level][lastBlock - (1u << level)]);
+    }
+
+  public:
+    typedef DawgNode_t Node_t;
+
+    /*
+    ** Compiles the words of any node storage, walked once depth first : a node gets its state when its subtree is done,
+    ** from its children states, so equal subtrees meet on the registry bottom up. Every node of the source has to lead to
+    ** a word (the tries prune the others), the first word of a prefix being one it starts.
+    */
+    template <typename Source>
+    explicit DawgNodeStore_t(const Source& source)
+    : m_root(0)
+    , m_nodeCount(0)
+    {
+      typedef typename Source::Node_t SourceNode_t;
+
+      struct Frame_t {
+        SourceNode_t node;
+        std::size_t first; // children of the node on `children`, [first, end)
+        std::size_t end;
+        std::size_t next; // next child to walk
+      };
+
+      std::vector<std::pair<unsigned int, SourceNode_t>> children; // (code, node) of the children of the frames
+      std::vector<std::pair<unsigned int, uint32_t>> states; // (code, state) of the children walked already
+      std::vector<Frame_t> frames;
+      std::unordered_map<std::u32string, uint32_t> registry;
+
+      for (std::size_t id = 0; id < source.payloadCount(); id++) {
+        m_payloads.intern(source.payload(static_cast<uint32_t>(id)));
+      }
+
+      auto enter = [&](SourceNode_t node) {
+        if (m_wordScores.size() == m_prefixBases.size()) { // the first prefix met whose first word is the next one
+          m_prefixBases.push_back(m_nodeCount - static_cast<uint32_t>(frames.size()));
+        }
+        m_nodeCount++;
+
+        if (source.isEndOfWord(node)) { // preorder with the children ascending : the lexicographic order of the words
+          uint32_t best = 0;
+          m_firstValues.push_back(static_cast<uint32_t>(m_values.size()));
+          source.forEachValue(node, [&](PayloadView_t value, unsigned int score) {
+            m_values.push_back({ m_payloads.intern(value), score });
+            best = std::max<uint32_t>(best, score);
+          });
+          m_wordScores.push_back(best);
+        }
+
+        std::size_t first = children.size();
+        source.forEachChild(node, [&](SourceNode_t child) { children.emplace_back(source.getContent(child), child); });
+        std::sort(children.begin() + first, children.end(), [](const std::pair<unsigned int, SourceNode_t>& c1, const std::pair<unsigned int, SourceNode_t>& c2) {
+          return c1.first < c2.first;
+        });
+        states.resize(children.size());
+        frames.push_back({ node, first, children.size(), first });
+      };
+
+      enter(source.root());
+      while (!frames.empty()) {
+        Frame_t& frame = frames.back();
+        if (frame.next < frame.end) {
+          std::size_t child = frame.next++;
+          states[child].first = children[child].first;
+          enter(children[child].second);
+          continue;
+        }
+
+        uint32_t state = makeState(source.isEndOfWord(frame.node), states.data() + frame.first, frame.end - frame.first, registry);
+        children.resize(frame.first);
+        states.resize(frame.first);
+        frames.pop_back();
+
+        if (frames.empty()) {
+          m_root = state;
+        } else {
+          states[frames.back().next - 1].second = state;
+        }
+      }
+
+      m_firstValues.push_back(static_cast<uint32_t>(m_values.size()));
+      repack();
+      buildScoreTable();
+      m_values.shrink_to_fit();
+      m_firstValues.shrink_to_fit();
+      m_wordScores.shrink_to_fit();
+      m_prefixBases.shrink_to_fit();
+    }
+
+    static Node_t nullNode()
+    {
+      return { UINT32_MAX, UINT32_MAX, UINT32_MAX, 0 };
+    }
+
+    Node_t root() const
+    {
+      return { m_root, 0, 0, 0 };
+    }
+
+    Node_t getChild(Node_t node, unsigned int value) const
+    {
+      const DawgState_t& current = m_states[node.state];
+      const DawgEdge_t* edge = findEdge(current, value);
+
+      if (edge == m_edges.data() + current.firstEdge + current.edgeCount || edge->code != value) {
+        return nullNode();
+      }
+
+      uint32_t word = node.word + current.isFinal;
+      for (const DawgEdge_t* lower = m_edges.data() + current.firstEdge; lower != edge; lower++) {
+        word += m_states[lower->state].words;
+      }
+      return { edge->state, word, node.depth + 1, edge->code };
+    }
+
+    Node_t insertNReturnChild(Node_t, unsigned int)
+    {
+      throw std::logic_error("a frozen trie is read-only");
+    }
+
+    template <typename Fn>
+    void forEachChild(Node_t node, Fn fn) const
+    {
+      const DawgState_t& current = m_states[node.state];
+      const DawgEdge_t* edge = m_edges.data() + current.firstEdge;
+      uint32_t word = node.word + current.isFinal;
+
+      for (const DawgEdge_t* end = edge + current.edgeCount; edge != end; edge++) {
+        fn(Node_t{ edge->state, word, node.depth + 1, edge->code });
+        word += m_states[edge->state].words;
+      }
+    }
+
+    unsigned int getContent(Node_t node) const
+    {
+      return node.code;
+    }
+
+    uint32_t getId(Node_t node) const
+    {
+      return m_prefixBases[node.word] + node.depth;
+    }
+
+    bool isEndOfWord(Node_t node) const
+    {
+      return m_states[node.state].isFinal;
+    }
+
+    void addValue(Node_t, PayloadView_t, unsigned int)
+    {
+      throw std::logic_error("a frozen trie is read-only");
+    }
+
+    template <typename Fn>
+    void forEachValue(Node_t node, Fn fn) const
+    {
+      if (m_states[node.state].isFinal) {
+        for (uint32_t i = m_firstValues[node.word]; i < m_firstValues[node.word + 1]; i++) {
+          fn(m_payloads.get(m_values[i].id), m_values[i].score);
+        }
+      }
+    }
+
+    PayloadView_t payload(uint32_t id) const
+    {
+      return m_payloads.get(id);
+    }
+
+    std::size_t payloadCount() const
+    {
+      return m_payloads.size();
+    }
+
+    unsigned int getMaxScore(Node_t node) const
+    {
+      return rangeScore(node.word, node.word + m_states[node.state].words);
+    }
+
+    void raiseMaxScore(Node_t, unsigned int)
+    {
+      throw std::logic_error("a frozen trie is read-only");
+    }
+
+    WordDepths_t getWordDepths(Node_t node) const
+    {
+      return m_states[node.state].wordDepths;
+    }
+
+    void widenWordDepths(Node_t, WordDepths_t, std::size_t)
+    {
+      throw std::logic_error("a frozen trie is read-only");
+    }
+
+    // bound of the node ids : the prefixes of the source trie
+    std::size_t nodeCount() const
+    {
+      return m_nodeCount;
+    }
+
+    // amount of words, which are also the word ids
+    std::size_t wordCount() const
+    {
+      return m_states[m_root].words;
+    }
+
+    void shrinkToFit()
+    {
+    }
+
+    // the nodes are the states (with the prefix bases), the value table and the score maximums are counted with the payloads
+    MemoryUsage_t memoryUsage() const
+    {
+      MemoryUsage_t usage;
+      usage.nodes = m_states.size();
+      usage.edges = m_edges.size();
+      usage.nodeBytes = m_states.capacity() * sizeof(DawgState_t) + m_prefixBases.capacity() * sizeof(uint32_t);
+      usage.edgeBytes = m_edges.capacity() * sizeof(DawgEdge_t);
+      usage.payloadBytes = m_payloads.memoryUsage() + m_values.capacity() * sizeof(PayloadRef_t) + (m_firstValues.capacity() + m_wordScores.capacity()) * sizeof(uint32_t);
+      for (const std::vector<uint32_t>& level : m_blockScores) {
+        usage.payloadBytes += level.capacity() * sizeof(uint32_t);
+      }
+      return usage;
+    }
+  };
+}
+
+namespace std {
+  template <>
+  struct hash<trie::DawgNode_t> {
+    std::size_t operator()(const trie::DawgNode_t& node) const
+    {
+      return std::hash<uint64_t>()((uint64_t(node.word) << 32) | node.depth);
+    }
+  };
+}
+#endif
@@ -0,0 +1,324 @@
+#ifndef _ZYNTHETIC_DELETION_INDEX_
+#define _ZYNTHETIC_DELETION_INDEX_
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "scratch.hpp"
+
+namespace trie {
+
+  /*
+  ** Symmetric deletion index (SymSpell) over the words of a trie, taken as their character codes : every word is filed
+  ** under each string left by deleting up to `maxDistance` of its characters. Two words within d edits of each other leave
+  ** a common string after at most d deletions on each side (a substitution being a deletion on both), so a query only
+  ** looks up its own deletions and verifies the words filed there with an exact, bounded Levenshtein distance.
+  ** A query costs a few probes instead of a node set per character, the price being tens of postings per word.
+  ** The deletions are filed by a 32-bit hash, a collision only costing a verification.
+  */
+  class DeletionIndex_t {
+    static const uint32_t kNone = UINT32_MAX;
+
+    struct Bucket_t {
+      uint32_t hash; // 0 for a free bucket
+      uint32_t head; // first posting of the deletion, kNone once its words are all removed
+    };
+
+    struct Posting_t {
+      uint32_t word;
+      uint32_t next;
+    };
+
+    // per-thread working memory of `forEachMatch`
+    struct Scratch_t {
+      std::u32string query;
+      std::u32string deletion;
+      std::vector<uint32_t> hashes;
+      StampedIndex_t candidates; // words verified already
+      std::vector<int> row;
+    };
+
+    int m_maxDistance;
+    std::vector<Bucket_t> m_buckets; // linear probing, a power of two at most 3/4 full
+    std::size_t m_deletions; // buckets in use
+    std::vector<Posting_t> m_postings;
+    uint32_t m_freePostings; // chained through `next`
+    std::vector<std::u32string> m_words; // codes of every word by id, empty on the free ids
+    std::vector<uint32_t> m_freeWords;
+    std::unordered_map<std::u32string, uint32_t> m_ids;
+    std::vector<uint32_t> m_hashes; // deletions of the word being filed or removed
+
+    static Scratch_t& threadScratch()
+    {
+      static thread_local Scratch_t scratch;
+      return scratch;
+    }
+
+    static uint32_t hashOf(const std::u32string& codes)
+    {
+      uint64_t hash = 14695981039346656037ull; // FNV-1a over the codes, then the splitmix64 finalizer for the low bits
+      for (char32_t code : codes) {
+        hash = (hash ^ code) * 1099511628211ull;
+      }
+      hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+      hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+      hash ^= hash >> 31;
+      return static_cast<uint32_t>(hash) ? static_cast<uint32_t>(hash) : 1;
+    }
+
+    /*
+    ** Hashes of `codes` and of every string left by deleting up to `distance` of its codes at positions >= `from`, sorted
+    ** and without duplicates once `uniqueDeletions` is done. Deleting either one of a run of equal codes gives the same
+    ** string, only the first one of a run is tried.
+    */
+    static void collectDeletions(std::u32string& codes, std::size_t from, int distance, std::vector<uint32_t>& hashes)
+    {
+      hashes.push_back(hashOf(codes));
+      if (distance == 0) {
+        return;
+      }
+
+      for (std::size_t i = from; i < codes.size(); i++) {
+        if (i > from && codes[i] == codes[i - 1]) {
+          continue;
+        }
+        char32_t removed = codes[i];
+        codes.erase(i, 1);
+        collectDeletions(codes, i, distance - 1, hashes);
+        codes.insert(codes.begin() + i, removed);
+      }
+    }
+
+    static void uniqueDeletions(std::vector<uint32_t>& hashes)
+    {
+      std::sort(hashes.begin(), hashes.end());
+      hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+    }
+
+    // bucket holding the hash, or the free one where it would go
+    std::size_t probe(uint32_t hash) const
+    {
+      std::size_t mask = m_buckets.size() - 1;
+      std::size_t i = hash & mask;
+      while (m_buckets[i].hash != 0 && m_buckets[i].hash != hash) {
+        i = (i + 1) & mask;
+      }
+      return i;
+    }
+
+    void grow()
+    {
+      std::vector<Bucket_t> buckets(std::max<std::size_t>(m_buckets.size() * 2, 64), Bucket_t{ 0, kNone });
+      buckets.swap(m_buckets);
+      for (const Bucket_t& bucket : buckets) {
+        if (bucket.hash != 0) {
+          m_buckets[probe(bucket.hash)] = bucket;
+        }
+      }
+    }
+
+    void file(uint32_t hash, uint32_t word)
+    {
+      if (4 * (m_deletions + 1) > 3 * m_buckets.size()) {
+        grow();
+      }
+
+      Bucket_t& bucket = m_buckets[probe(hash)];
+      if (bucket.hash == 0) {
+        bucket.hash = hash;
+        m_deletions++;
+      }
+
+      uint32_t posting = m_freePostings;
+      if (posting == kNone) {
+        posting = static_cast<uint32_t>(m_postings.size());
+        m_postings.push_back(Posting_t());
+      } else {
+        m_freePostings = m_postings[posting].next;
+      }
+      m_postings[posting] = { word, bucket.head };
+      bucket.head = posting;
+    }
+
+    // the bucket stays, an emptied deletion is simply found without words
+    void unfile(uint32_t hash, uint32_t word)
+    {
+      Bucket_t& bucket = m_buckets[probe(hash)];
+      for (uint32_t* link = &bucket.head; *link != kNone; link = &m_postings[*link].next) {
+        if (m_postings[*link].word == word) {
+          uint32_t posting = *link;
+          *link = m_postings[posting].next;
+          m_postings[posting].next = m_freePostings;
+          m_freePostings = posting;
+          return;
+        }
+      }
+    }
+
+    // Levenshtein distance between the two words, bound + 1 as soon as it is known to be over `bound`
+    static int boundedDistance(const std::u32string& source, const std::u32string& target, int bound, std::vector<int>& row)
+    {
+      row.resize(target.size() + 1);
+      for (std::size_t j = 0; j <= target.size(); j++) {
+        row[j] = static_cast<int>(j);
+      }
+
+      for (std::size_t i = 1; i <= source.size(); i++) {
+        int diagonal = row[0];
+        int best = row[0] = static_cast<int>(i);
+        for (std::size_t j = 1; j <= target.size(); j++) {
+          int above = row[j];
+          row[j] = std::min(std::min(above, row[j - 1]) + 1, diagonal + (source[i - 1] != target[j - 1]));
+          diagonal = above;
+          best = std::min(best, row[j]);
+        }
+        if (best > bound) { // every later row is at least as far
+          return bound + 1;
+        }
+      }
+      return std::min(row[target.size()], bound + 1);
+    }
+
+  public:
+    explicit DeletionIndex_t(int maxDistance)
+    : m_maxDistance(maxDistance)
+    , m_deletions(0)
+    , m_freePostings(kNone)
+    {
+      if (maxDistance < 0) {
+        throw std::logic_error("the distance of a deletion index cannot be negative");
+      }
+    }
+
+    // highest fuzzy threshold the index answers
+    int maxDistance() const
+    {
+      return m_maxDistance;
+    }
+
+    // amount of words on the index
+    std::size_t size() const
+    {
+      return m_ids.size();
+    }
+
+    // files the word (its character codes), false when it was there already
+    bool insert(const std::vector<unsigned int>& codes)
+    {
+      std::u32string word(codes.begin(), codes.end());
+      if (word.empty() || m_ids.find(word) != m_ids.end()) {
+        return false;
+      }
+
+      uint32_t id = static_cast<uint32_t>(m_words.size());
+      if (m_freeWords.empty()) {
+        m_words.push_back(word);
+      } else {
+        id = m_freeWords.back();
+        m_freeWords.pop_back();
+        m_words[id] = word;
+      }
+      m_ids.emplace(word, id);
+
+      m_hashes.clear();
+      collectDeletions(word, 0, m_maxDistance, m_hashes);
+      uniqueDeletions(m_hashes);
+      for (uint32_t hash : m_hashes) {
+        file(hash, id);
+      }
+      return true;
+    }
+
+    // false when the word is not on the index
+    bool remove(const std::vector<unsigned int>& codes)
+    {
+      std::u32string word(codes.begin(), codes.end());
+      auto found = m_ids.find(word);
+      if (found == m_ids.end()) {
+        return false;
+      }
+
+      uint32_t id = found->second;
+      m_hashes.clear();
+      collectDeletions(word, 0, m_maxDistance, m_hashes);
+      uniqueDeletions(m_hashes);
+      for (uint32_t hash : m_hashes) {
+        unfile(hash, id);
+      }
+
+      m_ids.erase(found);
+      std::u32string().swap(m_words[id]);
+      m_freeWords.push_back(id);
+      return true;
+    }
+
+    /*
+    ** fn(const std::u32string& word, int editDistance) once for every word within `threshold` edits of the query, in no
+    ** particular order. The threshold cannot be over the distance of the index. Concurrent queries are safe as long as
+    ** nobody modifies the index meanwhile.
+    */
+    template <typename Fn>
+    void forEachMatch(const std::vector<unsigned int>& codes, int threshold, Fn fn) const
+    {
+      if (threshold > m_maxDistance) {
+        throw std::logic_error("the deletion index covers " + std::to_string(m_maxDistance) + " edits, the query asks for " + std::to_string(threshold));
+      }
+      if (threshold < 0 || m_buckets.empty()) {
+        return;
+      }
+
+      Scratch_t& scratch = threadScratch();
+      scratch.query.assign(codes.begin(), codes.end());
+      scratch.deletion = scratch.query;
+      scratch.hashes.clear();
+      collectDeletions(scratch.deletion, 0, threshold, scratch.hashes);
+      uniqueDeletions(scratch.hashes);
+      scratch.candidates.reset(m_words.size());
+
+      for (uint32_t hash : scratch.hashes) {
+        const Bucket_t& bucket = m_buckets[probe(hash)];
+        if (bucket.hash == 0) {
+          continue;
+        }
+
+        for (uint32_t posting = bucket.head; posting != kNone; posting = m_postings[posting].next) {
+          uint32_t id = m_postings[posting].word;
+          if (!scratch.candidates.insert(id)) {
+            continue;
+          }
+
+          const std::u32string& word = m_words[id];
+          std::size_t longest = std::max(word.size(), scratch.query.size());
+          if (longest - std::min(word.size(), scratch.query.size()) > static_cast<std::size_t>(threshold)) {
+            continue; // filed under a deeper deletion of the word than the query asks for
+          }
+
+          int distance = boundedDistance(scratch.query, word, threshold, scratch.row);
+          if (distance <= threshold) {
+            fn(word, distance);
+          }
+        }
+      }
+    }
+
+    // estimate of the heap footprint, counted as `MemoryUsage_t::indexBytes`
+    std::size_t memoryUsage() const
+    {
+      const std::size_t mallocOverhead = sizeof(void*) * 2;
+      const std::size_t idEntryBytes = sizeof(std::pair<const std::u32string, uint32_t>) + 2 * sizeof(void*) + mallocOverhead; // node with its cached hash
+
+      std::size_t bytes = m_buckets.capacity() * sizeof(Bucket_t) + m_postings.capacity() * sizeof(Posting_t);
+      bytes += m_words.capacity() * sizeof(std::u32string) + m_freeWords.capacity() * sizeof(uint32_t);
+      bytes += m_ids.bucket_count() * sizeof(void*) + m_ids.size() * idEntryBytes;
+      for (const std::u32string& word : m_words) {
+        if (word.capacity() * sizeof(char32_t) >= sizeof(std::u32string) - sizeof(std::size_t) - sizeof(void*)) { // beyond the inline buffer
+          bytes += 2 * ((word.capacity() + 1) * sizeof(char32_t) + mallocOverhead); // the same codes are the key of `m_ids`
+        }
+      }
+      return bytes;
+    }
+  };
+}
+#endif
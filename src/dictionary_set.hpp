@@ -0,0 +1,286 @@
+#ifndef _ZYNTHETIC_DICTIONARY_SET_
+#define _ZYNTHETIC_DICTIONARY_SET_
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "bulk_loader.hpp"
+#include "text_tables.hpp"
+#include "thread_pool.hpp"
+#include "trie.hpp"
+
+namespace trie {
+
+  // a result of `BasicDictionarySet_t`, with the shard which answered it
+  struct DictionaryResponse_t {
+    std::string content;
+    int editDistance;
+    unsigned int score;
+    std::size_t shard; // index of the shard on the set (see `shardName`)
+
+    DictionaryResponse_t(std::string _content, int _editDistance, unsigned int _score, std::size_t _shard)
+    : content(std::move(_content))
+    , editDistance(_editDistance)
+    , score(_score)
+    , shard(_shard)
+    {
+    }
+  };
+
+  /*
+  ** Several independent tries (one per language, tenant...) answering as one. Every shard has its own charmap and
+  ** stopwords, the shards loaded from the same files sharing a single copy of them (see `loadTables`).
+  **
+  ** A query fans out over the pool to the shards it names (every shard by default), each shard answers its own bounded
+  ** top-k and the results are merged into the best `limit` of them. A shard is replaced as a whole by `publish` or
+  ** `reload` while the others keep answering : a query holds the version of each shard it started on, so it never sees
+  ** a half loaded one, and the previous version is freed once its last query ends.
+  ** The shards are added before the set answers its first query; the queries and the reloads can then run from any thread.
+  */
+  template <typename Storage>
+  class BasicDictionarySet_t {
+  public:
+    typedef BasicTrie_t<Storage> Trie_t;
+
+  private:
+    struct Shard_t {
+      std::string name;
+      std::shared_ptr<const TextTables_t> tables; // given to every trie `reload` builds
+      std::shared_ptr<const Trie_t> trie; // only accessed through std::atomic_load / std::atomic_store
+      std::mutex reloadLock; // one reload of the shard at a time
+    };
+
+    // a result of a shard waiting for the merge
+    struct Candidate_t {
+      int64_t rank; // higher first
+      int editDistance;
+      unsigned int score;
+      uint32_t shard; // position on the shards of the query
+      uint32_t position; // on the results of the shard
+
+      bool operator<(const Candidate_t& other) const
+      {
+        return std::tie(other.rank, editDistance, other.score, shard, position) < std::tie(rank, other.editDistance, score, other.shard, other.position);
+      }
+    };
+
+    ThreadPool_t& m_pool;
+    std::vector<std::unique_ptr<Shard_t>> m_shards;
+    std::unordered_map<std::string, std::size_t> m_names;
+    std::vector<std::size_t> m_everyShard;
+    std::mutex m_tablesLock; // guards m_tables
+    std::map<std::pair<std::string, std::string>, std::weak_ptr<const TextTables_t>> m_tables; // by charmap file and stopword directory
+
+    Shard_t& shard(std::size_t index) const
+    {
+      if (index >= m_shards.size()) {
+        throw std::logic_error("the dictionary set has no shard " + std::to_string(index));
+      }
+      return *m_shards[index];
+    }
+
+    /*
+    ** Runs query(const Trie_t&, std::vector<TrieResponseView_t>&) on a version of every shard, in parallel, and merges the
+    ** results. The views stay valid while the versions are held, so they are only copied out for the best `limit` results.
+    ** The ranked queries are merged on the rank each shard computed (see `setDistancePenalty`), the others by distance.
+    */
+    template <typename Query>
+    std::vector<DictionaryResponse_t> fanOut(const std::vector<std::size_t>& shards, std::size_t limit, bool ranked, Query query) const
+    {
+      std::vector<std::shared_ptr<const Trie_t>> versions(shards.size());
+      std::vector<std::vector<TrieResponseView_t>> partial(shards.size());
+      for (std::size_t i = 0; i < shards.size(); i++) {
+        versions[i] = std::atomic_load(&shard(shards[i]).trie);
+      }
+
+      if (shards.size() == 1) {
+        query(*versions[0], partial[0]);
+      } else {
+        m_pool.parallelFor(shards.size(), [&](std::size_t i) { query(*versions[i], partial[i]); });
+      }
+
+      std::vector<Candidate_t> candidates;
+      for (std::size_t i = 0; i < partial.size(); i++) {
+        int64_t penalty = ranked ? versions[i]->distancePenalty() : 0;
+        for (std::size_t j = 0; j < partial[i].size(); j++) {
+          const TrieResponseView_t& response = partial[i][j];
+          int64_t rank = ranked ? int64_t(response.score) - penalty * response.editDistance : -int64_t(response.editDistance);
+          candidates.push_back({ rank, response.editDistance, response.score, static_cast<uint32_t>(i), static_cast<uint32_t>(j) });
+        }
+      }
+
+      std::size_t kept = std::min(limit, candidates.size());
+      std::partial_sort(candidates.begin(), candidates.begin() + kept, candidates.end());
+
+      std::vector<DictionaryResponse_t> responses;
+      responses.reserve(kept);
+      for (std::size_t i = 0; i < kept; i++) {
+        const Candidate_t& candidate = candidates[i];
+        responses.emplace_back(partial[candidate.shard][candidate.position].value.str(), candidate.editDistance, candidate.score, shards[candidate.shard]);
+      }
+      return responses;
+    }
+
+  public:
+    // the queries fan out over `pool`, which must outlive the set
+    explicit BasicDictionarySet_t(ThreadPool_t& pool)
+    : m_pool(pool)
+    {
+    }
+
+    BasicDictionarySet_t(const BasicDictionarySet_t&) = delete;
+    BasicDictionarySet_t& operator=(const BasicDictionarySet_t&) = delete;
+
+    /*
+    ** The charmap and stopwords of these files (see `TextTables_t::load`), loaded once : the shards asking for the same
+    ** files while a previous load is still in use get the same tables.
+    */
+    std::shared_ptr<const TextTables_t> loadTables(const std::string& charmapFile, const std::string& stopWordDirectory)
+    {
+      std::lock_guard<std::mutex> guard(m_tablesLock);
+      std::weak_ptr<const TextTables_t>& cached = m_tables[std::make_pair(charmapFile, stopWordDirectory)];
+      std::shared_ptr<const TextTables_t> tables = cached.lock();
+      if (!tables) {
+        tables = TextTables_t::load(charmapFile, stopWordDirectory);
+        cached = tables;
+      }
+      return tables;
+    }
+
+    // adds an empty shard on these tables and returns its index, the names being unique
+    std::size_t addShard(const std::string& name, std::shared_ptr<const TextTables_t> tables)
+    {
+      if (m_names.find(name) != m_names.end()) {
+        throw std::logic_error("the dictionary set already has a shard named '" + name + "'");
+      }
+
+      std::unique_ptr<Shard_t> shard(new Shard_t());
+      shard->name = name;
+      shard->trie = std::make_shared<const Trie_t>(tables); // throws on null tables
+      shard->tables = tables;
+
+      m_names.emplace(name, m_shards.size());
+      m_everyShard.push_back(m_shards.size());
+      m_shards.push_back(std::move(shard));
+      return m_shards.size() - 1;
+    }
+
+    std::size_t addShard(const std::string& name, const std::string& charmapFile, const std::string& stopWordDirectory)
+    {
+      return addShard(name, loadTables(charmapFile, stopWordDirectory));
+    }
+
+    std::size_t shardCount() const
+    {
+      return m_shards.size();
+    }
+
+    const std::string& shardName(std::size_t index) const
+    {
+      return shard(index).name;
+    }
+
+    // index of the shard with this name, throws when there is none
+    std::size_t shardIndex(const std::string& name) const
+    {
+      auto found = m_names.find(name);
+      if (found == m_names.end()) {
+        throw std::runtime_error("unknown dictionary '" + name + "'");
+      }
+      return found->second;
+    }
+
+    // the current version of the shard, which stays valid (and unchanged) while it is held
+    std::shared_ptr<const Trie_t> snapshot(std::size_t index) const
+    {
+      return std::atomic_load(&shard(index).trie);
+    }
+
+    bool isStopWord(std::size_t index, const std::string& word) const
+    {
+      return shard(index).tables->isStopWord(word);
+    }
+
+    // replaces the trie of the shard, the queries already running finish on the previous one
+    void publish(std::size_t index, std::shared_ptr<const Trie_t> trie)
+    {
+      if (!trie) {
+        throw std::logic_error("a shard cannot be published without a trie");
+      }
+      std::atomic_store(&shard(index).trie, trie);
+    }
+
+    /*
+    ** Loads the dictionary file (see `BasicBulkLoader_t`) into a new trie on the tables of the shard and publishes it. The
+    ** new trie takes the settings, stats collector, result cache and deletion index distance of the current one.
+    ** The other shards answer meanwhile; it must not run on a task of the pool.
+    */
+    LoadProgress_t reload(std::size_t index, const std::string& filename)
+    {
+      Shard_t& target = shard(index);
+      std::lock_guard<std::mutex> guard(target.reloadLock);
+      std::shared_ptr<const Trie_t> current = std::atomic_load(&target.trie);
+
+      std::shared_ptr<Trie_t> next = std::make_shared<Trie_t>(target.tables);
+      next->setSearchLimitThreshold(current->searchLimitThreshold());
+      next->setFuzzyLimitThreshold(current->fuzzyLimitThreshold());
+      next->setDistancePenalty(current->distancePenalty());
+      next->setStatsCollector(current->statsCollector());
+      next->setResultCache(current->resultCache());
+      if (current->deletionIndexDistance() >= 0) {
+        next->buildDeletionIndex(current->deletionIndexDistance());
+      }
+
+      BasicBulkLoader_t<Storage> loader(*next, m_pool);
+      LoadProgress_t progress = loader.load(filename);
+      publish(index, next);
+      return progress;
+    }
+
+    /*
+    ** The queries of `BasicTrie_t` over the shards named by `shards` (their indexes, every shard when not given) : each
+    ** shard answers at most `limit` results and the best `limit` of all of them are kept, closest first (by rank for
+    ** `autocompleteRanked`), the ties in the order of the shards.
+    */
+    std::vector<DictionaryResponse_t> searchSimilarKeywordTopK(const std::string& keyword, std::size_t limit, const std::vector<std::size_t>& shards, FuzzyEngine_t engine = kEngineActiveNodes) const
+    {
+      return fanOut(shards, limit, false, [&](const Trie_t& trie, std::vector<TrieResponseView_t>& responses) { trie.searchSimilarKeywordTopK(keyword, limit, responses, engine); });
+    }
+
+    std::vector<DictionaryResponse_t> searchSimilarKeywordTopK(const std::string& keyword, std::size_t limit, FuzzyEngine_t engine = kEngineActiveNodes) const
+    {
+      return searchSimilarKeywordTopK(keyword, limit, m_everyShard, engine);
+    }
+
+    std::vector<DictionaryResponse_t> autocompleteTopK(const std::string& keyword, std::size_t limit, const std::vector<std::size_t>& shards) const
+    {
+      return fanOut(shards, limit, false, [&](const Trie_t& trie, std::vector<TrieResponseView_t>& responses) { trie.autocompleteTopK(keyword, limit, responses); });
+    }
+
+    std::vector<DictionaryResponse_t> autocompleteTopK(const std::string& keyword, std::size_t limit) const
+    {
+      return autocompleteTopK(keyword, limit, m_everyShard);
+    }
+
+    std::vector<DictionaryResponse_t> autocompleteRanked(const std::string& keyword, std::size_t limit, const std::vector<std::size_t>& shards) const
+    {
+      return fanOut(shards, limit, true, [&](const Trie_t& trie, std::vector<TrieResponseView_t>& responses) { trie.autocompleteRanked(keyword, limit, responses); });
+    }
+
+    std::vector<DictionaryResponse_t> autocompleteRanked(const std::string& keyword, std::size_t limit) const
+    {
+      return autocompleteRanked(keyword, limit, m_everyShard);
+    }
+  };
+
+  typedef BasicDictionarySet_t<PointerNodeStore_t> DictionarySet_t;
+  typedef BasicDictionarySet_t<ArenaNodeStore_t> ArenaDictionarySet_t;
+  typedef BasicDictionarySet_t<RadixNodeStore_t> RadixDictionarySet_t;
+}
+#endif
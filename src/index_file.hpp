@@ -0,0 +1,429 @@
+#ifndef _ZYNTHETIC_INDEX_FILE_
+#define _ZYNTHETIC_INDEX_FILE_
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include "arena.hpp"
+#include "payload.hpp"
+
+namespace trie {
+
+  /*
+  ** Binary index layout (native byte order, every section aligned to 8 bytes) :
+  **
+  **   IndexHeader_t
+  **   NODES            ArenaNode_t[]          breadth-first order, node 0 is the lambda node, edgeCapacity == edgeCount
+  **   EDGES            ArenaEdge_t[]          sorted children blocks
+  **   VALUE_SLOTS      IndexValueSlot_t[]     per end of word node, range on VALUE_REFS
+  **   VALUE_REFS       IndexValueRef_t[]      payload id and score
+  **   PAYLOADS         IndexPayload_t[]       interned payloads (indexed by id), range on STRINGS
+  **   STRINGS          char[]                 payload bytes, each distinct payload stored once
+  **   CHARMAP          IndexCharacter_t[]     character -> code
+  **   REVERSE_CHARMAP  IndexCharacter_t[]     code -> character
+  **   STOPWORDS        char[]                 '\n' terminated words
+  **   ACTIVE_NODES     IndexActiveNode_t[]    precomputed initial active node set
+  */
+  enum IndexSection_t {
+    kSectionNodes = 0,
+    kSectionEdges,
+    kSectionValueSlots,
+    kSectionValueRefs,
+    kSectionPayloads,
+    kSectionStrings,
+    kSectionCharmap,
+    kSectionReverseCharmap,
+    kSectionStopwords,
+    kSectionActiveNodes,
+    kSectionCount
+  };
+
+  struct IndexSectionEntry_t {
+    uint64_t offset;
+    uint64_t size; // in bytes
+  };
+
+  struct IndexHeader_t {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrderMark;
+    int32_t searchLimitThreshold;
+    int32_t fuzzyLimitThreshold; // the active node set was built with this threshold
+    uint32_t sectionCount;
+    uint32_t flags; // kIndexOnlyFinalWords
+    IndexSectionEntry_t sections[kSectionCount];
+  };
+
+  struct IndexValueSlot_t {
+    uint32_t firstRef;
+    uint32_t count;
+  };
+
+  struct IndexValueRef_t {
+    uint32_t payload;
+    uint32_t score;
+  };
+
+  struct IndexPayload_t {
+    uint64_t offset;
+    uint64_t size;
+  };
+
+  struct IndexCharacter_t {
+    uint32_t character;
+    uint32_t code;
+  };
+
+  struct IndexActiveNode_t {
+    uint32_t node;
+    int32_t editDistance;
+  };
+
+  static const char kIndexMagic[8] = { 'Z', 'Y', 'N', 'T', 'R', 'I', 'E', 0 };
+  static const uint32_t kIndexVersion = 4; // 2 : node max score and value scores, 3 : interned payloads, 4 : node word depths
+  static const uint32_t kIndexByteOrderMark = 0x01020304;
+  static const uint32_t kIndexOnlyFinalWords = 1; // header flag : the active node set holds only the final words (files before it hold 0)
+
+  /*
+  ** Accumulates the sections of an index file, the structure is given already flattened by the trie.
+  */
+  class IndexWriter_t {
+    IndexHeader_t m_header;
+
+  public:
+    std::vector<ArenaNode_t> nodes;
+    std::vector<ArenaEdge_t> edges;
+    std::vector<IndexValueSlot_t> valueSlots;
+    std::vector<IndexValueRef_t> valueRefs;
+    std::vector<IndexPayload_t> payloads;
+    std::string strings;
+    std::vector<IndexCharacter_t> charmap;
+    std::vector<IndexCharacter_t> reverseCharmap;
+    std::string stopwords;
+    std::vector<IndexActiveNode_t> activeNodes;
+
+    IndexWriter_t(int searchLimitThreshold, int fuzzyLimitThreshold, uint32_t flags = 0)
+    {
+      std::memset(&m_header, 0, sizeof(m_header));
+      std::memcpy(m_header.magic, kIndexMagic, sizeof(kIndexMagic));
+      m_header.version = kIndexVersion;
+      m_header.byteOrderMark = kIndexByteOrderMark;
+      m_header.searchLimitThreshold = searchLimitThreshold;
+      m_header.fuzzyLimitThreshold = fuzzyLimitThreshold;
+      m_header.flags = flags;
+      m_header.sectionCount = kSectionCount;
+    }
+
+    // payloads must be added in id order
+    void addPayload(PayloadView_t value)
+    {
+      payloads.push_back({ strings.size(), value.size });
+      strings.append(value.data, value.size);
+    }
+
+    void addValue(uint32_t payload, unsigned int score)
+    {
+      valueRefs.push_back({ payload, score });
+    }
+
+    void write(const std::string& filename)
+    {
+      std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+      if (!out) {
+        throw std::runtime_error("cannot open index file '" + filename + "' for writing");
+      }
+
+      const void* data[kSectionCount] = { nodes.data(), edges.data(), valueSlots.data(), valueRefs.data(), payloads.data(), strings.data(),
+        charmap.data(), reverseCharmap.data(), stopwords.data(), activeNodes.data() };
+      const uint64_t sizes[kSectionCount] = { nodes.size() * sizeof(ArenaNode_t), edges.size() * sizeof(ArenaEdge_t),
+        valueSlots.size() * sizeof(IndexValueSlot_t), valueRefs.size() * sizeof(IndexValueRef_t), payloads.size() * sizeof(IndexPayload_t), strings.size(),
+        charmap.size() * sizeof(IndexCharacter_t), reverseCharmap.size() * sizeof(IndexCharacter_t), stopwords.size(),
+        activeNodes.size() * sizeof(IndexActiveNode_t) };
+
+      uint64_t offset = sizeof(IndexHeader_t);
+      for (int i = 0; i < kSectionCount; i++) {
+        offset = (offset + 7) & ~uint64_t(7);
+        m_header.sections[i].offset = offset;
+        m_header.sections[i].size = sizes[i];
+        offset += sizes[i];
+      }
+
+      out.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+      uint64_t written = sizeof(IndexHeader_t);
+      const char padding[8] = { 0 };
+
+      for (int i = 0; i < kSectionCount; i++) {
+        out.write(padding, m_header.sections[i].offset - written);
+        out.write(static_cast<const char*>(data[i]), sizes[i]);
+        written = m_header.sections[i].offset + sizes[i];
+      }
+
+      if (!out) {
+        throw std::runtime_error("failed writing index file '" + filename + "'");
+      }
+    }
+  };
+
+  /*
+  ** Read-only mapping of an index file, the pages are shared by every process which maps the same file.
+  */
+  class IndexFile_t {
+    const char* m_data;
+    std::size_t m_size;
+
+    IndexFile_t(const IndexFile_t&) = delete;
+    IndexFile_t& operator=(const IndexFile_t&) = delete;
+
+    void unmap()
+    {
+      if (m_data) {
+        munmap(const_cast<char*>(m_data), m_size);
+        m_data = nullptr;
+      }
+    }
+
+  public:
+    explicit IndexFile_t(const std::string& filename)
+    : m_data(nullptr)
+    , m_size(0)
+    {
+      int fd = open(filename.c_str(), O_RDONLY);
+      if (fd < 0) {
+        throw std::runtime_error("cannot open index file '" + filename + "'");
+      }
+
+      struct stat info;
+      if (fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(IndexHeader_t)) {
+        close(fd);
+        throw std::runtime_error("index file '" + filename + "' is truncated");
+      }
+
+      m_size = info.st_size;
+      void* mapped = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+      close(fd);
+
+      if (mapped == MAP_FAILED) {
+        throw std::runtime_error("cannot map index file '" + filename + "'");
+      }
+      m_data = static_cast<const char*>(mapped);
+
+      const IndexHeader_t& head = header();
+      if (std::memcmp(head.magic, kIndexMagic, sizeof(kIndexMagic)) != 0 || head.byteOrderMark != kIndexByteOrderMark) {
+        unmap();
+        throw std::runtime_error("'" + filename + "' is not an index file of this platform");
+      }
+      if (head.version != kIndexVersion || head.sectionCount != kSectionCount) {
+        unmap();
+        throw std::runtime_error("index file '" + filename + "' has version " + std::to_string(head.version) + ", expected " + std::to_string(kIndexVersion));
+      }
+      for (int i = 0; i < kSectionCount; i++) {
+        if (head.sections[i].offset + head.sections[i].size > m_size) {
+          unmap();
+          throw std::runtime_error("index file '" + filename + "' is truncated");
+        }
+      }
+    }
+
+    ~IndexFile_t()
+    {
+      unmap();
+    }
+
+    const IndexHeader_t& header() const
+    {
+      return *reinterpret_cast<const IndexHeader_t*>(m_data);
+    }
+
+    template <typename T>
+    const T* section(IndexSection_t id) const
+    {
+      return reinterpret_cast<const T*>(m_data + header().sections[id].offset);
+    }
+
+    template <typename T>
+    std::size_t sectionCount(IndexSection_t id) const
+    {
+      return header().sections[id].size / sizeof(T);
+    }
+
+    std::size_t size() const
+    {
+      return m_size;
+    }
+  };
+
+  inline std::shared_ptr<const IndexFile_t> openIndex(const std::string& filename)
+  {
+    return std::make_shared<const IndexFile_t>(filename);
+  }
+
+  /*
+  ** Node storage reading straight from a mapped index file : same layout as the arena, no copy is made.
+  */
+  class MappedNodeStore_t {
+    std::shared_ptr<const IndexFile_t> m_file;
+    const ArenaNode_t* m_nodes;
+    const ArenaEdge_t* m_edges;
+    const IndexValueSlot_t* m_valueSlots;
+    const IndexValueRef_t* m_valueRefs;
+    const IndexPayload_t* m_payloads;
+    const char* m_strings;
+    std::size_t m_nodeCount;
+
+  public:
+    typedef uint32_t Node_t;
+    static const uint32_t kNullNode = UINT32_MAX;
+    static const uint32_t kNoValue = UINT32_MAX;
+
+    explicit MappedNodeStore_t(std::shared_ptr<const IndexFile_t> file)
+    : m_file(file)
+    , m_nodes(file->section<ArenaNode_t>(kSectionNodes))
+    , m_edges(file->section<ArenaEdge_t>(kSectionEdges))
+    , m_valueSlots(file->section<IndexValueSlot_t>(kSectionValueSlots))
+    , m_valueRefs(file->section<IndexValueRef_t>(kSectionValueRefs))
+    , m_payloads(file->section<IndexPayload_t>(kSectionPayloads))
+    , m_strings(file->section<char>(kSectionStrings))
+    , m_nodeCount(file->sectionCount<ArenaNode_t>(kSectionNodes))
+    {
+      if (!m_nodeCount) {
+        throw std::runtime_error("index file has no lambda node");
+      }
+    }
+
+    static Node_t nullNode()
+    {
+      return kNullNode;
+    }
+
+    Node_t root() const
+    {
+      return 0;
+    }
+
+    const IndexFile_t& file() const
+    {
+      return *m_file;
+    }
+
+    Node_t getChild(Node_t node, unsigned int value) const
+    {
+      const ArenaNode_t& current = m_nodes[node];
+      const ArenaEdge_t* edge = findArenaEdge(m_edges + current.firstEdge, current.edgeCount, value);
+
+      if (edge != m_edges + current.firstEdge + current.edgeCount && edge->code == value) {
+        return edge->node;
+      }
+      return kNullNode;
+    }
+
+    Node_t insertNReturnChild(Node_t, unsigned int)
+    {
+      throw std::logic_error("a mapped index is read-only");
+    }
+
+    template <typename Fn>
+    void forEachChild(Node_t node, Fn fn) const
+    {
+      const ArenaNode_t& current = m_nodes[node];
+      const ArenaEdge_t* edge = m_edges + current.firstEdge;
+
+      for (const ArenaEdge_t* end = edge + current.edgeCount; edge != end; edge++) {
+        fn(edge->node);
+      }
+    }
+
+    unsigned int getContent(Node_t node) const
+    {
+      return m_nodes[node].content;
+    }
+
+    uint32_t getId(Node_t node) const
+    {
+      return node;
+    }
+
+    bool isEndOfWord(Node_t node) const
+    {
+      return m_nodes[node].valueSlot != kNoValue;
+    }
+
+    void addValue(Node_t, PayloadView_t, unsigned int)
+    {
+      throw std::logic_error("a mapped index is read-only");
+    }
+
+    template <typename Fn>
+    void forEachValue(Node_t node, Fn fn) const
+    {
+      const ArenaNode_t& current = m_nodes[node];
+
+      if (current.valueSlot != kNoValue) {
+        const IndexValueSlot_t& slot = m_valueSlots[current.valueSlot];
+        for (uint32_t i = slot.firstRef; i < slot.firstRef + slot.count; i++) {
+          fn(payload(m_valueRefs[i].payload), m_valueRefs[i].score);
+        }
+      }
+    }
+
+    PayloadView_t payload(uint32_t id) const
+    {
+      return PayloadView_t(m_strings + m_payloads[id].offset, static_cast<std::size_t>(m_payloads[id].size), id);
+    }
+
+    std::size_t payloadCount() const
+    {
+      return m_file->sectionCount<IndexPayload_t>(kSectionPayloads);
+    }
+
+    unsigned int getMaxScore(Node_t node) const
+    {
+      return m_nodes[node].maxScore;
+    }
+
+    void raiseMaxScore(Node_t, unsigned int)
+    {
+      throw std::logic_error("a mapped index is read-only");
+    }
+
+    WordDepths_t getWordDepths(Node_t node) const
+    {
+      return m_nodes[node].wordDepths;
+    }
+
+    void widenWordDepths(Node_t, WordDepths_t, std::size_t)
+    {
+      throw std::logic_error("a mapped index is read-only");
+    }
+
+    std::size_t nodeCount() const
+    {
+      return m_nodeCount;
+    }
+
+    void shrinkToFit()
+    {
+    }
+
+    // the mapped bytes, shared with every other process mapping the file
+    MemoryUsage_t memoryUsage() const
+    {
+      const IndexHeader_t& head = m_file->header();
+      MemoryUsage_t usage;
+      usage.nodes = m_nodeCount;
+      usage.edges = m_file->sectionCount<ArenaEdge_t>(kSectionEdges);
+      usage.nodeBytes = head.sections[kSectionNodes].size;
+      usage.edgeBytes = head.sections[kSectionEdges].size;
+      usage.payloadBytes = head.sections[kSectionValueSlots].size + head.sections[kSectionValueRefs].size + head.sections[kSectionPayloads].size + head.sections[kSectionStrings].size;
+      usage.wastedBytes = m_file->size() - usage.nodeBytes - usage.edgeBytes - usage.payloadBytes;
+      return usage;
+    }
+  };
+}
+#endif
@@ -1,34 +1,65 @@
+#include "bulk_loader.hpp"
+#include "corrector.hpp"
 #include "person.hpp"
+#include "server.hpp"
 #include "trie.hpp"
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
 #include <iostream>
 #include <map>
 
-int main()
+/*
+** zynthetic [dictionary]                                                interactive search
+** zynthetic --serve ADDRESS [--serve ADDRESS]... [--threads N] [--index FILE | dictionary]
+**   serves the query protocol (see `BasicQueryProtocol_t`) on unix:PATH, tcp:PORT or tcp:HOST:PORT until SIGINT / SIGTERM.
+** zynthetic --correct TEXT [--threads N] [--index FILE | dictionary]
+**   writes TEXT (- for the standard input) with its misspelled words corrected on the standard output, the rest goes to the error output.
+** The dictionary has lines of `word[\tpayload[\tscore]]`, an index file is the output of `save`; without either the demo names are loaded.
+** `--cache MB` puts a result cache of that size in front of the fuzzy queries, its counters are written on the error output at the end.
+** `--freeze` compiles the loaded dictionary into a read-only minimized trie (see `BasicTrie_t::freeze`) before answering.
+** `--timeout MS` bounds every fuzzy request of the server, the ones running out of time answering their partial results.
+*/
+
+static trie::Server_t* g_server = nullptr;
+
+static void stopServer(int)
 {
-  trie::Trie_t personTrie;
+  if (g_server) {
+    g_server->stop();
+  }
+}
 
-  std::string name = "Duan";
-  std::string name2 = "Daniel";
-  std::string name3 = "Soto";
-  std::string name4 = "Roab";
-  std::string name5 = "Bananation";
-  std::string name6 = "SotoBanaNAO";
-  std::string name7 = "Danyel";
-  std::string name8 = "ovo";
-  std::string name9 = "uva";
+template <typename Storage>
+static void serve(const trie::BasicTrie_t<Storage>& personTrie, const std::vector<std::string>& addresses, std::chrono::microseconds timeout, trie::ThreadPool_t& pool)
+{
+  trie::BasicQueryProtocol_t<Storage> protocol(personTrie);
+  protocol.setQueryTimeout(timeout);
+  trie::Server_t server(protocol, pool);
+  for (auto& address : addresses) {
+    server.listen(address);
+    std::cerr << "Listening on " << address << " with " << pool.size() << " workers.\n";
+  }
 
-  personTrie.putIndividualWord(name, name);
-  personTrie.putIndividualWord(name2, name2);
-  personTrie.putIndividualWord(name3, name3);
-  personTrie.putIndividualWord(name4, name4);
-  personTrie.putIndividualWord(name5, name5);
-  personTrie.putIndividualWord(name6, name6);
-  personTrie.putIndividualWord(name7, name7);
-  personTrie.putIndividualWord(name8, name8);
-  personTrie.putIndividualWord(name9, name9);
+  g_server = &server;
+  std::signal(SIGINT, stopServer);
+  std::signal(SIGTERM, stopServer);
+  server.run();
+  g_server = nullptr;
+  std::cerr << "Server stopped.\n";
+}
 
-  personTrie.buildActiveNodeSet(false);
+template <typename Storage>
+static void correct(const trie::BasicTrie_t<Storage>& personTrie, const std::string& text, std::ostream& output, trie::ThreadPool_t& pool)
+{
+  trie::BasicCorrector_t<Storage> corrector(personTrie, pool);
+  trie::CorrectionStats_t stats = text == "-" ? corrector.correct(std::cin, output) : corrector.correct(text, output);
+  stats.print(std::cerr);
+}
 
+template <typename Storage>
+static void interactive(const trie::BasicTrie_t<Storage>& personTrie)
+{
   std::string search;
   std::cout << "\n >> ";
   while (std::getline(std::cin, search)) {
@@ -56,3 +87,128 @@ int main()
     std::cout << "\n >> ";
   }
 }
+
+template <typename Storage>
+static void run(trie::BasicTrie_t<Storage>& personTrie, const std::vector<std::string>& addresses, const std::string& text, std::ostream& output,
+                std::shared_ptr<trie::ResultCache_t> cache, std::chrono::microseconds timeout, trie::ThreadPool_t& pool)
+{
+  personTrie.setResultCache(cache);
+  if (!text.empty()) {
+    personTrie.buildDeletionIndex(personTrie.fuzzyLimitThreshold()); // the corrector looks the misspelled words up on it
+    correct(personTrie, text, output, pool);
+  } else {
+    addresses.empty() ? interactive(personTrie) : serve(personTrie, addresses, timeout, pool);
+  }
+  if (cache) {
+    cache->stats().print(std::cerr);
+  }
+}
+
+static void loadDemo(trie::Trie_t& personTrie)
+{
+  std::string name = "Duan";
+  std::string name2 = "Daniel";
+  std::string name3 = "Soto";
+  std::string name4 = "Roab";
+  std::string name5 = "Bananation";
+  std::string name6 = "SotoBanaNAO";
+  std::string name7 = "Danyel";
+  std::string name8 = "ovo";
+  std::string name9 = "uva";
+
+  personTrie.putIndividualWord(name, name);
+  personTrie.putIndividualWord(name2, name2);
+  personTrie.putIndividualWord(name3, name3);
+  personTrie.putIndividualWord(name4, name4);
+  personTrie.putIndividualWord(name5, name5);
+  personTrie.putIndividualWord(name6, name6);
+  personTrie.putIndividualWord(name7, name7);
+  personTrie.putIndividualWord(name8, name8);
+  personTrie.putIndividualWord(name9, name9);
+
+  personTrie.buildActiveNodeSet(false);
+}
+
+int main(int argc, char** argv)
+{
+  std::vector<std::string> addresses;
+  std::string dictionary;
+  std::string index;
+  std::string text;
+  std::size_t threads = std::thread::hardware_concurrency();
+  std::size_t cacheMegabytes = 0;
+  bool freeze = false;
+  std::chrono::microseconds timeout(0);
+
+  for (int i = 1; i < argc; i++) {
+    std::string argument = argv[i];
+    if ((argument == "--serve" || argument == "--threads" || argument == "--index" || argument == "--correct" || argument == "--cache" || argument == "--timeout") && i + 1 >= argc) {
+      std::cerr << "zynthetic: missing value for " << argument << '\n';
+      return 1;
+    }
+
+    if (argument == "--serve") {
+      addresses.push_back(argv[++i]);
+    } else if (argument == "--threads") {
+      threads = std::max(std::atoi(argv[++i]), 1);
+    } else if (argument == "--index") {
+      index = argv[++i];
+    } else if (argument == "--correct") {
+      text = argv[++i];
+    } else if (argument == "--cache") {
+      cacheMegabytes = std::strtoull(argv[++i], nullptr, 10);
+    } else if (argument == "--timeout") {
+      timeout = std::chrono::microseconds(static_cast<int64_t>(std::strtod(argv[++i], nullptr) * 1000));
+    } else if (argument == "--freeze") {
+      freeze = true;
+    } else {
+      dictionary = argument;
+    }
+  }
+
+  // the corrected text owns the standard output, the messages of the loading go to the error output
+  if (!text.empty()) {
+    std::ios::sync_with_stdio(false);
+  }
+  std::ostream output(std::cout.rdbuf());
+  if (!text.empty()) {
+    std::cout.rdbuf(std::cerr.rdbuf());
+  }
+
+  try {
+    trie::ThreadPool_t pool(std::max<std::size_t>(threads, 1));
+    std::shared_ptr<trie::ResultCache_t> cache;
+    if (cacheMegabytes) {
+      cache = std::make_shared<trie::ResultCache_t>(cacheMegabytes << 20);
+    }
+
+    if (!index.empty()) {
+      trie::MappedTrie_t personTrie(std::make_shared<const trie::IndexFile_t>(index));
+      personTrie.memoryUsage().print(std::cout, "mapped");
+      run(personTrie, addresses, text, output, cache, timeout, pool);
+      return 0;
+    }
+
+    std::unique_ptr<trie::Trie_t> personTrie(new trie::Trie_t());
+    if (!dictionary.empty()) {
+      trie::BulkLoader_t loader(*personTrie, pool);
+      loader.setProgressCallback([](const trie::LoadProgress_t& progress) { progress.print(std::cout); });
+      loader.load(dictionary);
+    } else {
+      loadDemo(*personTrie);
+    }
+
+    personTrie->memoryUsage().print(std::cout, "pointer");
+    if (freeze) {
+      trie::FrozenTrie_t frozenTrie = personTrie->freeze();
+      personTrie.reset(); // the frozen trie holds its own copy of the payloads
+      frozenTrie.memoryUsage().print(std::cout, "frozen");
+      run(frozenTrie, addresses, text, output, cache, timeout, pool);
+      return 0;
+    }
+    run(*personTrie, addresses, text, output, cache, timeout, pool);
+  } catch (const std::exception& error) {
+    std::cerr << "zynthetic: " << error.what() << '\n';
+    return 1;
+  }
+}
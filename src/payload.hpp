@@ -0,0 +1,227 @@
+#ifndef _ZYNTHETIC_PAYLOAD_
+#define _ZYNTHETIC_PAYLOAD_
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace trie {
+
+  static const uint32_t kNoPayloadId = UINT32_MAX;
+
+  // non-owning reference to a stored value, valid while the structure which holds it is alive
+  struct PayloadView_t {
+    const char* data;
+    std::size_t size;
+    uint32_t id; // interned id on the structure, kNoPayloadId for a view of outside bytes
+
+    PayloadView_t()
+    : data("")
+    , size(0)
+    , id(kNoPayloadId)
+    {
+    }
+
+    PayloadView_t(const char* _data, std::size_t _size, uint32_t _id = kNoPayloadId)
+    : data(_data)
+    , size(_size)
+    , id(_id)
+    {
+    }
+
+    PayloadView_t(const std::string& str)
+    : data(str.data())
+    , size(str.size())
+    , id(kNoPayloadId)
+    {
+    }
+
+    std::string str() const
+    {
+      return std::string(data, size);
+    }
+
+    bool operator==(const PayloadView_t& other) const
+    {
+      return size == other.size && std::memcmp(data, other.data, size) == 0;
+    }
+  };
+
+  // FNV-1a over the bytes of the value
+  struct PayloadHash_t {
+    std::size_t operator()(const PayloadView_t& value) const
+    {
+      uint64_t hash = 14695981039346656037ull;
+      for (std::size_t i = 0; i < value.size; i++) {
+        hash = (hash ^ static_cast<unsigned char>(value.data[i])) * 1099511628211ull;
+      }
+      return static_cast<std::size_t>(hash);
+    }
+  };
+
+  // value of an end of word node : the interned payload and its score
+  struct PayloadRef_t {
+    uint32_t id;
+    uint32_t score;
+  };
+
+  /*
+  ** Interned payloads : every distinct value is stored once and known by a dense 32-bit id. The bytes live on fixed blocks
+  ** which are never moved, so a view stays valid while the arena is alive, even across later insertions.
+  ** Every id counts its uses (`intern` takes one, `release` gives it back). A value without uses keeps its id and bytes, so
+  ** interning it again finds it, until the unused values are the most of the arena : the store holding the ids then calls
+  ** `compact`, which copies the used values on new blocks and renumbers them (invalidating the views, as the removals do).
+  */
+  class PayloadArena_t {
+    static const std::size_t kBlockSize = 1 << 16;
+    static const std::size_t kMinUnusedValues = 256; // below it a compaction would cost more than the bytes it gives back
+
+    std::vector<std::unique_ptr<char[]>> m_blocks;
+    char* m_cursor; // free bytes of the block being filled
+    std::size_t m_left;
+    std::size_t m_blockBytes; // bytes allocated on every block
+    std::vector<PayloadView_t> m_payloads; // id -> bytes
+    std::vector<uint32_t> m_uses; // id -> amount of references to the value
+    std::size_t m_unused; // ids without uses
+    std::unordered_map<PayloadView_t, uint32_t, PayloadHash_t> m_ids;
+
+    const char* copyBytes(PayloadView_t value)
+    {
+      if (value.size > kBlockSize / 4) { // a large value takes its own block, the one being filled stays open
+        m_blocks.emplace_back(new char[value.size]);
+        m_blockBytes += value.size;
+        std::memcpy(m_blocks.back().get(), value.data, value.size);
+        return m_blocks.back().get();
+      }
+
+      if (value.size > m_left) {
+        m_blocks.emplace_back(new char[kBlockSize]);
+        m_blockBytes += kBlockSize;
+        m_cursor = m_blocks.back().get();
+        m_left = kBlockSize;
+      }
+
+      char* bytes = m_cursor;
+      std::memcpy(bytes, value.data, value.size);
+      m_cursor += value.size;
+      m_left -= value.size;
+      return bytes;
+    }
+
+    // id of the value, storing it (without uses) when it is new
+    uint32_t store(PayloadView_t value)
+    {
+      auto found = m_ids.find(value);
+      if (found != m_ids.end()) {
+        return found->second;
+      }
+
+      uint32_t id = static_cast<uint32_t>(m_payloads.size());
+      PayloadView_t stored(value.size ? copyBytes(value) : "", value.size, id);
+      m_payloads.push_back(stored);
+      m_uses.push_back(0);
+      m_unused++;
+      m_ids.emplace(stored, id);
+      return id;
+    }
+
+    void addUses(uint32_t id, uint32_t uses)
+    {
+      if (uses && m_uses[id] == 0) {
+        m_unused--;
+      }
+      m_uses[id] += uses;
+    }
+
+  public:
+    PayloadArena_t()
+    : m_cursor(nullptr)
+    , m_left(0)
+    , m_blockBytes(0)
+    , m_unused(0)
+    {
+    }
+
+    // the copy gives every value the same id (and uses) as here
+    PayloadArena_t(const PayloadArena_t& other)
+    : PayloadArena_t()
+    {
+      absorb(other);
+    }
+
+    PayloadArena_t(PayloadArena_t&&) = default; // the blocks move along, so the views stay valid
+    PayloadArena_t& operator=(PayloadArena_t&&) = default;
+    PayloadArena_t& operator=(const PayloadArena_t&) = delete;
+
+    // id of the value, storing it when it is new, for one more use
+    uint32_t intern(PayloadView_t value)
+    {
+      uint32_t id = store(value);
+      addUses(id, 1);
+      return id;
+    }
+
+    // gives back a use taken by `intern`
+    void release(uint32_t id)
+    {
+      if (--m_uses[id] == 0) {
+        m_unused++;
+      }
+    }
+
+    // whether the values without uses are enough of the arena for `compact` to be worth it
+    bool wasteful() const
+    {
+      return m_unused >= kMinUnusedValues && 2 * m_unused > m_payloads.size();
+    }
+
+    /*
+    ** Drops the values without uses, the others being copied on new blocks in the order of their ids. Returns the new id of
+    ** every previous one (kNoPayloadId for the dropped ones), which the holder of the ids applies to them.
+    */
+    std::vector<uint32_t> compact()
+    {
+      PayloadArena_t compacted;
+      std::vector<uint32_t> ids(m_payloads.size(), kNoPayloadId);
+      for (std::size_t i = 0; i < m_payloads.size(); i++) {
+        if (m_uses[i]) {
+          ids[i] = compacted.store(m_payloads[i]);
+          compacted.addUses(ids[i], m_uses[i]);
+        }
+      }
+      *this = std::move(compacted);
+      return ids;
+    }
+
+    PayloadView_t get(uint32_t id) const
+    {
+      return m_payloads[id];
+    }
+
+    std::size_t size() const
+    {
+      return m_payloads.size();
+    }
+
+    // interns every value of `other` with its uses, result[id on other] being the id here
+    std::vector<uint32_t> absorb(const PayloadArena_t& other)
+    {
+      std::vector<uint32_t> ids(other.size());
+      for (std::size_t i = 0; i < other.size(); i++) {
+        ids[i] = store(other.get(static_cast<uint32_t>(i)));
+        addUses(ids[i], other.m_uses[i]);
+      }
+      return ids;
+    }
+
+    // blocks, id tables and hash table
+    std::size_t memoryUsage() const
+    {
+      const std::size_t hashEntryBytes = sizeof(std::pair<const PayloadView_t, uint32_t>) + sizeof(void*) * 2;
+      return m_blockBytes + m_payloads.capacity() * sizeof(PayloadView_t) + m_uses.capacity() * sizeof(uint32_t) + m_ids.size() * hashEntryBytes + m_ids.bucket_count() * sizeof(void*);
+    }
+  };
+}
+#endif
@@ -0,0 +1,150 @@
+#ifndef _ZYNTHETIC_PREFIX_TABLE_
+#define _ZYNTHETIC_PREFIX_TABLE_
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace trie {
+
+  /*
+  ** Ready-made active node sets of some prefixes (as character codes), so a fuzzy query starts from the set of the deepest
+  ** prefix of its keyword found here instead of deriving it character by character from the initial set. The prefixes are
+  ** kept on a small trie of their own, an edge being a hash map entry keyed by its parent and its code : the lookup
+  ** follows the keyword down to the first missing edge, at most one probe per character.
+  ** The sets are copied in until `maxBytes` (estimated as they are added, see `memoryUsage` for the actual figure) is spent,
+  ** the ones which do not fit anymore being left out.
+  */
+  template <typename ActiveNode>
+  class BasicPrefixTable_t {
+  public:
+    typedef std::vector<ActiveNode> ActiveNodeSet_t;
+
+  private:
+    static const uint32_t kNone = UINT32_MAX;
+
+    std::unordered_map<uint64_t, uint32_t> m_edges; // (parent entry << 32 | code) -> entry, the empty prefix being entry 0
+    std::vector<uint32_t> m_entries; // position of the set of each entry on m_sets, kNone for the ones only leading to others
+    std::vector<ActiveNodeSet_t> m_sets;
+    std::size_t m_maxBytes;
+    std::size_t m_bytes; // estimated
+    uint64_t m_generation; // of the trie the sets were taken from
+
+    static uint64_t edgeKey(uint32_t entry, unsigned int code)
+    {
+      return (uint64_t(entry) << 32) | code;
+    }
+
+    static std::size_t edgeBytes()
+    {
+      return sizeof(std::pair<const uint64_t, uint32_t>) + 3 * sizeof(void*) + sizeof(uint32_t); // node, bucket and entry
+    }
+
+  public:
+    BasicPrefixTable_t(std::size_t maxBytes, uint64_t generation)
+    : m_entries(1, static_cast<uint32_t>(kNone)) // by value, kNone has no definition
+    , m_maxBytes(maxBytes)
+    , m_bytes(0)
+    , m_generation(generation)
+    {
+    }
+
+    /*
+    ** Files the set of the prefix, which takes the place of a previous one. Returns false, leaving the table unchanged,
+    ** when it does not fit in what is left of the bytes of the table.
+    */
+    bool add(const unsigned int* codes, std::size_t length, const ActiveNodeSet_t& set)
+    {
+      std::size_t bytes = set.size() * sizeof(ActiveNode) + sizeof(ActiveNodeSet_t);
+      uint32_t entry = 0;
+      std::size_t depth = 0;
+      for (; depth < length; depth++) {
+        auto edge = m_edges.find(edgeKey(entry, codes[depth]));
+        if (edge == m_edges.end()) {
+          break;
+        }
+        entry = edge->second;
+      }
+
+      bytes += (length - depth) * edgeBytes();
+      if (m_bytes + bytes > m_maxBytes) {
+        return false;
+      }
+
+      for (; depth < length; depth++) {
+        uint32_t child = static_cast<uint32_t>(m_entries.size());
+        m_entries.push_back(static_cast<uint32_t>(kNone));
+        m_edges.emplace(edgeKey(entry, codes[depth]), child);
+        entry = child;
+      }
+
+      if (m_entries[entry] == kNone) {
+        m_entries[entry] = static_cast<uint32_t>(m_sets.size());
+        m_sets.push_back(set);
+      } else {
+        m_bytes -= m_sets[m_entries[entry]].size() * sizeof(ActiveNode) + sizeof(ActiveNodeSet_t);
+        m_sets[m_entries[entry]] = ActiveNodeSet_t(set.begin(), set.end());
+      }
+      m_bytes += bytes;
+      return true;
+    }
+
+    // set of the deepest prefix of the codes found on the table, `depth` being its length, nullptr (and 0) without any
+    const ActiveNodeSet_t* find(const unsigned int* codes, std::size_t length, std::size_t& depth) const
+    {
+      const ActiveNodeSet_t* deepest = nullptr;
+      uint32_t entry = 0;
+      depth = 0;
+
+      for (std::size_t i = 0; i < length; i++) {
+        auto edge = m_edges.find(edgeKey(entry, codes[i]));
+        if (edge == m_edges.end()) {
+          break;
+        }
+        entry = edge->second;
+        if (m_entries[entry] != kNone) {
+          deepest = &m_sets[m_entries[entry]];
+          depth = i + 1;
+        }
+      }
+      return deepest;
+    }
+
+    // whether a set of `nodes` active nodes would still fit (on an existing prefix)
+    bool fits(std::size_t nodes) const
+    {
+      return m_bytes + nodes * sizeof(ActiveNode) + sizeof(ActiveNodeSet_t) <= m_maxBytes;
+    }
+
+    // amount of prefixes holding a set
+    std::size_t size() const
+    {
+      return m_sets.size();
+    }
+
+    std::size_t maxBytes() const
+    {
+      return m_maxBytes;
+    }
+
+    uint64_t generation() const
+    {
+      return m_generation;
+    }
+
+    std::size_t memoryUsage() const
+    {
+      const std::size_t mallocOverhead = sizeof(void*) * 2;
+
+      std::size_t bytes = m_entries.capacity() * sizeof(uint32_t) + m_sets.capacity() * sizeof(ActiveNodeSet_t);
+      bytes += m_edges.bucket_count() * sizeof(void*) + m_edges.size() * (sizeof(std::pair<const uint64_t, uint32_t>) + sizeof(void*) + mallocOverhead);
+      for (const ActiveNodeSet_t& set : m_sets) {
+        if (set.capacity()) {
+          bytes += set.capacity() * sizeof(ActiveNode) + mallocOverhead;
+        }
+      }
+      return bytes;
+    }
+  };
+}
+#endif
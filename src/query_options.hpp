@@ -0,0 +1,152 @@
+#ifndef _ZYNTHETIC_QUERY_OPTIONS_
+#define _ZYNTHETIC_QUERY_OPTIONS_
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+namespace trie {
+
+  // how a budgeted query ended, the results being partial unless kQueryComplete
+  enum QueryStatus_t {
+    kQueryComplete = 0,
+    kQueryDeadline, // the deadline passed
+    kQueryBudget, // the query visited more nodes than its budget
+    kQueryCancelled // the token was cancelled
+  };
+
+  // cancels the queries holding it, from any thread
+  class CancellationToken_t {
+    std::atomic<bool> m_cancelled;
+
+  public:
+    CancellationToken_t()
+    : m_cancelled(false)
+    {
+    }
+
+    void cancel()
+    {
+      m_cancelled.store(true, std::memory_order_relaxed);
+    }
+
+    bool cancelled() const
+    {
+      return m_cancelled.load(std::memory_order_relaxed);
+    }
+  };
+
+  // limits of a query, see the budgeted forms of the `BasicTrie_t` queries
+  struct QueryOptions_t {
+    std::chrono::steady_clock::time_point deadline; // time_point::max() for none
+    uint64_t nodeBudget; // nodes the query may visit, UINT64_MAX for no limit
+    std::shared_ptr<const CancellationToken_t> cancellation; // none by default
+
+    QueryOptions_t()
+    : deadline(std::chrono::steady_clock::time_point::max())
+    , nodeBudget(UINT64_MAX)
+    {
+    }
+
+    // a deadline `timeout` from now
+    template <typename Rep, typename Period>
+    static QueryOptions_t within(std::chrono::duration<Rep, Period> timeout)
+    {
+      QueryOptions_t options;
+      options.deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout);
+      return options;
+    }
+  };
+
+  /*
+  ** What is left of the options of a running query. The engine spends every node it visits (a whole active node set at a
+  ** time while it walks the keyword), which is a counter increment : the clock and the token are only read once every
+  ** kCheckInterval nodes. Once the budget is out every `spend` fails, so each loop of the engine stops on its next node.
+  */
+  class QueryBudget_t {
+    static const uint64_t kCheckInterval = 256;
+
+    const QueryOptions_t& m_options;
+    uint64_t m_visited;
+    uint64_t m_nextCheck; // `spend` reads the clock and the token once m_visited gets there
+    QueryStatus_t m_status;
+
+    bool check()
+    {
+      if (m_status == kQueryComplete) {
+        if (m_visited > m_options.nodeBudget) {
+          m_status = kQueryBudget;
+        } else if (m_options.cancellation && m_options.cancellation->cancelled()) {
+          m_status = kQueryCancelled;
+        } else if (m_options.deadline != std::chrono::steady_clock::time_point::max() && std::chrono::steady_clock::now() >= m_options.deadline) {
+          m_status = kQueryDeadline;
+        }
+      }
+
+      if (m_status != kQueryComplete) {
+        m_nextCheck = 0;
+        return false;
+      }
+      m_nextCheck = std::min(m_visited + kCheckInterval, m_options.nodeBudget) + 1;
+      return true;
+    }
+
+  public:
+    // a query whose options are already out (a past deadline, a cancelled token) stops on its first node
+    explicit QueryBudget_t(const QueryOptions_t& options)
+    : m_options(options)
+    , m_visited(0)
+    , m_nextCheck(0)
+    , m_status(kQueryComplete)
+    {
+      check();
+    }
+
+    QueryBudget_t(const QueryBudget_t&) = delete;
+    QueryBudget_t& operator=(const QueryBudget_t&) = delete;
+
+    // false once the query has to stop
+    bool spend(uint64_t nodes = 1)
+    {
+      m_visited += nodes;
+      return m_visited < m_nextCheck || check();
+    }
+
+    bool exhausted() const
+    {
+      return m_status != kQueryComplete;
+    }
+
+    QueryStatus_t status() const
+    {
+      return m_status;
+    }
+
+    uint64_t visited() const
+    {
+      return m_visited;
+    }
+  };
+
+  // points the budget slot of a query scratch at `budget` for the scope of a query, as `QueryProbe_t` does with the stats
+  class BudgetScope_t {
+    QueryBudget_t*& m_slot;
+
+  public:
+    BudgetScope_t(QueryBudget_t*& slot, QueryBudget_t& budget)
+    : m_slot(slot)
+    {
+      m_slot = &budget;
+    }
+
+    BudgetScope_t(const BudgetScope_t&) = delete;
+    BudgetScope_t& operator=(const BudgetScope_t&) = delete;
+
+    ~BudgetScope_t()
+    {
+      m_slot = nullptr;
+    }
+  };
+}
+#endif
@@ -0,0 +1,671 @@
+#ifndef _ZYNTHETIC_RADIX_
+#define _ZYNTHETIC_RADIX_
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+#include <vector>
+#include "arena.hpp"
+#include "payload.hpp"
+
+namespace trie {
+
+  // a chain of single-child characters collapsed on one record, its label being a span of consecutive positions
+  struct RadixNode_t {
+    uint32_t labelBegin; // first position of the label, the id of its first character on the trie
+    uint32_t labelLength;
+    uint32_t valueSlot; // index on the value table, RadixNodeStore_t::kNoValue when the last character is not end of word
+    uint32_t firstEdge; // offset of the children block on the edge array (children of the last character, by their first position)
+    uint16_t edgeCount; // used slots of the children block
+    uint16_t edgeCapacity; // reserved slots of the children block
+    uint32_t maxScore; // highest score among the values below the last character
+    WordDepths_t wordDepths; // depths of the words below the last character, relative to it
+
+    RadixNode_t(uint32_t begin)
+    : labelBegin(begin)
+    , labelLength(1)
+    , valueSlot(UINT32_MAX)
+    , firstEdge(0)
+    , edgeCount(0)
+    , edgeCapacity(0)
+    , maxScore(0)
+    {
+    }
+  };
+
+  // a character of a label : a node of the trie
+  struct RadixPosition_t {
+    uint32_t code; // character code
+    uint32_t record; // record holding the character, with RadixNodeStore_t::kLastCharacter on the last one of its label
+  };
+
+  // a children block entry, which leads straight to the record of the child and to the first position of its label
+  struct RadixEdge_t {
+    uint32_t code; // character code, the children block is sorted by it
+    uint32_t position;
+    uint32_t record;
+  };
+
+  /*
+  ** A node of the radix store : the position of its character, which is its id, and the record whose label holds it (the
+  ** offset into the label being the distance to `labelBegin`). The store reaches the label, the children and the bounds of
+  ** the node from the record, and the next character of a label is the next position, so a query walking an edge never
+  ** looks a position up. The record is a hint : an edit splitting or joining the record leaves it stale, and the store
+  ** then finds the owner of the position again. Two cursors on the same position are the same node.
+  */
+  struct RadixCursor_t {
+    uint32_t position;
+    uint32_t record;
+    uint32_t code; // of the character, read with the position or the edge which led to it
+
+    bool operator==(const RadixCursor_t& other) const
+    {
+      return position == other.position;
+    }
+
+    bool operator!=(const RadixCursor_t& other) const
+    {
+      return position != other.position;
+    }
+
+    bool operator<(const RadixCursor_t& other) const
+    {
+      return position < other.position;
+    }
+  };
+
+  /*
+  ** Path-compressed node storage (radix trie) : a run of characters with a single child and no value is a single record
+  ** whose label is a span of consecutive positions. The trie still sees a node per character, a cursor on its record and
+  ** position (see `RadixCursor_t`), so the active node sets, the automaton and the completions step inside an edge by
+  ** moving the cursor to the next position of the same record, and a children block hands the cursors of the children
+  ** out without reading them. Only the last character of a record has a children block, values and bounds; the bounds of a
+  ** position inside an edge are the ones of the last character shifted by the characters left to it.
+  ** A record is split when a word leaves it or ends inside it; the positions never move, so the ids stay valid across the
+  ** edits. An insertion growing a fresh leaf extends its label instead of adding a record, and `shrinkToFit` joins back the
+  ** records left with a single child on the next positions. The positions of removed nodes are not given again.
+  */
+  class RadixNodeStore_t {
+    std::vector<RadixNode_t> m_nodes; // m_nodes[0] is the lambda node, whose label is the position 0
+    std::vector<RadixPosition_t> m_positions;
+    std::vector<RadixEdge_t> m_edges; // children blocks
+    std::vector<std::vector<PayloadRef_t>> m_values; // values (and their scores) of the end of word records
+    PayloadArena_t m_payloads; // the bytes of every distinct value
+    std::size_t m_wastedEdges; // slots left behind by relocated blocks and removed records
+    std::size_t m_wastedPositions; // positions of removed nodes
+    std::vector<uint32_t> m_freeNodes; // removed records (with an empty label), given again before growing m_nodes
+    std::vector<uint32_t> m_freeValues; // value slots of the records which stopped being an end of word
+
+    uint32_t lastPosition(const RadixNode_t& node) const
+    {
+      return node.labelBegin + node.labelLength - 1;
+    }
+
+    uint32_t owner(uint32_t position) const
+    {
+      return m_positions[position].record & ~kLastCharacter;
+    }
+
+    bool isLast(uint32_t position) const
+    {
+      return m_positions[position].record & kLastCharacter;
+    }
+
+    // gives the positions of the label to `record`, flagging its last one
+    void own(uint32_t record)
+    {
+      const RadixNode_t& node = m_nodes[record];
+      for (uint32_t i = node.labelBegin; i < lastPosition(node); i++) {
+        m_positions[i].record = record;
+      }
+      m_positions[lastPosition(node)].record = record | kLastCharacter;
+    }
+
+    // record of the cursor : its hint while the label of the hinted record still holds the position
+    uint32_t recordOf(RadixCursor_t node) const
+    {
+      const RadixNode_t& hinted = m_nodes[node.record];
+      return node.position - hinted.labelBegin < hinted.labelLength ? node.record : owner(node.position);
+    }
+
+    // characters between the position and the last one of its record
+    uint32_t distanceToLast(uint32_t position) const
+    {
+      return lastPosition(m_nodes[owner(position)]) - position;
+    }
+
+    static WordDepths_t shifted(WordDepths_t depths, std::size_t offset)
+    {
+      if (!depths.empty()) {
+        depths.min = static_cast<uint16_t>(std::min<std::size_t>(depths.min + offset, WordDepths_t::kSaturated));
+        depths.max = static_cast<uint16_t>(std::min<std::size_t>(depths.max + offset, WordDepths_t::kSaturated));
+      }
+      return depths;
+    }
+
+    const RadixEdge_t* findEdge(const RadixNode_t& node, uint32_t code) const
+    {
+      return findArenaEdge(m_edges.data() + node.firstEdge, node.edgeCount, code);
+    }
+
+    // adds the edge to the record `child` on the sorted children block of `node`, moving the block to the end with the double of the room when full
+    void insertEdge(uint32_t node, uint32_t code, uint32_t child)
+    {
+      uint32_t childBegin = m_nodes[child].labelBegin;
+      RadixNode_t& current = m_nodes[node];
+
+      if (current.edgeCount == current.edgeCapacity) {
+        uint32_t newCapacity = current.edgeCapacity ? current.edgeCapacity * 2u : 1u;
+        uint32_t newFirst = static_cast<uint32_t>(m_edges.size());
+
+        m_edges.resize(m_edges.size() + newCapacity);
+        std::copy(m_edges.begin() + current.firstEdge, m_edges.begin() + current.firstEdge + current.edgeCount, m_edges.begin() + newFirst);
+
+        m_wastedEdges += current.edgeCapacity;
+        current.firstEdge = newFirst;
+        current.edgeCapacity = static_cast<uint16_t>(newCapacity);
+      }
+
+      RadixEdge_t* begin = m_edges.data() + current.firstEdge;
+      RadixEdge_t* position = begin + (findEdge(current, code) - begin);
+      std::copy_backward(position, begin + current.edgeCount, begin + current.edgeCount + 1);
+      position->code = code;
+      position->position = childBegin;
+      position->record = child;
+      current.edgeCount++;
+    }
+
+    uint32_t newRecord(uint32_t labelBegin)
+    {
+      uint32_t record = static_cast<uint32_t>(m_nodes.size());
+      if (m_freeNodes.empty()) {
+        m_nodes.emplace_back(labelBegin);
+      } else {
+        record = m_freeNodes.back();
+        m_freeNodes.pop_back();
+        m_nodes[record] = RadixNode_t(labelBegin);
+      }
+      return record;
+    }
+
+    // makes `position` the last character of its record, the characters after it moving to a new record below
+    void split(uint32_t position)
+    {
+      uint32_t upper = owner(position);
+      uint32_t kept = position - m_nodes[upper].labelBegin + 1;
+      uint32_t moved = m_nodes[upper].labelLength - kept;
+
+      uint32_t lower = newRecord(position + 1);
+      RadixNode_t& below = m_nodes[lower];
+      RadixNode_t& above = m_nodes[upper];
+      below = above; // the children, the values and the bounds belong to the last character
+      below.labelBegin = position + 1;
+      below.labelLength = moved;
+      own(lower);
+
+      above.labelLength = kept;
+      above.valueSlot = kNoValue;
+      above.firstEdge = static_cast<uint32_t>(m_edges.size());
+      above.edgeCount = 0;
+      above.edgeCapacity = 2; // the split is made for a second child, most of the time
+      above.wordDepths = shifted(below.wordDepths, moved);
+      m_edges.resize(m_edges.size() + 2);
+      insertEdge(upper, m_positions[position + 1].code, lower);
+      own(upper);
+    }
+
+    // joins the single child of `node` to it when its label follows on the next positions
+    bool join(uint32_t node)
+    {
+      const RadixNode_t& current = m_nodes[node];
+      if (node == 0 || current.valueSlot != kNoValue || current.edgeCount != 1) {
+        return false;
+      }
+
+      if (m_edges[current.firstEdge].position != lastPosition(current) + 1) {
+        return false;
+      }
+
+      uint32_t child = m_edges[current.firstEdge].record;
+      RadixNode_t& above = m_nodes[node];
+      const RadixNode_t& below = m_nodes[child];
+      m_wastedEdges += above.edgeCapacity;
+      uint32_t labelLength = above.labelLength + below.labelLength;
+      uint32_t labelBegin = above.labelBegin;
+      above = below;
+      above.labelBegin = labelBegin;
+      above.labelLength = labelLength;
+      own(node);
+      m_nodes[child].edgeCount = m_nodes[child].edgeCapacity = 0; // the block is the one of `node` now
+      m_nodes[child].labelLength = 0; // no cursor takes it as its record anymore
+      m_freeNodes.push_back(child);
+      return true;
+    }
+
+  public:
+    typedef RadixCursor_t Node_t;
+    static const uint32_t kNullNode = UINT32_MAX;
+    static const uint32_t kNoValue = UINT32_MAX;
+    static const uint32_t kLastCharacter = 1u << 31;
+
+    RadixNodeStore_t()
+    : m_wastedEdges(0)
+    , m_wastedPositions(0)
+    {
+      m_nodes.emplace_back(0);
+      m_positions.push_back({ 0, kLastCharacter });
+    }
+
+    // deep copy : the positions, the records and the payloads keep their ids, so the same edits give the same ids on both stores
+    RadixNodeStore_t(const RadixNodeStore_t&) = default;
+    RadixNodeStore_t(RadixNodeStore_t&&) = default;
+    RadixNodeStore_t& operator=(RadixNodeStore_t&&) = default;
+
+    static Node_t nullNode()
+    {
+      return { kNullNode, kNullNode, 0 };
+    }
+
+    Node_t root() const
+    {
+      return { 0, 0, 0 };
+    }
+
+    Node_t getChild(Node_t node, unsigned int value) const
+    {
+      uint32_t record = recordOf(node);
+      const RadixNode_t& current = m_nodes[record];
+      if (node.position != lastPosition(current)) { // inside the edge, a single child
+        return m_positions[node.position + 1].code == value ? Node_t{ node.position + 1, record, value } : nullNode();
+      }
+
+      const RadixEdge_t* edge = findEdge(current, value);
+      if (edge != m_edges.data() + current.firstEdge + current.edgeCount && edge->code == value) {
+        return { edge->position, edge->record, value };
+      }
+      return nullNode();
+    }
+
+    /*
+    ** A fresh leaf (a last character without children, values nor words below it) whose label ends the positions grows
+    ** by a position, so the characters of a new word after its branching point take a single record.
+    */
+    Node_t insertNReturnChild(Node_t node, unsigned int value)
+    {
+      Node_t child = getChild(node, value);
+      if (child != nullNode()) {
+        return child;
+      }
+
+      if (!isLast(node.position)) {
+        split(node.position);
+      }
+
+      uint32_t record = recordOf(node);
+      const RadixNode_t& current = m_nodes[record];
+      uint32_t position = static_cast<uint32_t>(m_positions.size());
+
+      if (record != 0 && node.position + 1 == position && !current.edgeCount && current.valueSlot == kNoValue && current.wordDepths.empty()) {
+        m_nodes[record].labelLength++;
+        m_positions[node.position].record = record;
+        m_positions.push_back({ value, record | kLastCharacter });
+        return { position, record, value };
+      }
+
+      uint32_t created = newRecord(position);
+      m_positions.push_back({ value, created | kLastCharacter });
+      insertEdge(record, value, created);
+      return { position, created, value };
+    }
+
+    // the child must be a leaf without values, its position is left unused
+    void removeChild(Node_t node, unsigned int value)
+    {
+      Node_t child = getChild(node, value);
+      uint32_t record = child == nullNode() ? 0 : recordOf(child);
+      RadixNode_t& current = m_nodes[record];
+
+      if (child == nullNode() || !isLast(child.position) || current.edgeCount || current.valueSlot != kNoValue) {
+        throw std::logic_error("only a leaf without values can be removed");
+      }
+
+      m_wastedPositions++;
+      if (current.labelLength > 1) { // the end of a label
+        current.labelLength--;
+        m_positions[node.position].record = record | kLastCharacter;
+        return;
+      }
+
+      RadixNode_t& parent = m_nodes[recordOf(node)];
+      RadixEdge_t* begin = m_edges.data() + parent.firstEdge;
+      RadixEdge_t* edge = begin + (findEdge(parent, value) - begin);
+      std::copy(edge + 1, begin + parent.edgeCount, edge);
+      parent.edgeCount--;
+
+      m_wastedEdges += current.edgeCapacity;
+      current.labelLength = 0; // no cursor takes it as its record anymore
+      m_freeNodes.push_back(record);
+    }
+
+    // inside an edge the next position is the single child, given through the same loop so `fn` is inlined once
+    template <typename Fn>
+    void forEachChild(Node_t node, Fn fn) const
+    {
+      uint32_t record = recordOf(node);
+      const RadixNode_t& current = m_nodes[record];
+      const RadixEdge_t* edge = m_edges.data() + current.firstEdge;
+      const RadixEdge_t* end = edge + current.edgeCount;
+      RadixEdge_t next;
+
+      if (node.position != lastPosition(current)) {
+        next = { m_positions[node.position + 1].code, node.position + 1, record };
+        edge = &next;
+        end = edge + 1;
+      }
+      for (; edge != end; edge++) {
+        fn(Node_t{ edge->position, edge->record, edge->code });
+      }
+    }
+
+    unsigned int getContent(Node_t node) const
+    {
+      return node.code;
+    }
+
+    uint32_t getId(Node_t node) const
+    {
+      return node.position;
+    }
+
+    bool isEndOfWord(Node_t node) const
+    {
+      const RadixNode_t& current = m_nodes[recordOf(node)];
+      return node.position == lastPosition(current) && current.valueSlot != kNoValue;
+    }
+
+    // a word ending inside an edge splits it there
+    void addValue(Node_t node, PayloadView_t content, unsigned int score)
+    {
+      if (!isLast(node.position)) {
+        split(node.position);
+      }
+
+      RadixNode_t& current = m_nodes[recordOf(node)];
+      if (current.valueSlot == kNoValue && !m_freeValues.empty()) {
+        current.valueSlot = m_freeValues.back();
+        m_freeValues.pop_back();
+      } else if (current.valueSlot == kNoValue) {
+        current.valueSlot = static_cast<uint32_t>(m_values.size());
+        m_values.emplace_back();
+      }
+
+      m_values[current.valueSlot].push_back({ m_payloads.intern(content), score });
+    }
+
+    // renumbers the values once the payloads without uses are dropped (see `PayloadArena_t::compact`)
+    void reclaimPayloads()
+    {
+      if (!m_payloads.wasteful()) {
+        return;
+      }
+
+      std::vector<uint32_t> ids = m_payloads.compact();
+      for (auto& values : m_values) {
+        for (PayloadRef_t& value : values) {
+          value.id = ids[value.id];
+        }
+      }
+    }
+
+    // removes the value, the node stops being an end of word with its last value
+    bool removeValue(Node_t node, PayloadView_t content)
+    {
+      if (!isEndOfWord(node)) {
+        return false;
+      }
+
+      std::vector<PayloadRef_t>& values = m_values[m_nodes[recordOf(node)].valueSlot];
+      auto found = std::find_if(values.begin(), values.end(), [&](const PayloadRef_t& value) { return m_payloads.get(value.id) == content; });
+      if (found == values.end()) {
+        return false;
+      }
+
+      m_payloads.release(found->id);
+      values.erase(found);
+      if (values.empty()) {
+        clearValues(node);
+      }
+      reclaimPayloads();
+      return true;
+    }
+
+    void clearValues(Node_t node)
+    {
+      if (isEndOfWord(node)) {
+        RadixNode_t& current = m_nodes[recordOf(node)];
+        for (const PayloadRef_t& value : m_values[current.valueSlot]) {
+          m_payloads.release(value.id);
+        }
+        std::vector<PayloadRef_t>().swap(m_values[current.valueSlot]);
+        m_freeValues.push_back(current.valueSlot);
+        current.valueSlot = kNoValue;
+        reclaimPayloads();
+      }
+    }
+
+    // fn(PayloadView_t value, unsigned int score)
+    template <typename Fn>
+    void forEachValue(Node_t node, Fn fn) const
+    {
+      if (isEndOfWord(node)) {
+        for (const PayloadRef_t& value : m_values[m_nodes[recordOf(node)].valueSlot]) {
+          fn(m_payloads.get(value.id), value.score);
+        }
+      }
+    }
+
+    PayloadView_t payload(uint32_t id) const
+    {
+      return m_payloads.get(id);
+    }
+
+    std::size_t payloadCount() const
+    {
+      return m_payloads.size();
+    }
+
+    /*
+    ** A position inside an edge has the subtree of the last character of its record, so its bounds are kept there. The
+    ** trie raises them once the path of a word is complete (see `BasicTrie_t::insertWord`), so the words it gives to a
+    ** position inside an edge are below the last character; a bound which could not be kept there splits the edge.
+    */
+    unsigned int getMaxScore(Node_t node) const
+    {
+      return m_nodes[recordOf(node)].maxScore;
+    }
+
+    void raiseMaxScore(Node_t node, unsigned int score)
+    {
+      RadixNode_t& current = m_nodes[recordOf(node)];
+      current.maxScore = std::max(current.maxScore, score);
+    }
+
+    void setMaxScore(Node_t node, unsigned int score)
+    {
+      m_nodes[recordOf(node)].maxScore = score;
+    }
+
+    WordDepths_t getWordDepths(Node_t node) const
+    {
+      const RadixNode_t& current = m_nodes[recordOf(node)];
+      return shifted(current.wordDepths, lastPosition(current) - node.position);
+    }
+
+    void widenWordDepths(Node_t node, WordDepths_t below, std::size_t offset)
+    {
+      if (below.empty()) {
+        return;
+      }
+      if (offset + below.min < distanceToLast(node.position)) {
+        split(node.position);
+      }
+      uint32_t left = distanceToLast(node.position);
+      m_nodes[owner(node.position)].wordDepths.widen(below, offset - left);
+    }
+
+    void setWordDepths(Node_t node, WordDepths_t depths)
+    {
+      uint32_t left = distanceToLast(node.position);
+      if (!depths.empty() && depths.min < left) {
+        split(node.position);
+        left = 0;
+      }
+
+      WordDepths_t& kept = m_nodes[owner(node.position)].wordDepths;
+      kept = WordDepths_t();
+      if (!depths.empty()) {
+        kept.widen(depths.min - left);
+        kept.widen(depths.max - left);
+      }
+    }
+
+    // bound of the node ids : every position ever given, the ones of removed nodes included
+    std::size_t nodeCount() const
+    {
+      return m_positions.size();
+    }
+
+    /*
+    ** Appends the records and the positions of `shard` (a store built apart, see `BasicBulkLoader_t`) and links its root
+    ** children under the root of this one, every id and offset being shifted past the current ones. The first characters of
+    ** the shard must be new here.
+    */
+    void splice(RadixNodeStore_t& shard)
+    {
+      const RadixNode_t& shardRoot = shard.m_nodes[0];
+      for (uint32_t i = 0; i < shardRoot.edgeCount; i++) {
+        if (getChild(root(), shard.m_edges[shardRoot.firstEdge + i].code) != nullNode()) {
+          throw std::logic_error("the spliced subtrees must start with new characters");
+        }
+      }
+
+      uint32_t nodeOffset = static_cast<uint32_t>(m_nodes.size()) - 1; // the shard root (record and position 0) is left behind
+      uint32_t positionOffset = static_cast<uint32_t>(m_positions.size()) - 1;
+      uint32_t edgeOffset = static_cast<uint32_t>(m_edges.size());
+      uint32_t valueOffset = static_cast<uint32_t>(m_values.size());
+
+      m_nodes.reserve(m_nodes.size() + shard.m_nodes.size() - 1);
+      for (auto node = shard.m_nodes.begin() + 1; node != shard.m_nodes.end(); node++) {
+        m_nodes.push_back(*node);
+        m_nodes.back().labelBegin += positionOffset;
+        m_nodes.back().firstEdge += edgeOffset;
+        if (node->valueSlot != kNoValue) {
+          m_nodes.back().valueSlot += valueOffset;
+        }
+      }
+
+      m_positions.reserve(m_positions.size() + shard.m_positions.size() - 1);
+      for (auto position = shard.m_positions.begin() + 1; position != shard.m_positions.end(); position++) {
+        m_positions.push_back({ position->code, position->record + nodeOffset }); // the flag is above any record
+      }
+
+      m_edges.reserve(m_edges.size() + shard.m_edges.size());
+      for (const RadixEdge_t& edge : shard.m_edges) {
+        m_edges.push_back({ edge.code, edge.position + positionOffset, edge.record + nodeOffset });
+      }
+
+      std::vector<uint32_t> payloadIds = m_payloads.absorb(shard.m_payloads);
+      m_values.reserve(m_values.size() + shard.m_values.size());
+      for (auto& values : shard.m_values) {
+        for (PayloadRef_t& value : values) {
+          value.id = payloadIds[value.id];
+        }
+        m_values.push_back(std::move(values));
+      }
+      for (uint32_t node : shard.m_freeNodes) {
+        m_freeNodes.push_back(node + nodeOffset);
+      }
+      for (uint32_t slot : shard.m_freeValues) {
+        m_freeValues.push_back(slot + valueOffset);
+      }
+
+      for (uint32_t i = 0; i < shardRoot.edgeCount; i++) {
+        const RadixEdge_t& edge = shard.m_edges[shardRoot.firstEdge + i];
+        insertEdge(0, edge.code, edge.record + nodeOffset);
+      }
+
+      m_nodes[0].maxScore = std::max(m_nodes[0].maxScore, shardRoot.maxScore);
+      m_nodes[0].wordDepths.widen(shardRoot.wordDepths, 0);
+      m_wastedEdges += shard.m_wastedEdges + shardRoot.edgeCapacity; // the copied block of the shard root is not linked
+      m_wastedPositions += shard.m_wastedPositions;
+
+      shard = RadixNodeStore_t();
+    }
+
+    // joins the records split apart by words removed since, then repacks the children blocks in breadth-first order
+    void shrinkToFit()
+    {
+      std::vector<RadixEdge_t> packed;
+      std::queue<uint32_t> pending;
+      pending.push(0);
+
+      while (!pending.empty()) {
+        uint32_t node = pending.front();
+        pending.pop();
+        while (join(node)) {
+        }
+
+        RadixNode_t& current = m_nodes[node];
+        uint32_t newFirst = static_cast<uint32_t>(packed.size());
+        for (uint32_t i = 0; i < current.edgeCount; i++) {
+          packed.push_back(m_edges[current.firstEdge + i]);
+          pending.push(m_edges[current.firstEdge + i].record);
+        }
+
+        current.firstEdge = newFirst;
+        current.edgeCapacity = current.edgeCount;
+      }
+
+      packed.shrink_to_fit();
+      m_edges.swap(packed);
+      m_nodes.shrink_to_fit();
+      m_positions.shrink_to_fit();
+      m_wastedEdges = 0;
+    }
+
+    // the nodes are the records, each one standing for its whole label; the positions are counted on the node bytes
+    MemoryUsage_t memoryUsage() const
+    {
+      MemoryUsage_t usage;
+      usage.nodes = m_nodes.size() - m_freeNodes.size();
+      usage.nodeBytes = m_nodes.capacity() * sizeof(RadixNode_t) + (m_positions.capacity() - m_wastedPositions) * sizeof(RadixPosition_t);
+
+      std::size_t usedEdges = 0;
+      for (const RadixNode_t& node : m_nodes) {
+        usedEdges += node.edgeCount;
+      }
+      usage.edges = usedEdges;
+      usage.edgeBytes = usedEdges * sizeof(RadixEdge_t);
+      usage.wastedBytes = (m_edges.capacity() - usedEdges) * sizeof(RadixEdge_t) + m_wastedPositions * sizeof(RadixPosition_t);
+
+      usage.payloadBytes = m_values.capacity() * sizeof(m_values.front()) + m_payloads.memoryUsage();
+      for (const auto& values : m_values) {
+        usage.payloadBytes += values.capacity() * sizeof(PayloadRef_t);
+      }
+
+      return usage;
+    }
+  };
+}
+
+namespace std {
+  template <>
+  struct hash<trie::RadixCursor_t> {
+    std::size_t operator()(const trie::RadixCursor_t& node) const
+    {
+      return std::hash<uint32_t>()(node.position);
+    }
+  };
+}
+#endif
@@ -0,0 +1,249 @@
+#ifndef _ZYNTHETIC_RESULT_CACHE_
+#define _ZYNTHETIC_RESULT_CACHE_
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace trie {
+
+  /*
+  ** Every state of every trie gets its own generation : the constructors take a new one and so does each modification, a
+  ** copy keeping the one of its source (same words, same payload ids). A cached result is only given back to a trie on
+  ** the generation it was computed on.
+  */
+  inline uint64_t nextTrieGeneration()
+  {
+    static std::atomic<uint64_t> generation(0);
+    return generation.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+
+  // a cached result, the payload is resolved again by id on the trie asking for it
+  struct CachedResponse_t {
+    uint32_t payload;
+    int editDistance;
+    unsigned int score;
+  };
+
+  struct ResultCacheStats_t {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions; // entries dropped to fit the memory bound
+    uint64_t invalidations; // entries found computed on another generation (the trie changed meanwhile)
+    uint64_t rejected; // results too large to be cached at all
+    std::size_t entries;
+    std::size_t bytes;
+    std::size_t capacity;
+
+    ResultCacheStats_t()
+    : hits(0)
+    , misses(0)
+    , evictions(0)
+    , invalidations(0)
+    , rejected(0)
+    , entries(0)
+    , bytes(0)
+    , capacity(0)
+    {
+    }
+
+    double hitRate() const
+    {
+      return hits + misses ? double(hits) / (hits + misses) : 0;
+    }
+
+    void print(std::ostream& out) const
+    {
+      out << "[cache] hits=" << hits
+          << " misses=" << misses
+          << " hit_rate=" << hitRate()
+          << " evictions=" << evictions
+          << " invalidations=" << invalidations
+          << " rejected=" << rejected
+          << " entries=" << entries
+          << " bytes=" << bytes
+          << " capacity=" << capacity << '\n';
+    }
+  };
+
+  /*
+  ** LRU cache of query results, shared by any amount of threads (see `BasicTrie_t::setResultCache`). The keys are spread
+  ** over independent shards, each one with its own lock, list and share of the memory bound, so concurrent queries only
+  ** meet on the same shard. The bound counts the keys, the results and the bookkeeping of every entry.
+  ** The entries of an older generation are never returned : they are dropped when found, or evicted as the least used.
+  */
+  class ResultCache_t {
+    struct Entry_t {
+      const std::string* key; // owned by the index of the shard
+      uint64_t generation;
+      std::vector<CachedResponse_t> responses;
+      std::size_t bytes;
+    };
+
+    typedef std::list<Entry_t> EntryList_t;
+
+    struct Shard_t {
+      std::mutex lock; // guards the fields below
+      EntryList_t entries; // most recently used first
+      std::unordered_map<std::string, EntryList_t::iterator> index;
+      std::size_t bytes;
+      ResultCacheStats_t stats;
+
+      Shard_t()
+      : bytes(0)
+      {
+      }
+    };
+
+    static const std::size_t kEntryOverhead = sizeof(Entry_t) + 4 * sizeof(void*) + sizeof(std::string) + sizeof(EntryList_t::iterator) + 2 * sizeof(void*);
+
+    std::unique_ptr<Shard_t[]> m_shards;
+    std::size_t m_shardCount; // power of two
+    std::size_t m_shardCapacity; // bytes
+
+    Shard_t& shardOf(const std::string& key) const
+    {
+      return m_shards[std::hash<std::string>()(key) & (m_shardCount - 1)];
+    }
+
+    static void erase(Shard_t& shard, EntryList_t::iterator entry)
+    {
+      shard.bytes -= entry->bytes;
+      shard.index.erase(*entry->key);
+      shard.entries.erase(entry);
+    }
+
+  public:
+    // `bytes` is shared evenly by the shards, whose amount is rounded up to a power of two
+    explicit ResultCache_t(std::size_t bytes, std::size_t shards = 16)
+    : m_shardCount(1)
+    {
+      while (m_shardCount < std::max<std::size_t>(shards, 1)) {
+        m_shardCount <<= 1;
+      }
+      m_shards.reset(new Shard_t[m_shardCount]);
+      m_shardCapacity = bytes / m_shardCount;
+    }
+
+    ResultCache_t(const ResultCache_t&) = delete;
+    ResultCache_t& operator=(const ResultCache_t&) = delete;
+
+    /*
+    ** Key of a query : its kind, engine, fuzzy threshold and limit, then the character codes of the keyword, so every
+    ** spelling the charmap folds together (case, accents) shares an entry. A code below 255 takes a byte, the others five.
+    */
+    static void makeKey(int kind, int engine, int threshold, std::size_t limit, const std::vector<unsigned int>& codes, std::string& key)
+    {
+      uint64_t limit64 = limit;
+      key.clear();
+      key += static_cast<char>(kind);
+      key += static_cast<char>(engine);
+      key += static_cast<char>(threshold);
+      key.append(reinterpret_cast<const char*>(&limit64), sizeof(limit64));
+      for (unsigned int code : codes) {
+        if (code < 0xFF) {
+          key += static_cast<char>(code);
+        } else {
+          key += static_cast<char>(0xFF);
+          key.append(reinterpret_cast<const char*>(&code), sizeof(code));
+        }
+      }
+    }
+
+    // copies the cached result of `key` on `responses`, false when it is missing or was computed on another generation
+    bool find(const std::string& key, uint64_t generation, std::vector<CachedResponse_t>& responses)
+    {
+      Shard_t& shard = shardOf(key);
+      std::lock_guard<std::mutex> guard(shard.lock);
+
+      auto found = shard.index.find(key);
+      if (found == shard.index.end()) {
+        shard.stats.misses++;
+        return false;
+      }
+      if (found->second->generation != generation) {
+        erase(shard, found->second);
+        shard.stats.invalidations++;
+        shard.stats.misses++;
+        return false;
+      }
+
+      shard.entries.splice(shard.entries.begin(), shard.entries, found->second);
+      responses.assign(found->second->responses.begin(), found->second->responses.end());
+      shard.stats.hits++;
+      return true;
+    }
+
+    // stores the result of `key`, evicting the least recently used entries of its shard to stay under the bound
+    void insert(const std::string& key, uint64_t generation, const std::vector<CachedResponse_t>& responses)
+    {
+      Shard_t& shard = shardOf(key);
+      std::size_t bytes = kEntryOverhead + 2 * key.size() + responses.size() * sizeof(CachedResponse_t);
+      std::lock_guard<std::mutex> guard(shard.lock);
+
+      auto found = shard.index.find(key);
+      if (found != shard.index.end()) { // another thread answered it meanwhile, or an older generation
+        erase(shard, found->second);
+      }
+      if (bytes > m_shardCapacity) {
+        shard.stats.rejected++;
+        return;
+      }
+
+      while (shard.bytes + bytes > m_shardCapacity) {
+        erase(shard, std::prev(shard.entries.end()));
+        shard.stats.evictions++;
+      }
+
+      auto indexed = shard.index.emplace(key, shard.entries.end()).first;
+      shard.entries.push_front({ &indexed->first, generation, responses, bytes });
+      indexed->second = shard.entries.begin();
+      shard.bytes += bytes;
+    }
+
+    // drops every entry, the counters are kept
+    void clear()
+    {
+      for (std::size_t i = 0; i < m_shardCount; i++) {
+        std::lock_guard<std::mutex> guard(m_shards[i].lock);
+        m_shards[i].entries.clear();
+        m_shards[i].index.clear();
+        m_shards[i].bytes = 0;
+      }
+    }
+
+    ResultCacheStats_t stats() const
+    {
+      ResultCacheStats_t total;
+      for (std::size_t i = 0; i < m_shardCount; i++) {
+        std::lock_guard<std::mutex> guard(m_shards[i].lock);
+        const ResultCacheStats_t& shard = m_shards[i].stats;
+        total.hits += shard.hits;
+        total.misses += shard.misses;
+        total.evictions += shard.evictions;
+        total.invalidations += shard.invalidations;
+        total.rejected += shard.rejected;
+        total.entries += m_shards[i].entries.size();
+        total.bytes += m_shards[i].bytes;
+      }
+      total.capacity = m_shardCapacity * m_shardCount;
+      return total;
+    }
+
+    void resetStats()
+    {
+      for (std::size_t i = 0; i < m_shardCount; i++) {
+        std::lock_guard<std::mutex> guard(m_shards[i].lock);
+        m_shards[i].stats = ResultCacheStats_t();
+      }
+    }
+  };
+}
+#endif
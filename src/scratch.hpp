@@ -0,0 +1,143 @@
+#ifndef _ZYNTHETIC_SCRATCH_
+#define _ZYNTHETIC_SCRATCH_
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "payload.hpp"
+#include "query_options.hpp"
+#include "result_cache.hpp"
+#include "stats.hpp"
+
+namespace trie {
+
+  /*
+  ** Membership table over dense node ids : an id belongs to the current generation when its stamp matches, so starting a new
+  ** set is a counter increment instead of a clear (the stamps are only rewritten when the counter wraps around).
+  */
+  class StampedIndex_t {
+    std::vector<uint32_t> m_stamps;
+    std::vector<uint32_t> m_slots;
+    uint32_t m_generation;
+
+  public:
+    static const uint32_t kNone = UINT32_MAX;
+
+    StampedIndex_t()
+    : m_generation(0)
+    {
+    }
+
+    // starts an empty set able to hold the ids [0, size)
+    void reset(std::size_t size)
+    {
+      if (m_stamps.size() < size) {
+        m_stamps.resize(size, 0);
+        m_slots.resize(size, 0);
+      }
+
+      if (++m_generation == 0) {
+        std::fill(m_stamps.begin(), m_stamps.end(), 0);
+        m_generation = 1;
+      }
+    }
+
+    bool contains(uint32_t id) const
+    {
+      return m_stamps[id] == m_generation;
+    }
+
+    // slot given to the id, kNone when it is not on the set
+    uint32_t find(uint32_t id) const
+    {
+      return m_stamps[id] == m_generation ? m_slots[id] : kNone;
+    }
+
+    void set(uint32_t id, uint32_t slot)
+    {
+      m_stamps[id] = m_generation;
+      m_slots[id] = slot;
+    }
+
+    // adds the id, returns false when it was already there
+    bool insert(uint32_t id)
+    {
+      if (m_stamps[id] == m_generation) {
+        return false;
+      }
+      m_stamps[id] = m_generation;
+      return true;
+    }
+
+    std::size_t capacity() const
+    {
+      return m_stamps.size();
+    }
+  };
+
+  template <typename Node>
+  struct BasicRankedEntry_t {
+    int64_t rank; // exact rank of a value, or the best rank a node subtree can hold
+    int editDistance;
+    Node node;
+    bool isValue;
+    PayloadView_t value;
+    unsigned int score;
+
+    bool operator<(const BasicRankedEntry_t& other) const // the heap pops the greatest
+    {
+      if (rank != other.rank) {
+        return rank < other.rank;
+      }
+      if (editDistance != other.editDistance) {
+        return editDistance > other.editDistance;
+      }
+      return !isValue && other.isValue;
+    }
+  };
+
+  /*
+  ** Edit distances of a keyword (up to 64 codes) against a path of the trie, kept as the differences between consecutive
+  ** prefixes of the keyword (Myers / Hyyro) : D[i + 1] - D[i] is +1 on the bits of `positive`, -1 on those of `negative`.
+  */
+  struct BitRow_t {
+    uint64_t positive;
+    uint64_t negative;
+    uint64_t reach; // positions of the keyword a child has to match to stay within the bound, every bit when it does not have to
+    int distance; // D[m], the distance between the whole keyword and the path
+  };
+
+  /*
+  ** Per-thread working memory of a query. Every container is cleared, never freed, so once a thread has run a few queries
+  ** the fuzzy engine stops allocating.
+  */
+  template <typename ActiveNode, typename Node>
+  struct BasicQueryScratch_t {
+    std::vector<unsigned int> codes; // character codes of the keyword
+    std::vector<ActiveNode> sets[2]; // the active node set of the previous and of the current character
+    StampedIndex_t members; // node id -> position on the set being built
+    std::vector<std::pair<Node, int>> expansion; // breadth-first queue of the match addiction
+    std::vector<ActiveNode> order; // active nodes sorted by distance
+    std::vector<Node> pending; // breadth-first queue of the completions
+    StampedIndex_t visited; // nodes already reached by the completions
+    std::vector<BasicRankedEntry_t<Node>> frontier; // heap of the ranked completions
+    std::vector<std::pair<int, Node>> matches; // words found by the deletion index or the automaton, with their edit distance
+    std::vector<std::pair<Node, int>> descent; // depth-first stack of the automaton, with the depth of each node
+    std::vector<uint64_t> positions; // code -> bits of the keyword positions holding it
+    std::vector<BitRow_t> bitRows; // bitRows[d] : row of the node of depth d on the current path
+    std::vector<int> rows; // the same as full rows, for the keywords longer than 64 codes
+    std::string cacheKey; // key of the query on the result cache
+    std::vector<CachedResponse_t> cached; // result given to or taken from the result cache
+    QueryStats_t* stats; // what the running query did, null unless a stats collector is attached (see `QueryProbe_t`)
+    QueryStats_t record;
+    QueryBudget_t* budget; // limits of the running query, null unless it was given options (see `BudgetScope_t`)
+
+    BasicQueryScratch_t()
+    : stats(nullptr)
+    , budget(nullptr)
+    {
+    }
+  };
+}
+#endif
@@ -0,0 +1,684 @@
+#ifndef _ZYNTHETIC_SERVER_
+#define _ZYNTHETIC_SERVER_
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <functional>
+#include <mutex>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+#include "thread_pool.hpp"
+#include "trie.hpp"
+
+namespace trie {
+
+  /*
+  ** Line server : every request is a line and gets exactly one response line, in the order the requests came, so a client
+  ** can pipeline as many requests as it wants without waiting for the answers.
+  ** A single thread runs the event loop (epoll) over the listening sockets and every connection, and the requests read on a
+  ** pass are handed as one task to the pool, whose workers run the handler. The responses go back to the loop, which writes
+  ** them in order. `QUIT` ends the connection once the responses to the earlier requests are written.
+  ** A connection with too many requests waiting (or too many bytes unsent) is not read until its client catches up.
+  */
+  class Server_t {
+  public:
+    typedef std::function<void(const std::string& request, std::string& response)> Handler_t;
+
+  private:
+    static const std::size_t kMaxLineSize = 1 << 16;
+    static const std::size_t kMaxPendingRequests = 4096; // per connection
+    static const std::size_t kMaxUnsentBytes = 1 << 22; // per connection
+    static const uint64_t kWakeId = 0; // epoll ids : the wake eventfd, then the listeners, then the connections
+    static const uint64_t kFirstConnectionId = 1 << 16;
+    static const int kAcceptRetryMs = 100; // how long the listeners stay paused when no connection closes meanwhile
+
+    struct Slot_t {
+      bool ready;
+      std::string response;
+    };
+
+    struct Connection_t {
+      int fd;
+      std::string input; // bytes read after the last complete line
+      std::string output; // responses ready to be written
+      std::size_t outputSent;
+      std::deque<Slot_t> slots; // one per request not written yet, oldest first
+      uint64_t firstSlot; // sequence number of slots.front()
+      uint32_t events; // events registered on epoll, 0 when the socket is out of it (epoll would keep reporting a hang up)
+      bool closing; // no more requests are read, the connection closes once `slots` and `output` are empty
+    };
+
+    struct Completion_t {
+      uint64_t connection;
+      uint64_t firstSlot;
+      std::vector<std::string> responses;
+    };
+
+    struct Listener_t {
+      int fd;
+      std::string unixPath; // removed on shutdown, empty for TCP
+    };
+
+    Handler_t m_handler;
+    ThreadPool_t& m_pool;
+    int m_epoll;
+    int m_wake; // eventfd which breaks epoll_wait on stop and on completions
+    std::vector<Listener_t> m_listeners;
+    bool m_listenersPaused; // out of epoll, see `accept`
+    std::chrono::steady_clock::time_point m_listenersPausedAt;
+    std::unordered_map<uint64_t, Connection_t> m_connections;
+    uint64_t m_nextConnection;
+    std::atomic<bool> m_stopping;
+
+    std::mutex m_completionLock; // guards the fields below
+    std::condition_variable m_tasksDone;
+    std::vector<Completion_t> m_completions;
+    std::size_t m_tasks; // tasks handed to the pool and not finished
+
+    static void throwSystemError(const std::string& what)
+    {
+      throw std::runtime_error(what + ": " + std::strerror(errno));
+    }
+
+    static void setNonBlocking(int fd)
+    {
+      int flags = fcntl(fd, F_GETFL, 0);
+      if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        throwSystemError("fcntl");
+      }
+    }
+
+    void watch(int fd, uint64_t id, uint32_t events, int operation)
+    {
+      struct epoll_event event;
+      event.events = events;
+      event.data.u64 = id;
+      if (epoll_ctl(m_epoll, operation, fd, &event) != 0) {
+        throwSystemError("epoll_ctl");
+      }
+    }
+
+    void wake()
+    {
+      uint64_t one = 1;
+      ssize_t written = write(m_wake, &one, sizeof(one)); // async-signal-safe, `stop` may run on a signal handler
+      (void)written;
+    }
+
+    void addListener(int fd, const std::string& unixPath)
+    {
+      if (::listen(fd, SOMAXCONN) != 0) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        throwSystemError("listen");
+      }
+      setNonBlocking(fd);
+      watch(fd, m_listeners.size() + 1, EPOLLIN, EPOLL_CTL_ADD);
+      m_listeners.push_back({ fd, unixPath });
+    }
+
+    void listenUnix(const std::string& path)
+    {
+      struct sockaddr_un address;
+      if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("invalid unix socket path '" + path + "'");
+      }
+
+      int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+      if (fd < 0) {
+        throwSystemError("socket");
+      }
+
+      std::memset(&address, 0, sizeof(address));
+      address.sun_family = AF_UNIX;
+      std::memcpy(address.sun_path, path.c_str(), path.size());
+      unlink(path.c_str()); // a socket file left by a previous run
+
+      if (bind(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        throwSystemError("bind '" + path + "'");
+      }
+      addListener(fd, path);
+    }
+
+    void listenTcp(const std::string& host, const std::string& port)
+    {
+      struct addrinfo hints;
+      struct addrinfo* addresses = nullptr;
+      std::memset(&hints, 0, sizeof(hints));
+      hints.ai_family = AF_UNSPEC;
+      hints.ai_socktype = SOCK_STREAM;
+      hints.ai_flags = AI_PASSIVE;
+
+      int status = getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &addresses);
+      if (status != 0) {
+        throw std::runtime_error("cannot resolve '" + host + ":" + port + "': " + gai_strerror(status));
+      }
+
+      int fd = -1;
+      for (struct addrinfo* current = addresses; current && fd < 0; current = current->ai_next) {
+        fd = socket(current->ai_family, current->ai_socktype | SOCK_CLOEXEC, current->ai_protocol);
+        if (fd < 0) {
+          continue;
+        }
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, current->ai_addr, current->ai_addrlen) != 0) {
+          close(fd);
+          fd = -1;
+        }
+      }
+      freeaddrinfo(addresses);
+
+      if (fd < 0) {
+        throwSystemError("bind '" + host + ":" + port + "'");
+      }
+      addListener(fd, "");
+    }
+
+    // takes the listeners out of epoll (or puts them back), which reports them for as long as their backlog is not empty
+    void pauseListeners(bool paused)
+    {
+      if (m_listenersPaused == paused) {
+        return;
+      }
+      for (std::size_t i = 0; i < m_listeners.size(); i++) {
+        watch(m_listeners[i].fd, i + 1, EPOLLIN, paused ? EPOLL_CTL_DEL : EPOLL_CTL_ADD);
+      }
+      m_listenersPaused = paused;
+      m_listenersPausedAt = std::chrono::steady_clock::now();
+    }
+
+    /*
+    ** Accepts the whole backlog. A client which went away before being accepted (ECONNABORTED, EPROTO) is skipped. When the
+    ** process is out of descriptors or memory (EMFILE, ENFILE, ENOBUFS, ENOMEM) the pending clients cannot be accepted,
+    ** and the level-triggered listeners would wake the loop on every pass : they are paused until a connection closes or
+    ** kAcceptRetryMs pass, the clients waiting on the backlog meanwhile. Any other error pauses them the same way.
+    */
+    void accept(const Listener_t& listener)
+    {
+      for (;;) {
+        int fd = accept4(listener.fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+          if (errno == EINTR || errno == ECONNABORTED || errno == EPROTO) {
+            continue;
+          }
+          if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            pauseListeners(true);
+          }
+          return;
+        }
+
+        if (listener.unixPath.empty()) {
+          int one = 1;
+          setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+
+        uint64_t id = m_nextConnection++;
+        Connection_t& connection = m_connections[id];
+        connection.fd = fd;
+        connection.outputSent = 0;
+        connection.firstSlot = 0;
+        connection.events = EPOLLIN;
+        connection.closing = false;
+        watch(fd, id, connection.events, EPOLL_CTL_ADD);
+      }
+    }
+
+    void closeConnection(uint64_t id)
+    {
+      auto found = m_connections.find(id);
+      if (found != m_connections.end()) {
+        close(found->second.fd); // also drops it from epoll
+        m_connections.erase(found);
+        pauseListeners(false); // a descriptor is free again
+      }
+    }
+
+    // hands the complete lines to the pool as a single task
+    void dispatch(uint64_t id, Connection_t& connection, std::vector<std::string>& requests)
+    {
+      if (requests.empty()) {
+        return;
+      }
+
+      uint64_t firstSlot = connection.firstSlot + connection.slots.size();
+      connection.slots.resize(connection.slots.size() + requests.size(), { false, std::string() });
+
+      {
+        std::lock_guard<std::mutex> guard(m_completionLock);
+        m_tasks++;
+      }
+
+      m_pool.submit([this, id, firstSlot, requests = std::move(requests)]() {
+        Completion_t completion = { id, firstSlot, std::vector<std::string>(requests.size()) };
+        for (std::size_t i = 0; i < requests.size(); i++) {
+          try {
+            m_handler(requests[i], completion.responses[i]);
+          } catch (const std::exception& error) {
+            completion.responses[i] = std::string("ERR ") + error.what();
+          }
+        }
+
+        std::lock_guard<std::mutex> guard(m_completionLock);
+        m_completions.push_back(std::move(completion));
+        m_tasks--;
+        m_tasksDone.notify_all();
+        wake();
+      });
+      requests = std::vector<std::string>();
+    }
+
+    // the slot of a request answered by the loop itself
+    void answerNow(Connection_t& connection, const std::string& response)
+    {
+      connection.slots.push_back({ true, response });
+    }
+
+    void read(uint64_t id, Connection_t& connection)
+    {
+      char buffer[1 << 14];
+      std::vector<std::string> requests;
+      ssize_t size = recv(connection.fd, buffer, sizeof(buffer), 0);
+
+      if (size <= 0) {
+        if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+          return;
+        }
+        connection.closing = true; // the client is gone or half-closed, the answers already due are still written
+        return;
+      }
+
+      connection.input.append(buffer, static_cast<std::size_t>(size));
+      std::size_t begin = 0;
+
+      for (std::size_t end; !connection.closing && (end = connection.input.find('\n', begin)) != std::string::npos; begin = end + 1) {
+        std::size_t lineEnd = end > begin && connection.input[end - 1] == '\r' ? end - 1 : end;
+        std::string line = connection.input.substr(begin, lineEnd - begin);
+
+        if (line == "QUIT" || line == "quit") {
+          dispatch(id, connection, requests); // the earlier requests keep their place
+          answerNow(connection, "BYE");
+          connection.closing = true;
+        } else {
+          requests.push_back(std::move(line));
+        }
+      }
+      connection.input.erase(0, begin);
+
+      if (!connection.closing && connection.input.size() > kMaxLineSize) {
+        dispatch(id, connection, requests);
+        answerNow(connection, "ERR request too long");
+        connection.closing = true;
+      }
+      dispatch(id, connection, requests);
+    }
+
+    // moves the answered requests at the front to the output and writes as much of it as the socket takes
+    void flush(Connection_t& connection)
+    {
+      while (!connection.slots.empty() && connection.slots.front().ready) {
+        connection.output += connection.slots.front().response;
+        connection.output += '\n';
+        connection.slots.pop_front();
+        connection.firstSlot++;
+      }
+
+      while (connection.outputSent < connection.output.size()) {
+        ssize_t sent = send(connection.fd, connection.output.data() + connection.outputSent, connection.output.size() - connection.outputSent, MSG_NOSIGNAL);
+        if (sent < 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            connection.slots.clear(); // broken connection, nothing more can be written
+            connection.output.clear();
+            connection.outputSent = 0;
+            connection.closing = true;
+          }
+          break;
+        }
+        connection.outputSent += static_cast<std::size_t>(sent);
+      }
+
+      if (connection.outputSent == connection.output.size()) {
+        connection.output.clear();
+        connection.outputSent = 0;
+      }
+    }
+
+    // flushes the connection and updates what epoll watches on it, closing it once it is done
+    void update(uint64_t id)
+    {
+      auto found = m_connections.find(id);
+      if (found == m_connections.end()) {
+        return;
+      }
+
+      Connection_t& connection = found->second;
+      flush(connection);
+
+      if (connection.closing && connection.slots.empty() && connection.output.empty()) {
+        closeConnection(id);
+        return;
+      }
+
+      bool backlogged = connection.slots.size() >= kMaxPendingRequests || connection.output.size() - connection.outputSent >= kMaxUnsentBytes;
+      uint32_t events = (connection.closing || backlogged ? 0 : uint32_t(EPOLLIN)) | (connection.output.empty() ? 0 : uint32_t(EPOLLOUT));
+      if (events != connection.events) {
+        watch(connection.fd, id, events, !events ? EPOLL_CTL_DEL : !connection.events ? EPOLL_CTL_ADD : EPOLL_CTL_MOD);
+        connection.events = events;
+      }
+    }
+
+    void collectCompletions()
+    {
+      uint64_t counter;
+      ssize_t drained = ::read(m_wake, &counter, sizeof(counter));
+      (void)drained;
+
+      std::vector<Completion_t> completions;
+      {
+        std::lock_guard<std::mutex> guard(m_completionLock);
+        completions.swap(m_completions);
+      }
+
+      for (auto& completion : completions) {
+        auto found = m_connections.find(completion.connection);
+        if (found == m_connections.end()) {
+          continue; // the connection broke meanwhile
+        }
+
+        Connection_t& connection = found->second;
+        for (std::size_t i = 0; i < completion.responses.size(); i++) {
+          uint64_t slot = completion.firstSlot + i - connection.firstSlot;
+          if (slot < connection.slots.size()) {
+            connection.slots[slot].ready = true;
+            connection.slots[slot].response.swap(completion.responses[i]);
+          }
+        }
+        update(completion.connection);
+      }
+    }
+
+  public:
+    Server_t(Handler_t handler, ThreadPool_t& pool)
+    : m_handler(handler)
+    , m_pool(pool)
+    , m_listenersPaused(false)
+    , m_nextConnection(kFirstConnectionId)
+    , m_stopping(false)
+    , m_tasks(0)
+    {
+      m_epoll = epoll_create1(EPOLL_CLOEXEC);
+      if (m_epoll < 0) {
+        throwSystemError("epoll_create1");
+      }
+
+      m_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+      if (m_wake < 0) {
+        close(m_epoll);
+        throwSystemError("eventfd");
+      }
+      watch(m_wake, kWakeId, EPOLLIN, EPOLL_CTL_ADD);
+    }
+
+    Server_t(const Server_t&) = delete;
+    Server_t& operator=(const Server_t&) = delete;
+
+    ~Server_t()
+    {
+      {
+        std::unique_lock<std::mutex> guard(m_completionLock); // the tasks still running push to this object
+        m_tasksDone.wait(guard, [this] { return m_tasks == 0; });
+      }
+
+      for (auto& connection : m_connections) {
+        close(connection.second.fd);
+      }
+      for (auto& listener : m_listeners) {
+        close(listener.fd);
+        if (!listener.unixPath.empty()) {
+          unlink(listener.unixPath.c_str());
+        }
+      }
+      close(m_wake);
+      close(m_epoll);
+    }
+
+    /*
+    ** Starts listening on `unix:PATH`, `tcp:PORT` (every interface) or `tcp:HOST:PORT`. Can be called several times, before `run`.
+    */
+    void listen(const std::string& address)
+    {
+      if (address.compare(0, 5, "unix:") == 0) {
+        listenUnix(address.substr(5));
+      } else if (address.compare(0, 4, "tcp:") == 0) {
+        std::string endpoint = address.substr(4);
+        std::size_t colon = endpoint.rfind(':');
+        std::string host = colon == std::string::npos ? "" : endpoint.substr(0, colon);
+        if (host.size() > 1 && host.front() == '[' && host.back() == ']') { // tcp:[::1]:PORT
+          host = host.substr(1, host.size() - 2);
+        }
+        listenTcp(host, colon == std::string::npos ? endpoint : endpoint.substr(colon + 1));
+      } else {
+        throw std::runtime_error("invalid address '" + address + "', expected unix:PATH, tcp:PORT or tcp:HOST:PORT");
+      }
+    }
+
+    // serves until `stop` is called, then closes every connection (the responses not written yet are lost)
+    void run()
+    {
+      if (m_listeners.empty()) {
+        throw std::logic_error("Server_t::run called before listen");
+      }
+
+      std::vector<struct epoll_event> events(256);
+      while (!m_stopping.load()) {
+        int ready = epoll_wait(m_epoll, events.data(), static_cast<int>(events.size()), m_listenersPaused ? kAcceptRetryMs : -1);
+        if (ready < 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          throwSystemError("epoll_wait");
+        }
+        if (m_listenersPaused && std::chrono::steady_clock::now() - m_listenersPausedAt >= std::chrono::milliseconds(kAcceptRetryMs)) {
+          pauseListeners(false);
+        }
+
+        for (int i = 0; i < ready; i++) {
+          uint64_t id = events[i].data.u64;
+
+          if (id == kWakeId) {
+            collectCompletions();
+          } else if (id < kFirstConnectionId) {
+            accept(m_listeners[id - 1]);
+          } else {
+            auto found = m_connections.find(id);
+            if (found == m_connections.end()) {
+              continue;
+            }
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+              read(id, found->second);
+            }
+            update(id);
+          }
+        }
+      }
+
+      for (auto& connection : m_connections) {
+        close(connection.second.fd);
+      }
+      m_connections.clear();
+    }
+
+    // makes `run` return; safe from any thread and from a signal handler
+    void stop()
+    {
+      m_stopping.store(true);
+      wake();
+    }
+  };
+
+  /*
+  ** Query commands of the server, one per line, the keyword being the rest of the line :
+  **   EXACT <keyword>          OK <n>[\t<value>]...
+  **   FUZZY <k> <keyword>      OK <n>[\t<value>\t<distance>\t<score>]...   (searchSimilarKeywordTopK)
+  **   COMPLETE <k> <keyword>   same format                                  (autocompleteTopK)
+  **   RANKED <k> <keyword>     same format                                  (autocompleteRanked)
+  **   PING                     PONG
+  ** k = 0 asks for every result; k is capped by `setMaxResults` either way. The tabs, line breaks and backslashes of the
+  ** values are escaped as \t, \n, \r and \\. A malformed request gets `ERR <reason>`.
+  ** With a query timeout (see `setQueryTimeout`) a FUZZY, COMPLETE or RANKED request running out of time answers the results
+  ** found so far as `PARTIAL <n>...`, in the same format.
+  */
+  template <typename Storage>
+  class BasicQueryProtocol_t {
+    const BasicTrie_t<Storage>& m_trie;
+    std::size_t m_maxResults;
+    std::chrono::microseconds m_queryTimeout; // 0 for none
+
+    static void appendEscaped(std::string& out, PayloadView_t value)
+    {
+      for (std::size_t i = 0; i < value.size; i++) {
+        char character = value.data[i];
+        switch (character) {
+        case '\t':
+          out += "\\t";
+          break;
+        case '\n':
+          out += "\\n";
+          break;
+        case '\r':
+          out += "\\r";
+          break;
+        case '\\':
+          out += "\\\\";
+          break;
+        default:
+          out += character;
+        }
+      }
+    }
+
+    static void appendResults(std::string& response, const std::vector<TrieResponseView_t>& results, QueryStatus_t status)
+    {
+      response = (status == kQueryComplete ? "OK " : "PARTIAL ") + std::to_string(results.size());
+      for (auto& result : results) {
+        response += '\t';
+        appendEscaped(response, result.value);
+        response += '\t';
+        response += std::to_string(result.editDistance);
+        response += '\t';
+        response += std::to_string(result.score);
+      }
+    }
+
+    // parses `<k> <keyword>`, false when k is not a number
+    bool parseLimit(const std::string& arguments, std::size_t& limit, std::string& keyword) const
+    {
+      std::size_t space = arguments.find(' ');
+      std::string number = arguments.substr(0, space);
+      if (number.empty() || number.find_first_not_of("0123456789") != std::string::npos || number.size() > 9) {
+        return false;
+      }
+
+      limit = std::strtoul(number.c_str(), nullptr, 10);
+      limit = limit == 0 ? m_maxResults : std::min(limit, m_maxResults);
+      keyword = space == std::string::npos ? "" : arguments.substr(space + 1);
+      return true;
+    }
+
+  public:
+    explicit BasicQueryProtocol_t(const BasicTrie_t<Storage>& trie)
+    : m_trie(trie)
+    , m_maxResults(1000)
+    , m_queryTimeout(0)
+    {
+    }
+
+    // most results a single response carries (default : 1000)
+    void setMaxResults(std::size_t limit)
+    {
+      this->m_maxResults = std::max<std::size_t>(limit, 1);
+    }
+
+    // longest time a fuzzy request runs, from the moment it is parsed (default : 0, no limit)
+    void setQueryTimeout(std::chrono::microseconds timeout)
+    {
+      this->m_queryTimeout = timeout;
+    }
+
+    void operator()(const std::string& request, std::string& response) const
+    {
+      static thread_local std::vector<TrieResponseView_t> results;
+      static thread_local std::vector<PayloadView_t> values;
+
+      std::size_t space = request.find(' ');
+      std::string command = request.substr(0, space);
+      std::string arguments = space == std::string::npos ? "" : request.substr(space + 1);
+      std::transform(command.begin(), command.end(), command.begin(), [](char c) { return static_cast<char>(std::toupper(static_cast<unsigned char>(c))); });
+
+      std::size_t limit;
+      std::string keyword;
+
+      if (command == "PING") {
+        response = "PONG";
+      } else if (command == "EXACT") {
+        m_trie.searchKeyword(arguments, values);
+        response = "OK " + std::to_string(values.size());
+        for (auto& value : values) {
+          response += '\t';
+          appendEscaped(response, value);
+        }
+      } else if (command != "FUZZY" && command != "COMPLETE" && command != "RANKED") {
+        response = "ERR unknown command '" + command + "'";
+      } else if (!parseLimit(arguments, limit, keyword)) {
+        response = "ERR expected " + command + " <k> <keyword>";
+      } else {
+        QueryOptions_t options;
+        if (m_queryTimeout.count() > 0) {
+          options = QueryOptions_t::within(m_queryTimeout);
+        }
+
+        QueryStatus_t status;
+        if (command == "FUZZY") {
+          status = m_trie.searchSimilarKeywordTopK(keyword, limit, results, options);
+        } else if (command == "COMPLETE") {
+          status = m_trie.autocompleteTopK(keyword, limit, results, options);
+        } else {
+          status = m_trie.autocompleteRanked(keyword, limit, results, options);
+        }
+        appendResults(response, results, status);
+      }
+    }
+  };
+
+  typedef BasicQueryProtocol_t<PointerNodeStore_t> QueryProtocol_t;
+  typedef BasicQueryProtocol_t<ArenaNodeStore_t> ArenaQueryProtocol_t;
+  typedef BasicQueryProtocol_t<MappedNodeStore_t> MappedQueryProtocol_t;
+  typedef BasicQueryProtocol_t<RadixNodeStore_t> RadixQueryProtocol_t;
+  typedef BasicQueryProtocol_t<DawgNodeStore_t> FrozenQueryProtocol_t;
+}
+#endif
@@ -0,0 +1,159 @@
+#ifndef _ZYNTHETIC_SESSION_
+#define _ZYNTHETIC_SESSION_
+#include <set>
+#include <string>
+#include <vector>
+#include "trie.hpp"
+
+namespace trie {
+
+  /*
+  ** Type-ahead cursor over a trie : keeps the active node set of the current prefix, so typing one more character
+  ** costs a single `buildNewSet` step instead of replaying the whole prefix.
+  ** The last `historyLimit` sets are kept on a ring of reused vectors, so a backspace just moves back one slot; erasing past
+  ** the kept history replays the remaining prefix from the initial active node set.
+  ** The trie must not be modified while a session is open on it; many sessions can share it, each one used by a single thread.
+  */
+  template <typename Storage>
+  class BasicAutocompleteSession_t {
+  public:
+    typedef BasicTrie_t<Storage> Trie_t;
+    typedef typename Trie_t::ActiveNodeSet_t ActiveNodeSet_t;
+    typedef typename Trie_t::QueryScratch_t QueryScratch_t;
+
+  private:
+    const Trie_t& m_trie;
+    std::vector<unsigned int> m_codes; // character codes of the current prefix
+    std::vector<ActiveNodeSet_t> m_ring; // the kept active node sets, reused as a circular buffer
+    std::size_t m_top; // slot of the active node set of the whole prefix
+    std::size_t m_kept; // amount of sets on the ring (the current one plus the ones a backspace can go back to)
+    std::vector<unsigned int> m_typed; // scratch of `push`
+
+    ActiveNodeSet_t& slot(std::size_t index)
+    {
+      return m_ring[index % m_ring.size()];
+    }
+
+    const ActiveNodeSet_t& slot(std::size_t index) const
+    {
+      return m_ring[index % m_ring.size()];
+    }
+
+    void rebuild()
+    {
+      QueryScratch_t& scratch = m_trie.threadScratch();
+      std::size_t first = m_codes.size() >= m_ring.size() ? m_codes.size() - m_ring.size() + 1 : 0;
+
+      m_top = 0;
+      m_kept = 1;
+      slot(m_top) = m_trie.m_activeNodeSet;
+      const ActiveNodeSet_t* lastActiveNodes = &m_trie.m_activeNodeSet;
+
+      for (std::size_t i = 0; i < m_codes.size(); i++) {
+        ActiveNodeSet_t& nextActiveNodes = i + 1 >= first ? slot(++m_top) : scratch.sets[i & 1];
+        m_trie.buildNewSet(*lastActiveNodes, m_codes[i], nextActiveNodes, scratch);
+        lastActiveNodes = &nextActiveNodes;
+        if (i + 1 >= first) {
+          m_kept = std::min(m_kept + 1, m_ring.size());
+        }
+      }
+    }
+
+  public:
+    explicit BasicAutocompleteSession_t(const Trie_t& trie, std::size_t historyLimit = 32)
+    : m_trie(trie)
+    , m_ring((historyLimit ? historyLimit : 1) + 1)
+    , m_top(0)
+    , m_kept(1)
+    {
+      m_ring[0] = m_trie.m_activeNodeSet;
+    }
+
+    // types one or more characters (UTF-8)
+    void push(const std::string& characters)
+    {
+      m_trie.encodeKeyword(characters, m_typed);
+      for (unsigned int code : m_typed) {
+        pushCode(code);
+      }
+    }
+
+    void pushCode(unsigned int code)
+    {
+      const ActiveNodeSet_t& lastActiveNodes = slot(m_top);
+      ActiveNodeSet_t& nextActiveNodes = slot(m_top + 1); // overwrites the oldest set when the ring is full
+      m_trie.buildNewSet(lastActiveNodes, code, nextActiveNodes, m_trie.threadScratch());
+
+      m_codes.push_back(code);
+      m_top++;
+      m_kept = std::min(m_kept + 1, m_ring.size());
+    }
+
+    // erases the last character, returns false when the prefix is already empty
+    bool pop()
+    {
+      if (m_codes.empty()) {
+        return false;
+      }
+
+      m_codes.pop_back();
+
+      if (m_kept > 1) {
+        m_top--;
+        m_kept--;
+      } else {
+        rebuild();
+      }
+      return true;
+    }
+
+    void reset()
+    {
+      m_codes.clear();
+      m_top = 0;
+      m_kept = 1;
+      slot(m_top) = m_trie.m_activeNodeSet;
+    }
+
+    std::size_t length() const
+    {
+      return m_codes.size();
+    }
+
+    const ActiveNodeSet_t& activeNodes() const
+    {
+      return slot(m_top);
+    }
+
+    // every word starting with the current prefix (within the fuzzy threshold), as `Trie_t::autocomplete`
+    std::priority_queue<TrieResponse_t, std::vector<TrieResponse_t>, TrieResponseComparator_t> completions()
+    {
+      return m_trie.collectCompletions(activeNodes(), m_trie.threadScratch());
+    }
+
+    // the `limit` closest completions of the current prefix, as `Trie_t::autocompleteTopK`
+    std::vector<TrieResponse_t> topCompletions(std::size_t limit)
+    {
+      return m_trie.collectTopCompletions(activeNodes(), limit, m_trie.threadScratch());
+    }
+
+    // the `limit` best completions by score and distance, as `Trie_t::autocompleteRanked`
+    std::vector<TrieResponse_t> rankedCompletions(std::size_t limit)
+    {
+      return m_trie.collectRankedCompletions(activeNodes(), limit, m_trie.threadScratch());
+    }
+
+    // the words similar to the current prefix as a whole, as `Trie_t::searchSimilarKeyword`
+    std::priority_queue<TrieResponse_t, std::vector<TrieResponse_t>, TrieResponseComparator_t> similar()
+    {
+      return m_trie.collectSimilar(activeNodes(), m_trie.threadScratch());
+    }
+  };
+
+  typedef BasicAutocompleteSession_t<PointerNodeStore_t> AutocompleteSession_t;
+  typedef BasicAutocompleteSession_t<ArenaNodeStore_t> ArenaAutocompleteSession_t;
+  typedef BasicAutocompleteSession_t<MappedNodeStore_t> MappedAutocompleteSession_t;
+  typedef BasicAutocompleteSession_t<RadixNodeStore_t> RadixAutocompleteSession_t;
+  typedef BasicAutocompleteSession_t<DawgNodeStore_t> FrozenAutocompleteSession_t;
+}
+#endif
@@ -0,0 +1,417 @@
+#ifndef _ZYNTHETIC_STATS_
+#define _ZYNTHETIC_STATS_
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace trie {
+
+  enum QueryKind_t {
+    kQueryExact = 0, // searchKeyword
+    kQuerySimilar, // searchSimilarKeyword, forEachSimilarKeyword
+    kQueryTopSimilar, // searchSimilarKeywordTopK
+    kQueryCompletions, // autocomplete, autocompleteTopK, forEachCompletion
+    kQueryRanked, // autocompleteRanked
+    kQueryKindCount
+  };
+
+  static const std::size_t kStatsMaxDistance = 7; // higher edit distances share the last bucket
+  static const std::size_t kStatsMaxDepth = 32; // longer prefixes share the last bucket
+
+  inline const char* queryKindName(QueryKind_t kind)
+  {
+    static const char* names[] = { "exact", "similar", "top_similar", "completions", "ranked" };
+    return names[kind];
+  }
+
+  /*
+  ** What a single query did. It lives on the scratch of the thread, so recording it reuses the same buffers query after query.
+  */
+  struct QueryStats_t {
+    QueryKind_t kind;
+    std::string keyword;
+    std::vector<uint32_t> activeNodes; // size of the active node set after each character
+    std::vector<uint32_t> expandedNodes; // nodes reached by the match addiction of each character
+    uint64_t visitedByDistance[kStatsMaxDistance + 1]; // nodes examined while collecting the results, by edit distance
+    uint64_t peakFrontier; // largest queue or heap held while collecting the results
+    uint64_t results;
+    uint64_t walkNanoseconds; // replaying the keyword (or finding it, for an exact search)
+    uint64_t collectNanoseconds; // gathering the results from the active nodes
+    uint64_t totalNanoseconds;
+    std::chrono::steady_clock::time_point started;
+    std::chrono::steady_clock::time_point walked;
+
+    void start(QueryKind_t _kind, const std::string& _keyword)
+    {
+      kind = _kind;
+      keyword.assign(_keyword);
+      activeNodes.clear();
+      expandedNodes.clear();
+      std::fill(visitedByDistance, visitedByDistance + kStatsMaxDistance + 1, 0);
+      peakFrontier = 0;
+      results = 0;
+      walkNanoseconds = collectNanoseconds = totalNanoseconds = 0;
+      started = walked = std::chrono::steady_clock::now();
+    }
+
+    void markWalked()
+    {
+      walked = std::chrono::steady_clock::now();
+    }
+
+    void visit(int editDistance)
+    {
+      visitedByDistance[std::min<std::size_t>(static_cast<std::size_t>(editDistance), kStatsMaxDistance)]++;
+    }
+
+    void frontier(std::size_t size)
+    {
+      peakFrontier = std::max<uint64_t>(peakFrontier, size);
+    }
+
+    void finish()
+    {
+      auto finished = std::chrono::steady_clock::now();
+      walkNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(walked - started).count();
+      collectNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(finished - walked).count();
+      totalNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(finished - started).count();
+    }
+
+    void print(std::ostream& out) const
+    {
+      out << "[query] kind=" << queryKindName(kind)
+          << " keyword=\"" << keyword << "\""
+          << " total_ns=" << totalNanoseconds
+          << " walk_ns=" << walkNanoseconds
+          << " collect_ns=" << collectNanoseconds
+          << " results=" << results
+          << " peak_frontier=" << peakFrontier
+          << " active_nodes=";
+      for (std::size_t i = 0; i < activeNodes.size(); i++) {
+        out << (i ? "," : "") << activeNodes[i];
+      }
+      out << " expanded_nodes=";
+      for (std::size_t i = 0; i < expandedNodes.size(); i++) {
+        out << (i ? "," : "") << expandedNodes[i];
+      }
+      out << " visited_by_distance=";
+      for (std::size_t i = 0; i <= kStatsMaxDistance; i++) {
+        out << (i ? "," : "") << visitedByDistance[i];
+      }
+      out << '\n';
+    }
+  };
+
+  struct HistogramSnapshot_t {
+    static const std::size_t kBuckets = 65; // bucket 0 holds the zeros, bucket b the values on [2^(b-1), 2^b)
+
+    uint64_t buckets[kBuckets];
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+
+    HistogramSnapshot_t()
+    : count(0)
+    , sum(0)
+    , max(0)
+    {
+      std::fill(buckets, buckets + kBuckets, 0);
+    }
+
+    double mean() const
+    {
+      return count ? double(sum) / count : 0;
+    }
+
+    // upper bound of the bucket holding the value of this rank (0 <= rank <= 1), so at most twice the exact percentile
+    uint64_t percentile(double rank) const
+    {
+      uint64_t target = static_cast<uint64_t>(rank * count);
+      uint64_t seen = 0;
+      for (std::size_t b = 0; b < kBuckets; b++) {
+        seen += buckets[b];
+        if (seen > target) {
+          return b == 0 ? 0 : std::min(max, b == 64 ? UINT64_MAX : (uint64_t(1) << b) - 1);
+        }
+      }
+      return max;
+    }
+
+    void print(std::ostream& out, const std::string& name) const
+    {
+      out << name << " count=" << count << " mean=" << mean() << " p50=" << percentile(0.5) << " p99=" << percentile(0.99)
+          << " p999=" << percentile(0.999) << " max=" << max;
+    }
+  };
+
+  // power of two buckets updated with relaxed atomics, so every thread records without a lock
+  class Histogram_t {
+    std::atomic<uint64_t> m_buckets[HistogramSnapshot_t::kBuckets];
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_sum;
+    std::atomic<uint64_t> m_max;
+
+  public:
+    Histogram_t()
+    {
+      reset();
+    }
+
+    void record(uint64_t value)
+    {
+      std::size_t bucket = 0;
+      for (uint64_t rest = value; rest; rest >>= 1) {
+        bucket++;
+      }
+
+      m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+      m_count.fetch_add(1, std::memory_order_relaxed);
+      m_sum.fetch_add(value, std::memory_order_relaxed);
+
+      uint64_t max = m_max.load(std::memory_order_relaxed);
+      while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+      }
+    }
+
+    HistogramSnapshot_t snapshot() const
+    {
+      HistogramSnapshot_t snapshot;
+      for (std::size_t b = 0; b < HistogramSnapshot_t::kBuckets; b++) {
+        snapshot.buckets[b] = m_buckets[b].load(std::memory_order_relaxed);
+      }
+      snapshot.count = m_count.load(std::memory_order_relaxed);
+      snapshot.sum = m_sum.load(std::memory_order_relaxed);
+      snapshot.max = m_max.load(std::memory_order_relaxed);
+      return snapshot;
+    }
+
+    void reset()
+    {
+      for (auto& bucket : m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+      }
+      m_count.store(0, std::memory_order_relaxed);
+      m_sum.store(0, std::memory_order_relaxed);
+      m_max.store(0, std::memory_order_relaxed);
+    }
+  };
+
+  struct StatsSnapshot_t {
+    uint64_t queries[kQueryKindCount];
+    HistogramSnapshot_t walkNanoseconds;
+    HistogramSnapshot_t collectNanoseconds;
+    HistogramSnapshot_t totalNanoseconds;
+    HistogramSnapshot_t results;
+    HistogramSnapshot_t peakFrontier;
+    std::vector<HistogramSnapshot_t> activeNodesByDepth; // [prefix length - 1], only the depths reached by some query
+    std::vector<HistogramSnapshot_t> expandedNodesByDepth;
+    HistogramSnapshot_t visitedByDistance[kStatsMaxDistance + 1]; // nodes examined per query at each edit distance
+    std::vector<QueryStats_t> slowest; // slowest queries seen, slowest first
+
+    void print(std::ostream& out) const
+    {
+      out << "[stats] queries";
+      for (std::size_t kind = 0; kind < kQueryKindCount; kind++) {
+        out << " " << queryKindName(static_cast<QueryKind_t>(kind)) << "=" << queries[kind];
+      }
+      out << '\n';
+
+      totalNanoseconds.print(out << "[stats] ", "total_ns");
+      walkNanoseconds.print(out << "\n[stats] ", "walk_ns");
+      collectNanoseconds.print(out << "\n[stats] ", "collect_ns");
+      results.print(out << "\n[stats] ", "results");
+      peakFrontier.print(out << "\n[stats] ", "peak_frontier");
+      out << '\n';
+
+      for (std::size_t depth = 0; depth < activeNodesByDepth.size(); depth++) {
+        activeNodesByDepth[depth].print(out << "[stats] ", "active_nodes depth=" + std::to_string(depth + 1));
+        expandedNodesByDepth[depth].print(out << " | ", "expanded_nodes");
+        out << '\n';
+      }
+      for (std::size_t distance = 0; distance <= kStatsMaxDistance; distance++) {
+        if (visitedByDistance[distance].count && visitedByDistance[distance].max) {
+          visitedByDistance[distance].print(out << "[stats] ", "visited_nodes distance=" + std::to_string(distance));
+          out << '\n';
+        }
+      }
+      for (auto& query : slowest) {
+        query.print(out << "[stats] slow ");
+      }
+    }
+  };
+
+  /*
+  ** Aggregates the `QueryStats_t` of every query answered by the tries it is attached to (see `BasicTrie_t::setStatsCollector`),
+  ** from any amount of threads. The histograms are lock-free; the slowest queries are kept whole, under a lock taken only by the
+  ** queries slower than the fastest one kept.
+  */
+  class StatsCollector_t {
+    std::atomic<uint64_t> m_queries[kQueryKindCount];
+    Histogram_t m_walkNanoseconds;
+    Histogram_t m_collectNanoseconds;
+    Histogram_t m_totalNanoseconds;
+    Histogram_t m_results;
+    Histogram_t m_peakFrontier;
+    Histogram_t m_activeNodes[kStatsMaxDepth];
+    Histogram_t m_expandedNodes[kStatsMaxDepth];
+    Histogram_t m_visitedByDistance[kStatsMaxDistance + 1];
+
+    std::mutex m_slowLock; // guards the fields below
+    std::vector<QueryStats_t> m_slowest; // min-heap on the total time
+    std::size_t m_slowLimit;
+    std::atomic<uint64_t> m_slowFloor; // a query must be slower than this to enter the slowest ones
+
+    static bool slower(const QueryStats_t& q1, const QueryStats_t& q2)
+    {
+      return q1.totalNanoseconds > q2.totalNanoseconds;
+    }
+
+  public:
+    explicit StatsCollector_t(std::size_t slowQueries = 16)
+    : m_slowLimit(slowQueries)
+    , m_slowFloor(0)
+    {
+      for (auto& queries : m_queries) {
+        queries.store(0, std::memory_order_relaxed);
+      }
+    }
+
+    void record(const QueryStats_t& query)
+    {
+      m_queries[query.kind].fetch_add(1, std::memory_order_relaxed);
+      m_walkNanoseconds.record(query.walkNanoseconds);
+      m_collectNanoseconds.record(query.collectNanoseconds);
+      m_totalNanoseconds.record(query.totalNanoseconds);
+      m_results.record(query.results);
+      m_peakFrontier.record(query.peakFrontier);
+
+      for (std::size_t depth = 0; depth < query.activeNodes.size(); depth++) {
+        std::size_t bucket = std::min(depth, kStatsMaxDepth - 1);
+        m_activeNodes[bucket].record(query.activeNodes[depth]);
+        m_expandedNodes[bucket].record(query.expandedNodes[depth]);
+      }
+      if (query.kind != kQueryExact) {
+        for (std::size_t distance = 0; distance <= kStatsMaxDistance; distance++) {
+          m_visitedByDistance[distance].record(query.visitedByDistance[distance]);
+        }
+      }
+
+      if (m_slowLimit && query.totalNanoseconds > m_slowFloor.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> guard(m_slowLock);
+        if (m_slowest.size() == m_slowLimit) {
+          if (query.totalNanoseconds <= m_slowest.front().totalNanoseconds) {
+            return;
+          }
+          std::pop_heap(m_slowest.begin(), m_slowest.end(), slower);
+          m_slowest.pop_back();
+        }
+        m_slowest.push_back(query);
+        std::push_heap(m_slowest.begin(), m_slowest.end(), slower);
+        if (m_slowest.size() == m_slowLimit) {
+          m_slowFloor.store(m_slowest.front().totalNanoseconds, std::memory_order_relaxed);
+        }
+      }
+    }
+
+    StatsSnapshot_t snapshot()
+    {
+      StatsSnapshot_t snapshot;
+      for (std::size_t kind = 0; kind < kQueryKindCount; kind++) {
+        snapshot.queries[kind] = m_queries[kind].load(std::memory_order_relaxed);
+      }
+      snapshot.walkNanoseconds = m_walkNanoseconds.snapshot();
+      snapshot.collectNanoseconds = m_collectNanoseconds.snapshot();
+      snapshot.totalNanoseconds = m_totalNanoseconds.snapshot();
+      snapshot.results = m_results.snapshot();
+      snapshot.peakFrontier = m_peakFrontier.snapshot();
+
+      for (std::size_t depth = 0; depth < kStatsMaxDepth; depth++) {
+        HistogramSnapshot_t activeNodes = m_activeNodes[depth].snapshot();
+        if (activeNodes.count == 0) {
+          break;
+        }
+        snapshot.activeNodesByDepth.push_back(activeNodes);
+        snapshot.expandedNodesByDepth.push_back(m_expandedNodes[depth].snapshot());
+      }
+      for (std::size_t distance = 0; distance <= kStatsMaxDistance; distance++) {
+        snapshot.visitedByDistance[distance] = m_visitedByDistance[distance].snapshot();
+      }
+
+      {
+        std::lock_guard<std::mutex> guard(m_slowLock);
+        snapshot.slowest = m_slowest;
+      }
+      std::sort(snapshot.slowest.begin(), snapshot.slowest.end(), slower);
+      return snapshot;
+    }
+
+    void dump(std::ostream& out)
+    {
+      snapshot().print(out);
+    }
+
+    // starts over; the queries running meanwhile may land on either side
+    void reset()
+    {
+      for (auto& queries : m_queries) {
+        queries.store(0, std::memory_order_relaxed);
+      }
+      m_walkNanoseconds.reset();
+      m_collectNanoseconds.reset();
+      m_totalNanoseconds.reset();
+      m_results.reset();
+      m_peakFrontier.reset();
+      for (std::size_t depth = 0; depth < kStatsMaxDepth; depth++) {
+        m_activeNodes[depth].reset();
+        m_expandedNodes[depth].reset();
+      }
+      for (auto& visited : m_visitedByDistance) {
+        visited.reset();
+      }
+
+      std::lock_guard<std::mutex> guard(m_slowLock);
+      m_slowest.clear();
+      m_slowFloor.store(0, std::memory_order_relaxed);
+    }
+  };
+
+  /*
+  ** Scope of an instrumented query : with a collector it points `slot` (the stats pointer of the scratch) at `record`, so the
+  ** engine fills it, and hands it to the collector once the query ends. Without a collector the engine sees a null pointer
+  ** and the whole cost is that test.
+  */
+  class QueryProbe_t {
+    StatsCollector_t* m_collector;
+    QueryStats_t*& m_slot;
+
+  public:
+    QueryProbe_t(StatsCollector_t* collector, QueryStats_t*& slot, QueryStats_t& record, QueryKind_t kind, const std::string& keyword)
+    : m_collector(collector)
+    , m_slot(slot)
+    {
+      m_slot = nullptr;
+      if (m_collector) {
+        record.start(kind, keyword);
+        m_slot = &record;
+      }
+    }
+
+    QueryProbe_t(const QueryProbe_t&) = delete;
+    QueryProbe_t& operator=(const QueryProbe_t&) = delete;
+
+    ~QueryProbe_t()
+    {
+      if (m_slot) {
+        m_slot->finish();
+        m_collector->record(*m_slot);
+        m_slot = nullptr;
+      }
+    }
+  };
+}
+#endif
@@ -0,0 +1,91 @@
+#ifndef _ZYNTHETIC_TEXT_TABLES_
+#define _ZYNTHETIC_TEXT_TABLES_
+#include <algorithm>
+#include <dirent.h>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include "charmap.hpp"
+#include "utf8.hpp"
+
+namespace trie {
+
+  /*
+  ** The language tables of a trie : its charmap and stopwords. A trie holds them as a shared, immutable object, so the
+  ** tries of the same language (the copies of a trie, the shards of a `BasicDictionarySet_t`) share a single one; a trie
+  ** changing its tables (`encodeCharacters`, `addStopWords`) takes its own copy first.
+  */
+  struct TextTables_t {
+    CharMap_t characterMap; // used to map all the characters to it's defined codes (folding the case and the accents)
+    std::unordered_map<unsigned int, char> reverseCharacterMap; // used to map all the defined codes to it's characters (4fun)
+    std::set<std::string> stopWords; // lowercase
+
+    // each line of the file gives a code to its characters, the first line taking code 1
+    void encodeCharacters(const std::string& filename)
+    {
+      unsigned int lineCode = 1;
+      std::string currentLine;
+      std::ifstream fileInputStream(filename);
+
+      while (std::getline(fileInputStream, currentLine)) {
+
+        reverseCharacterMap.emplace(lineCode, currentLine.back());
+
+        forEachCodePoint(currentLine, [&](uint32_t anomalousCharacter) { characterMap.define(anomalousCharacter, lineCode); });
+
+        lineCode++;
+      }
+
+      reverseCharacterMap[0] = '#'; // lambda character
+      std::cout << "Charmap has been mapped.\n";
+    }
+
+    // one stopword per line
+    void addStopWords(const std::string& filename)
+    {
+      std::string currentLine;
+      std::ifstream fileInputStream(filename);
+
+      while (std::getline(fileInputStream, currentLine)) {
+        std::transform(currentLine.begin(), currentLine.end(), currentLine.begin(), ::tolower);
+        stopWords.insert(currentLine);
+      }
+    }
+
+    // every regular file of the directory, a missing directory giving no stopwords
+    void addStopWordDirectory(const std::string& path)
+    {
+      DIR* dirp;
+      struct dirent* directory;
+      dirp = opendir(path.c_str());
+      if (dirp) {
+        while ((directory = readdir(dirp)) != NULL) {
+          if (directory->d_type == DT_REG) {
+            std::cout << "The stopword file \'" << directory->d_name << "\' has been detected.\n";
+            this->addStopWords(path + "/" + directory->d_name);
+          }
+        }
+        closedir(dirp);
+      }
+    }
+
+    bool isStopWord(std::string str) const
+    {
+      std::transform(str.begin(), str.end(), str.begin(), ::tolower);
+      return stopWords.find(str) != stopWords.end();
+    }
+
+    // the charmap file and the stopwords of a directory, `BasicTrie_t()` loading "charmap.cm" and "./stopwords"
+    static std::shared_ptr<const TextTables_t> load(const std::string& charmapFile, const std::string& stopWordDirectory)
+    {
+      std::shared_ptr<TextTables_t> tables = std::make_shared<TextTables_t>();
+      tables->addStopWordDirectory(stopWordDirectory);
+      tables->encodeCharacters(charmapFile);
+      return tables;
+    }
+  };
+}
+#endif
@@ -0,0 +1,223 @@
+#ifndef _ZYNTHETIC_THREAD_POOL_
+#define _ZYNTHETIC_THREAD_POOL_
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace trie {
+
+  /*
+  ** Fixed set of worker threads, each one owning a task deque : a worker runs the newest task of its own deque and, once it
+  ** is empty, steals the oldest task of the others, so uneven work (a short keyword has a far larger active node set than
+  ** a long one) evens out between the threads.
+  ** The tasks given to `submit` must not throw; `parallelFor` hands the first exception back to its caller.
+  */
+  class ThreadPool_t {
+    struct TaskQueue_t {
+      std::mutex lock;
+      std::deque<std::function<void()>> tasks;
+    };
+
+    struct WorkerIdentity_t {
+      const ThreadPool_t* pool; // pool which owns the current thread, nullptr outside of the workers
+      std::size_t queue;
+    };
+
+    std::vector<std::unique_ptr<TaskQueue_t>> m_queues; // m_queues[i] belongs to m_workers[i]
+    std::vector<std::thread> m_workers;
+    std::mutex m_sleepLock; // guards m_stopping and the sleep of idle workers
+    std::condition_variable m_wakeUp;
+    std::atomic<std::size_t> m_pending; // tasks submitted and not taken yet
+    std::atomic<std::size_t> m_nextQueue; // round robin of the tasks submitted from outside of the pool
+    bool m_stopping;
+
+    static WorkerIdentity_t& identity()
+    {
+      static thread_local WorkerIdentity_t current = { nullptr, 0 };
+      return current;
+    }
+
+    // queue where the current thread pushes and pops first
+    std::size_t homeQueue()
+    {
+      const WorkerIdentity_t& self = identity();
+      return self.pool == this ? self.queue : m_nextQueue++ % m_queues.size();
+    }
+
+    // pops the newest task of the home queue or steals the oldest one of another queue
+    bool takeTask(std::size_t home, std::function<void()>& task)
+    {
+      for (std::size_t i = 0; i < m_queues.size(); i++) {
+        TaskQueue_t& queue = *m_queues[(home + i) % m_queues.size()];
+        std::lock_guard<std::mutex> guard(queue.lock);
+
+        if (queue.tasks.empty()) {
+          continue;
+        }
+
+        if (i == 0) {
+          task = std::move(queue.tasks.back());
+          queue.tasks.pop_back();
+        } else {
+          task = std::move(queue.tasks.front());
+          queue.tasks.pop_front();
+        }
+        m_pending--;
+        return true;
+      }
+      return false;
+    }
+
+    void workerLoop(std::size_t index)
+    {
+      identity() = { this, index };
+      std::function<void()> task;
+
+      for (;;) {
+        if (takeTask(index, task)) {
+          task();
+          task = nullptr;
+          continue;
+        }
+
+        std::unique_lock<std::mutex> sleep(m_sleepLock);
+        m_wakeUp.wait(sleep, [this] { return m_stopping || m_pending > 0; });
+        if (m_stopping && m_pending == 0) {
+          return;
+        }
+      }
+    }
+
+  public:
+    explicit ThreadPool_t(std::size_t threads = std::thread::hardware_concurrency())
+    : m_pending(0)
+    , m_nextQueue(0)
+    , m_stopping(false)
+    {
+      threads = std::max<std::size_t>(threads, 1);
+
+      for (std::size_t i = 0; i < threads; i++) {
+        m_queues.emplace_back(new TaskQueue_t());
+      }
+      for (std::size_t i = 0; i < threads; i++) {
+        m_workers.emplace_back(&ThreadPool_t::workerLoop, this, i);
+      }
+    }
+
+    ThreadPool_t(const ThreadPool_t&) = delete;
+    ThreadPool_t& operator=(const ThreadPool_t&) = delete;
+
+    // runs the tasks still queued, then joins the workers
+    ~ThreadPool_t()
+    {
+      {
+        std::lock_guard<std::mutex> guard(m_sleepLock);
+        m_stopping = true;
+      }
+      m_wakeUp.notify_all();
+
+      for (auto& worker : m_workers) {
+        worker.join();
+      }
+    }
+
+    std::size_t size() const
+    {
+      return m_workers.size();
+    }
+
+    void submit(std::function<void()> task)
+    {
+      TaskQueue_t& queue = *m_queues[homeQueue()];
+      m_pending++;
+      {
+        std::lock_guard<std::mutex> guard(queue.lock);
+        queue.tasks.push_back(std::move(task));
+      }
+      {
+        std::lock_guard<std::mutex> guard(m_sleepLock); // a worker checking m_pending right now is either awake or already waiting
+      }
+      m_wakeUp.notify_one();
+    }
+
+    /*
+    ** Calls fn(i) for every i on [0, count), split in chunks over the workers, and returns once all of them are done.
+    ** The calling thread runs queued tasks meanwhile, so it can also be called from inside a task of this pool.
+    */
+    template <typename Fn>
+    void parallelFor(std::size_t count, Fn fn)
+    {
+      if (count == 0) {
+        return;
+      }
+
+      struct Latch_t {
+        std::mutex lock;
+        std::condition_variable done;
+        std::size_t remaining;
+        std::exception_ptr error;
+      } latch;
+
+      std::size_t chunk = std::max<std::size_t>(1, count / (m_queues.size() * 8));
+      latch.remaining = (count + chunk - 1) / chunk;
+
+      for (std::size_t begin = 0; begin < count; begin += chunk) {
+        std::size_t end = std::min(count, begin + chunk);
+
+        submit([&latch, &fn, begin, end] {
+          std::exception_ptr error;
+          try {
+            for (std::size_t i = begin; i < end; i++) {
+              fn(i);
+            }
+          } catch (...) {
+            error = std::current_exception();
+          }
+
+          std::lock_guard<std::mutex> guard(latch.lock);
+          if (error && !latch.error) {
+            latch.error = error;
+          }
+          if (--latch.remaining == 0) {
+            latch.done.notify_all();
+          }
+        });
+      }
+
+      std::size_t home = homeQueue();
+      std::function<void()> task;
+
+      for (;;) {
+        {
+          std::lock_guard<std::mutex> guard(latch.lock);
+          if (latch.remaining == 0) {
+            break;
+          }
+        }
+
+        if (takeTask(home, task)) {
+          task();
+          task = nullptr;
+          continue;
+        }
+
+        // nothing left to take : the remaining chunks are running on the workers
+        std::unique_lock<std::mutex> wait(latch.lock);
+        latch.done.wait(wait, [&latch] { return latch.remaining == 0; });
+        break;
+      }
+
+      if (latch.error) {
+        std::rethrow_exception(latch.error);
+      }
+    }
+  };
+}
+#endif
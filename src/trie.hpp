@@ -1,7 +1,6 @@
 #ifndef _ZYNTHETIC_TRIE_
 #define _ZYNTHETIC_TRIE_
 #include <algorithm>
-#include <dirent.h>
 #include <fstream>
 #include <iostream>
 #include <list>
@@ -10,11 +9,28 @@
 #include <set>
 #include <sstream>
 #include <stack>
+#include <stdexcept>
 #include <string>
+#include <tuple>
 #include <unordered_map>
 #include <unordered_set>
 #include <memory>
 #include <vector>
+#include "arena.hpp"
+#include "charmap.hpp"
+#include "dawg.hpp"
+#include "deletion_index.hpp"
+#include "index_file.hpp"
+#include "payload.hpp"
+#include "prefix_table.hpp"
+#include "query_options.hpp"
+#include "radix.hpp"
+#include "result_cache.hpp"
+#include "scratch.hpp"
+#include "stats.hpp"
+#include "text_tables.hpp"
+#include "thread_pool.hpp"
+#include "utf8.hpp"
 
 namespace trie {
 
@@ -23,9 +39,32 @@ namespace trie {
   struct TrieResponse_t {
     std::string content;
     int editDistance;
+    unsigned int score; // popularity given on the insertion
     TrieResponse_t(std::string _content, int _editDistance)
     : content(_content)
     , editDistance(_editDistance)
+    , score(0)
+    {
+    }
+
+    TrieResponse_t(std::string _content, int _editDistance, unsigned int _score)
+    : content(_content)
+    , editDistance(_editDistance)
+    , score(_score)
+    {
+    }
+  };
+
+  // allocation-free form of TrieResponse_t : the value is a view on the trie, valid while the trie is not modified
+  struct TrieResponseView_t {
+    PayloadView_t value; // `value.id` identifies the payload on the trie
+    int editDistance;
+    unsigned int score;
+
+    TrieResponseView_t(PayloadView_t _value, int _editDistance, unsigned int _score)
+    : value(_value)
+    , editDistance(_editDistance)
+    , score(_score)
     {
     }
   };
@@ -37,43 +76,128 @@ namespace trie {
     }
   };
 
+  // results of a query given `QueryOptions_t`, partial when it ran out of them
+  struct QueryResult_t {
+    std::vector<TrieResponse_t> responses;
+    QueryStatus_t status;
+
+    QueryResult_t()
+    : status(kQueryComplete)
+    {
+    }
+
+    bool partial() const
+    {
+      return status != kQueryComplete;
+    }
+  };
+
   class TrieNode_t {
     std::map<unsigned int, std::unique_ptr<TrieNode_t>> m_childrenMap; // used to save all the children (access / insertion O(log n))
     unsigned int m_content; // used to store the current character code in it's structure
+    uint32_t m_id; // dense id given by the store, indexes the per-query tables
     bool m_endOfWord;
-    std::unique_ptr<std::vector<std::string>> m_nodeContent;
+    unsigned int m_maxScore; // highest score among the values of this subtree
+    WordDepths_t m_wordDepths; // depths of the words of this subtree
+    std::unique_ptr<std::vector<PayloadRef_t>> m_nodeContent; // interned values (on the store) and their scores
 
   public:
-    TrieNode_t(unsigned int val)
+    TrieNode_t(unsigned int val, uint32_t id)
     : m_content(val)
+    , m_id(id)
     , m_endOfWord(false)
+    , m_maxScore(0)
     {
     }
 
     void buildContent()
     {
-      m_nodeContent.reset(new std::vector<std::string>());
+      m_nodeContent.reset(new std::vector<PayloadRef_t>());
     }
 
-    std::vector<TrieNode_t*> getChildren()
+    template <typename Fn>
+    void forEachChild(Fn fn)
     {
-      std::vector<TrieNode_t*> nodes;
       for (auto &cur : this->m_childrenMap) {
-        nodes.push_back(cur.second.get());
+        fn(cur.second.get());
       }
-      return nodes;
     }
 
-    TrieNode_t* insertNReturnChild(unsigned int value)
+    std::size_t childCount()
+    {
+      return this->m_childrenMap.size();
+    }
+
+    // `id` is given to the child only if it has to be created
+    TrieNode_t* insertNReturnChild(unsigned int value, uint32_t id)
     {
       auto finder = this->m_childrenMap.find(value);
 
       if(finder != this->m_childrenMap.end()){
         return finder->second.get();
       }else{
-        return this->m_childrenMap.emplace(value, std::unique_ptr<TrieNode_t>(new TrieNode_t(value))).first->second.get();
+        return this->m_childrenMap.emplace(value, std::unique_ptr<TrieNode_t>(new TrieNode_t(value, id))).first->second.get();
+      }
+
+    }
+
+    // the child must have no children of its own, its id is returned to be given to a later node
+    uint32_t removeChild(unsigned int value)
+    {
+      auto child = this->m_childrenMap.find(value);
+      if (child == this->m_childrenMap.end() || child->second->childCount() || child->second->isEndOfWord()) {
+        throw std::logic_error("only a leaf without values can be removed");
+      }
+
+      uint32_t id = child->second->getId();
+      this->m_childrenMap.erase(child);
+      return id;
+    }
+
+    // copy of this node and of its whole subtree, with the same ids and values
+    std::unique_ptr<TrieNode_t> clone() const
+    {
+      std::unique_ptr<TrieNode_t> copy(new TrieNode_t(this->m_content, this->m_id));
+      std::stack<std::pair<const TrieNode_t*, TrieNode_t*>> pending;
+      pending.emplace(this, copy.get());
+
+      while (!pending.empty()) {
+        const TrieNode_t* source = pending.top().first;
+        TrieNode_t* target = pending.top().second;
+        pending.pop();
+
+        target->m_endOfWord = source->m_endOfWord;
+        target->m_maxScore = source->m_maxScore;
+        target->m_wordDepths = source->m_wordDepths;
+        if (source->m_nodeContent) {
+          target->m_nodeContent.reset(new std::vector<PayloadRef_t>(*source->m_nodeContent));
+        }
+
+        for (auto &cur : source->m_childrenMap) {
+          TrieNode_t* child = new TrieNode_t(cur.second->m_content, cur.second->m_id);
+          target->m_childrenMap.emplace(cur.first, std::unique_ptr<TrieNode_t>(child));
+          pending.emplace(cur.second.get(), child);
+        }
+      }
+
+      return copy;
+    }
+
+    // hands every child (with its subtree) to fn(std::unique_ptr<TrieNode_t>), leaving this node without children
+    template <typename Fn>
+    void releaseChildren(Fn fn)
+    {
+      for (auto &cur : this->m_childrenMap) {
+        fn(std::move(cur.second));
       }
+      this->m_childrenMap.clear();
+    }
 
+    // the caller ensures there is no child with the same character yet
+    void adoptChild(std::unique_ptr<TrieNode_t> child)
+    {
+      unsigned int value = child->getContent();
+      this->m_childrenMap.emplace(value, std::move(child));
     }
 
     TrieNode_t* getChild(unsigned int value)
@@ -90,6 +214,16 @@ namespace trie {
       return this->m_content;
     }
 
+    uint32_t getId()
+    {
+      return this->m_id;
+    }
+
+    void setId(uint32_t id)
+    {
+      this->m_id = id;
+    }
+
     bool isEndOfWord()
     {
       return this->m_endOfWord;
@@ -100,467 +234,2354 @@ namespace trie {
       this->m_endOfWord = eow;
     }
 
-    void addValue(std::string content)
+    void addValue(PayloadRef_t value)
+    {
+      this->m_nodeContent->push_back(value);
+    }
+
+    // removes every value, the node stops being an end of word
+    void clearValues()
     {
-      this->m_nodeContent->push_back(content);
+      this->m_nodeContent.reset();
+      this->m_endOfWord = false;
     }
 
-    const std::vector<std::string>* getValues()
+    std::vector<PayloadRef_t>* getValues()
     {
       return this->m_nodeContent.get();
     }
-  };
 
-  struct ActiveNode_t {
-    TrieNode_t* node;
-    mutable int editDistance;
-    mutable int positionDistance;
+    unsigned int getMaxScore()
+    {
+      return this->m_maxScore;
+    }
 
-    ActiveNode_t(TrieNode_t* nd, int ed)
-    : node(nd)
-    , editDistance(ed)
-    , positionDistance(0)
+    void raiseMaxScore(unsigned int score)
     {
+      this->m_maxScore = std::max(this->m_maxScore, score);
     }
 
-    ActiveNode_t(TrieNode_t* nd, int ed, int pos)
-    : node(nd)
-    , editDistance(ed)
-    , positionDistance(pos)
+    void setMaxScore(unsigned int score)
     {
+      this->m_maxScore = score;
     }
 
-    bool operator<(const ActiveNode_t& anode) const
+    WordDepths_t getWordDepths()
     {
-      return this->node < anode.node;
+      return this->m_wordDepths;
     }
-  };
 
-  struct ActiveNodeComparator_t {
-    bool operator()(const ActiveNode_t& n1, const ActiveNode_t& n2) const
+    void widenWordDepths(WordDepths_t below, std::size_t offset)
     {
-      return n1.editDistance > n2.editDistance;
+      this->m_wordDepths.widen(below, offset);
+    }
+
+    void setWordDepths(WordDepths_t depths)
+    {
+      this->m_wordDepths = depths;
     }
   };
 
-  class Trie_t {
+  /*
+  ** Node storage where every node is an individual heap allocation owning a std::map of its children (the original layout)
+  */
+  class PointerNodeStore_t {
     std::unique_ptr<TrieNode_t> m_lambdaNode; // used to indicate the first node
-    std::unordered_map<unsigned int, unsigned int> m_characterMap; // used to map all the characters to it's defined codes
-    std::unordered_map<unsigned int, char> m_reverseCharacterMap; // used to map all the defined codes to it's characters (4fun)
-    std::set<ActiveNode_t> m_activeNodeSet; // uset to save the main activeNode set
-    std::set<std::string> m_stopWords; // set of stopwords
-    int m_searchLimitThreshold; // threshold used for delimit the answers amount (default : 5)
-    int m_fuzzyLimitThreshold; // threshold used for delimit the edit distance from node (default : 1)
-    const std::vector<std::string> m_emptyResponse;
+    std::size_t m_nodeCount;
+    std::vector<uint32_t> m_freeIds; // ids of removed nodes, given again before growing m_nodeCount
+    PayloadArena_t m_payloads; // the bytes of every distinct value
+
+  public:
+    typedef TrieNode_t* Node_t;
 
-    void push_string_to_wchar(wchar_t* w, std::string& a)
+    PointerNodeStore_t()
+    : m_lambdaNode(new TrieNode_t(0, 0))
+    , m_nodeCount(1)
     {
-      setlocale(LC_ALL, "");
-      const char* nw = a.c_str();
-      mbsrtowcs(w, &nw, a.length(), NULL);
-      w[a.length()] = 0;
     }
 
-    std::set<ActiveNode_t> buildNewSet(std::set<ActiveNode_t>& set, unsigned int curChar)
+    // deep copy : the nodes and the payloads keep their ids, so the same edits give the same ids on both stores
+    PointerNodeStore_t(const PointerNodeStore_t& other)
+    : m_lambdaNode(other.m_lambdaNode->clone())
+    , m_nodeCount(other.m_nodeCount)
+    , m_freeIds(other.m_freeIds)
+    , m_payloads(other.m_payloads)
     {
-      std::set<ActiveNode_t> activeNodeSet;
+    }
 
-      /*
-      ** Considering node N
-      ** We can transform the content of this node for the currentWord by first adding a character. (Prebuilt Addiction)
-      */
-      // std::cout << "\nBuilding node for " << m_reverseCharacterMap[curChar] << '\n';
-      for (auto curActiveNode = set.begin(); curActiveNode != set.end(); curActiveNode++) {
-        if (curActiveNode->editDistance < m_fuzzyLimitThreshold) {
-          // std::cout << " * Updating distance for node " << m_reverseCharacterMap[curActiveNode->node->getContent()] << " from " << curActiveNode->editDistance << " to " << curActiveNode->editDistance + 1 << '\n';
-          activeNodeSet.emplace(curActiveNode->node, curActiveNode->editDistance + 1);
+    PointerNodeStore_t(PointerNodeStore_t&&) = default;
+    PointerNodeStore_t& operator=(PointerNodeStore_t&&) = default;
+
+    static Node_t nullNode()
+    {
+      return nullptr;
+    }
+
+    Node_t root() const
+    {
+      return this->m_lambdaNode.get();
+    }
+
+    Node_t getChild(Node_t node, unsigned int value) const
+    {
+      return node->getChild(value);
+    }
+
+    Node_t insertNReturnChild(Node_t node, unsigned int value)
+    {
+      std::size_t before = node->childCount();
+      Node_t child = node->insertNReturnChild(value, m_freeIds.empty() ? static_cast<uint32_t>(m_nodeCount) : m_freeIds.back());
+
+      if (node->childCount() != before) {
+        if (m_freeIds.empty()) {
+          m_nodeCount++;
+        } else {
+          m_freeIds.pop_back();
         }
       }
+      return child;
+    }
 
-      /*
-      ** Considering no+de P (child of N)
-      ** -  C1. Different character from `curChar` : (Posbuilt Substitution Addiction)
-      **    We can transform this character of P for the current character by substitution, relative to ED(N), then, we have to add P to
-      **    the set if and only if ED(N)+1 [previously calculated and updated] < threshold
-      **
-      ** -  C2. Equals character from `curChar` : (Posbuilt Match Addiction)
-      **    If this node character match with `curChar`, it means that we got to add it with ED(N) (indeed, when we got a match, we have ED=0) [1]
-      **    Once doing it, we have to add the descendant nodes of P (called here `PChild`) with distance PChild = ED(P) + DeepthFrom(P, PChild) < threshold
-      **
-      ** Addendum [1] - I must update the distance only if the new distance is lower than the last distance (it happens when a previously father node have been calculated)
-      */
+    // the child must be a leaf without values
+    void removeChild(Node_t node, unsigned int value)
+    {
+      m_freeIds.push_back(node->removeChild(value));
+    }
 
-      for (auto curActiveNode = set.begin(); curActiveNode != set.end(); curActiveNode++) {
+    uint32_t getId(Node_t node) const
+    {
+      return node->getId();
+    }
 
-        // std::cout << "\nScanning children of node " << m_reverseCharacterMap[curActiveNode->node->getContent()] << '\n';
+    template <typename Fn>
+    void forEachChild(Node_t node, Fn fn) const
+    {
+      node->forEachChild(fn);
+    }
 
-        for (auto childOfcurActiveNode : curActiveNode->node->getChildren()) {
-          // std::cout << " * Node " << m_reverseCharacterMap[childOfcurActiveNode->getContent()] << " found ";
-          if (childOfcurActiveNode->getContent() != curChar) { // case 1
-            // std::cout << " and haven't matched with the character,";
-            if (curActiveNode->editDistance < m_fuzzyLimitThreshold) { // verify if ED(N)+1 < P
-              // std::cout << " but it's edit distance can be increased and it would be added to the set";
-              int newEditDistance = curActiveNode->editDistance + 1; // the new edit distance for the child
+    unsigned int getContent(Node_t node) const
+    {
+      return node->getContent();
+    }
 
-              // retrieves to add the child, return FALSE if it was not possible, cuz the child was already added before (so, i've to verify which edit distance is lower : the current or the previous?)
-              auto childIteratorOnSet = activeNodeSet.emplace(childOfcurActiveNode, newEditDistance);
+    bool isEndOfWord(Node_t node) const
+    {
+      return node->isEndOfWord();
+    }
 
-              // if the child was not added (it was cuz' there was a activeNode marked on this node before) and the last ED is bigger than the new ED
-              if (!childIteratorOnSet.second) {
-                if (childIteratorOnSet.first->editDistance > newEditDistance) {
-                  childIteratorOnSet.first->editDistance = newEditDistance; // guaranteed by addendum 1
-                }
-              }
-            }
-            // std::cout << '\n';
-          } else { // case 2
-            // std::cout << " and it matches with the character, so will be added to the set\n";
-            // retrieves to add the child, return FALSE if it was not possible, cuz the child was already added before (so, i've to verify which edit distance is lower : the current or the previous?)
-            auto childIteratorOnSet = activeNodeSet.emplace(childOfcurActiveNode, curActiveNode->editDistance);
+    void addValue(Node_t node, PayloadView_t content, unsigned int score)
+    {
+      if (!node->isEndOfWord()) {
+        node->buildContent();
+        node->setEndOfWord(true);
+      }
 
-            int currentChildDistance = childIteratorOnSet.first->editDistance;
+      node->addValue({ m_payloads.intern(content), score });
+    }
 
-            if (!childIteratorOnSet.second) { /* processor thanks! */
-              if (childIteratorOnSet.first->editDistance > curActiveNode->editDistance) {
-                currentChildDistance = childIteratorOnSet.first->editDistance = curActiveNode->editDistance;
-              }
-            }
+    // renumbers the values of every node once the payloads without uses are dropped (see `PayloadArena_t::compact`)
+    void reclaimPayloads()
+    {
+      if (!m_payloads.wasteful()) {
+        return;
+      }
 
-            /*
-            **  I've to fetch the children and the entire set of children to the active node if
-            **  and only if the dist( father, getChildRecursive(father)) ) < threshold;
-            */
-            // std::cout << "\t\tIt's children will be verifieds to be added to the set : \n";
-
-            std::queue<TrieNode_t*> toRecover; // a queue to save which node is on the way
-            toRecover.push(childIteratorOnSet.first->node); // adding the current matched node to the queue
-
-            // while the distance is lesser than the limit and we got some node to recover...
-            while (currentChildDistance < m_fuzzyLimitThreshold && !toRecover.empty()) {
-              // recover the current node from the queue
-              TrieNode_t*& currentNode = toRecover.front();
-              // std::cout << "\t\tCurrent node : " << m_reverseCharacterMap[currentNode->getContent()] << '\n';
-              // and update the distance to one more
-              ++currentChildDistance;
-
-              // for each child of the current node
-              for (auto child : currentNode->getChildren()) {
-
-                // we add this child to the active node set, once we can face it as a addiction operation inside the boundary imposed by the search
-                auto currentChildIterator = activeNodeSet.emplace(child, currentChildDistance);
-                // std::cout << "\t\t * Children " << m_reverseCharacterMap[currentChildIterator.first->node->getContent()] << " added to the set ";
-                // if there was this child within the activeNode, we have to keep the minor operation distance
-                if (!currentChildIterator.second) {
-                  // std::cout << "by update/permanence ";
-                  if (currentChildIterator.first->editDistance > currentChildDistance) {
-                    currentChildIterator.first->editDistance = currentChildDistance;
-                  }
-                }
-                // std::cout<<" with edit distance " << currentChildIterator.first->editDistance << '\n';
-
-                // and put it if and only if the currentDistance is lesser than the thresould (the memory and processment thank!)
-                if (currentChildDistance < m_fuzzyLimitThreshold) {
-                  toRecover.push(child);
-                }
-              }
-              toRecover.pop();
-            }
+      std::vector<uint32_t> ids = m_payloads.compact();
+      std::stack<Node_t> pending;
+      pending.push(this->m_lambdaNode.get());
+      while (!pending.empty()) {
+        Node_t current = pending.top();
+        pending.pop();
+        if (current->isEndOfWord()) {
+          for (PayloadRef_t& value : *current->getValues()) {
+            value.id = ids[value.id];
           }
         }
+        current->forEachChild([&](Node_t child) { pending.push(child); });
       }
-      // std::cout << "\n\n";
-      return activeNodeSet;
     }
 
-  public:
-    void putIndividualWord(std::string& str, const std::string& content)
+    // removes the value, the node stops being an end of word with its last value
+    bool removeValue(Node_t node, PayloadView_t content)
     {
-      TrieNode_t*currentRoot, *lastRoot;
-      currentRoot = this->m_lambdaNode.get();
-
-      wchar_t chart[str.size()];
-      push_string_to_wchar(chart, str);
+      if (!node->isEndOfWord()) {
+        return false;
+      }
 
-      for (unsigned int i = 0; i < wcslen(chart); i++) {
+      std::vector<PayloadRef_t>& values = *node->getValues();
+      auto found = std::find_if(values.begin(), values.end(), [&](const PayloadRef_t& value) { return m_payloads.get(value.id) == content; });
+      if (found == values.end()) {
+        return false;
+      }
 
-        unsigned int code = this->m_characterMap[chart[i]];
+      m_payloads.release(found->id);
+      values.erase(found);
+      if (values.empty()) {
+        node->clearValues();
+      }
+      reclaimPayloads();
+      return true;
+    }
 
-        lastRoot = currentRoot;
-        currentRoot = currentRoot->getChild(code);
-        if (!currentRoot) {
-          currentRoot = lastRoot->insertNReturnChild(code);
+    void clearValues(Node_t node)
+    {
+      if (node->isEndOfWord()) {
+        for (const PayloadRef_t& value : *node->getValues()) {
+          m_payloads.release(value.id);
         }
       }
+      node->clearValues();
+      reclaimPayloads();
+    }
 
-      if (currentRoot != this->m_lambdaNode.get()) {
-
-        if (!currentRoot->isEndOfWord()) {
-          currentRoot->buildContent();
-          currentRoot->setEndOfWord(true);
+    // fn(PayloadView_t value, unsigned int score)
+    template <typename Fn>
+    void forEachValue(Node_t node, Fn fn) const
+    {
+      if (node->isEndOfWord()) {
+        for (const PayloadRef_t& value : *node->getValues()) {
+          fn(m_payloads.get(value.id), value.score);
         }
-
-        currentRoot->addValue(content);
       }
     }
 
-    void buildActiveNodeSet(bool _onlyFinalWords)
+    PayloadView_t payload(uint32_t id) const
     {
-      std::queue<std::pair<TrieNode_t*, int>> seekQueue;
-      std::unordered_map<TrieNode_t*, TrieNode_t*> father;
-      std::set<TrieNode_t*> visited;
-      seekQueue.emplace(this->m_lambdaNode.get(), 0); // add the lambdaNode to the seek
-      m_activeNodeSet.emplace(this->m_lambdaNode.get(), 0); // add the lambdaNode to the activeSet
-      father.emplace(this->m_lambdaNode.get(), nullptr); // set lambdaNode father as nullptr
+      return m_payloads.get(id);
+    }
 
-      /* initialization */
+    std::size_t payloadCount() const
+    {
+      return m_payloads.size();
+    }
 
-      while (!seekQueue.empty()) {
-        auto currentNode = seekQueue.front(); // get currentNode
-        seekQueue.pop();
+    unsigned int getMaxScore(Node_t node) const
+    {
+      return node->getMaxScore();
+    }
 
-        for (TrieNode_t* child : currentNode.first->getChildren()) {
+    void raiseMaxScore(Node_t node, unsigned int score)
+    {
+      node->raiseMaxScore(score);
+    }
 
-          // verify if the child hasn't been visited recently
-          if (visited.find(child) == visited.end()) {
-            int currentLevel = currentNode.second + 1;
+    void setMaxScore(Node_t node, unsigned int score)
+    {
+      node->setMaxScore(score);
+    }
 
-            visited.emplace(child); // add child to the visited set
-            father.emplace(child, currentNode.first); // set current vertex as father
+    WordDepths_t getWordDepths(Node_t node) const
+    {
+      return node->getWordDepths();
+    }
 
-            if (currentLevel < m_fuzzyLimitThreshold) { // add the child on the seek only if it has a threshold < fuzzy
-              seekQueue.emplace(child, currentLevel);
-            }
+    void widenWordDepths(Node_t node, WordDepths_t below, std::size_t offset)
+    {
+      node->widenWordDepths(below, offset);
+    }
 
-            if (!_onlyFinalWords || child->isEndOfWord()) { // verify if this child is end of word
-              TrieNode_t* currentChild = child;
-              m_activeNodeSet.emplace(currentChild, currentLevel); // add the child to the activeSet
+    void setWordDepths(Node_t node, WordDepths_t depths)
+    {
+      node->setWordDepths(depths);
+    }
 
-              auto currentChild_it = father.find(child);
+    // bound of the node ids, the ids of removed nodes are reused before it grows
+    std::size_t nodeCount() const
+    {
+      return m_nodeCount;
+    }
 
-              // add all the father's father's father's ... father's of this child to the activeSet
-              while (currentChild_it->second != nullptr) {
+    /*
+    ** Moves every subtree under the root of `shard` (a store built apart, see `BasicBulkLoader_t`) under the root of this
+    ** one, renumbering its nodes after the ones already here and interning its values here. The first characters of the
+    ** shard must be new here.
+    */
+    void splice(PointerNodeStore_t& shard)
+    {
+      uint32_t offset = static_cast<uint32_t>(m_nodeCount) - 1; // the shard root (id 0) is left behind
+      std::vector<uint32_t> payloadIds = m_payloads.absorb(shard.m_payloads);
+      std::stack<Node_t> pending;
 
-                if (m_activeNodeSet.emplace(currentChild_it->second, --currentLevel).second) {
-                  currentChild_it = father.find(currentChild_it->second);
-                } else {
-                  break;
-                }
-              }
-            }
+      shard.m_lambdaNode->forEachChild([&](Node_t child) {
+        if (this->m_lambdaNode->getChild(child->getContent())) {
+          throw std::logic_error("the spliced subtrees must start with new characters");
+        }
+      });
+
+      shard.m_lambdaNode->releaseChildren([&](std::unique_ptr<TrieNode_t> child) {
+        pending.push(child.get());
+        this->m_lambdaNode->adoptChild(std::move(child));
+      });
+
+      while (!pending.empty()) {
+        Node_t current = pending.top();
+        pending.pop();
+        current->setId(current->getId() + offset);
+        if (current->isEndOfWord()) {
+          for (PayloadRef_t& value : *current->getValues()) {
+            value.id = payloadIds[value.id];
           }
         }
+        current->forEachChild([&](Node_t child) { pending.push(child); });
       }
+
+      m_lambdaNode->raiseMaxScore(shard.m_lambdaNode->getMaxScore());
+      m_lambdaNode->widenWordDepths(shard.m_lambdaNode->getWordDepths(), 0);
+      m_nodeCount += shard.m_nodeCount - 1;
+      shard = PointerNodeStore_t();
     }
 
-    void encodeCharacters(const std::string& filename)
+    void shrinkToFit()
     {
-      // std::cout << "[LOG] Encoding characters." << std::endl;
-      unsigned int lineCode = 1;
-      std::string currentLine;
-      std::ifstream fileInputStream(filename);
+    }
+
+    /*
+    ** Estimates the heap footprint : every node and every std::map entry is a separate allocation, the map entry
+    ** being a red-black node (3 pointers + color) holding the key and the unique_ptr.
+    */
+    MemoryUsage_t memoryUsage() const
+    {
+      const std::size_t mallocOverhead = sizeof(void*) * 2;
+      const std::size_t mapEntryBytes = sizeof(void*) * 4 + sizeof(std::pair<const unsigned int, std::unique_ptr<TrieNode_t>>) + mallocOverhead;
 
-      while (std::getline(fileInputStream, currentLine)) {
+      MemoryUsage_t usage;
+      std::stack<Node_t> pending;
+      pending.push(this->m_lambdaNode.get());
+      usage.payloadBytes = m_payloads.memoryUsage();
 
-        m_reverseCharacterMap.emplace(lineCode, currentLine.back());
+      while (!pending.empty()) {
+        Node_t current = pending.top();
+        pending.pop();
 
-        wchar_t anomalousCharacters[currentLine.size()];
-        push_string_to_wchar(anomalousCharacters, currentLine);
+        usage.nodes++;
+        usage.nodeBytes += sizeof(TrieNode_t) + mallocOverhead;
 
-        for (unsigned int i = 0; i < wcslen(anomalousCharacters); i++) {
-          m_characterMap.emplace(anomalousCharacters[i], lineCode);
+        if (current->isEndOfWord()) {
+          const auto* values = current->getValues();
+          usage.payloadBytes += sizeof(*values) + mallocOverhead + values->capacity() * sizeof(PayloadRef_t);
         }
 
-        lineCode++;
+        current->forEachChild([&](Node_t child) {
+          usage.edges++;
+          usage.edgeBytes += mapEntryBytes;
+          pending.push(child);
+        });
       }
 
-      m_reverseCharacterMap[0] = '#'; // lambda character
-      std::cout << "Charmap has been mapped.\n";
+      return usage;
     }
+  };
 
-    void addStopWords(const std::string& filename)
-    {
-      std::string currentLine;
-      std::ifstream fileInputStream(filename);
+  template <typename Node>
+  struct BasicActiveNode_t {
+    Node node;
+    mutable int editDistance;
+    mutable int positionDistance;
 
-      while (std::getline(fileInputStream, currentLine)) {
-        std::transform(currentLine.begin(), currentLine.end(), currentLine.begin(), ::tolower);
-        m_stopWords.insert(currentLine);
-      }
+    BasicActiveNode_t(Node nd, int ed)
+    : node(nd)
+    , editDistance(ed)
+    , positionDistance(0)
+    {
     }
 
-    bool isStopWord(std::string str)
+    BasicActiveNode_t(Node nd, int ed, int pos)
+    : node(nd)
+    , editDistance(ed)
+    , positionDistance(pos)
     {
-      std::transform(str.begin(), str.end(), str.begin(), ::tolower);
-      return m_stopWords.find(str) != m_stopWords.end();
     }
 
-    // Trie_t public methods
-
-    Trie_t()
-    : m_searchLimitThreshold(5)
-    , m_fuzzyLimitThreshold(1)
+    bool operator<(const BasicActiveNode_t& anode) const
     {
-      this->m_lambdaNode.reset(new TrieNode_t(0));
+      return this->node < anode.node;
+    }
+  };
 
-      DIR* dirp;
-      struct dirent* directory;
-      dirp = opendir("./stopwords");
-      if (dirp) {
-        while ((directory = readdir(dirp)) != NULL) {
-          if (directory->d_type == DT_REG) {
-            std::cout << "The stopword file \'" << directory->d_name << "\' has been detected.\n";
-            this->addStopWords(std::string("./stopwords/") + (directory->d_name));
-          }
-        }
-        closedir(dirp);
-      }
+  typedef BasicActiveNode_t<TrieNode_t*> ActiveNode_t;
 
-      encodeCharacters("charmap.cm");
+  struct ActiveNodeComparator_t {
+    template <typename ActiveNode>
+    bool operator()(const ActiveNode& n1, const ActiveNode& n2) const
+    {
+      return n1.editDistance > n2.editDistance;
     }
+  };
 
-    void printTrie()
-    {
-      TrieNode_t* currentNode;
-      std::set<TrieNode_t*> visited;
+  // what answers the whole word fuzzy queries (`searchSimilarKeyword` and its forms)
+  enum FuzzyEngine_t {
+    kEngineActiveNodes = 0, // the active node sets of the trie, one per character of the keyword
+    kEngineDeletions, // the deletion index, see `buildDeletionIndex`
+    kEngineAutomaton // a single depth-first walk carrying the edit distance row of the keyword (Levenshtein automaton)
+  };
 
-      std::stack<TrieNode_t*> nodeStack;
-      nodeStack.push(this->m_lambdaNode.get());
+  template <typename Storage>
+  class BasicAutocompleteSession_t;
 
-      while (!nodeStack.empty()) {
-        currentNode = nodeStack.top();
+  template <typename Storage>
+  class BasicBulkLoader_t;
 
-        if (visited.find(currentNode) == visited.end()) {
-          visited.insert(currentNode);
-          std::cout << "[" << this->m_reverseCharacterMap[currentNode->getContent()] << (currentNode->isEndOfWord() ? "'" : " ");
-          std::vector<TrieNode_t*> children = currentNode->getChildren();
+  template <typename Storage>
+  class BasicCorrector_t;
 
-          while (!children.empty()) {
-            nodeStack.push(children.back());
-            children.pop_back();
-          }
+  template <typename Storage>
+  class BasicTrie_t {
+    template <typename Other>
+    friend class BasicTrie_t;
 
-        } else {
-          nodeStack.pop();
-          std::cout << "]";
-        }
-      }
-    }
+  public:
+    typedef typename Storage::Node_t Node_t;
+    typedef BasicActiveNode_t<Node_t> ActiveNode_t;
+    typedef std::vector<ActiveNode_t> ActiveNodeSet_t; // every node appears once
+    typedef BasicQueryScratch_t<ActiveNode_t, Node_t> QueryScratch_t;
+    typedef BasicRankedEntry_t<Node_t> RankedEntry_t;
+    typedef BasicPrefixTable_t<ActiveNode_t> PrefixTable_t;
+
+  private:
+    Storage m_nodes; // owns every node of the structure
+    Node_t m_lambdaNode; // used to indicate the first node
+    std::shared_ptr<const TextTables_t> m_tables; // charmap and stopwords, shared with the tries of the same language
+    ActiveNodeSet_t m_activeNodeSet; // uset to save the main activeNode set
+    bool m_onlyFinalWords; // the initial active node set only holds the final words within the threshold and their ancestors
+    std::vector<Node_t> m_editPath; // nodes of the word being inserted
+    int m_searchLimitThreshold; // threshold used for delimit the answers amount (default : 5)
+    int m_fuzzyLimitThreshold; // threshold used for delimit the edit distance from node (default : 1)
+    int64_t m_distancePenalty; // score lost per edit on the ranked autocomplete (default : 2^32, the distance always dominates)
+    std::shared_ptr<StatsCollector_t> m_stats; // receives the stats of every query, none by default
+    std::shared_ptr<ResultCache_t> m_cache; // answers the repeated queries, none by default
+    std::unique_ptr<DeletionIndex_t> m_deletions; // the words for kEngineDeletions, none by default
+    std::unique_ptr<PrefixTable_t> m_prefixes; // ready-made active node sets of the hot prefixes, none by default (see `buildPrefixTable`)
+    uint64_t m_generation; // renewed by every modification (see `nextTrieGeneration`)
+    const std::vector<std::string> m_emptyResponse;
 
-    std::pair<bool, std::vector<std::string>> searchKeyword(std::string& keyword)
+    // code of a character, 0 when the charmap does not define it
+    unsigned int characterCode(uint32_t character) const
     {
-      std::transform(keyword.begin(), keyword.end(), keyword.begin(), ::tolower);
-      wchar_t chart[keyword.size()];
-      push_string_to_wchar(chart, keyword);
-
-      TrieNode_t* currentNode = this->m_lambdaNode.get();
+      return this->m_tables->characterMap.code(character);
+    }
 
-      for (unsigned int i = 0; i < wcslen(chart); i++) {
-        currentNode = currentNode->getChild(m_characterMap[chart[i]]);
+    // spends a node of the budget of the query, false once the query has to stop (always true without options)
+    static bool withinBudget(QueryScratch_t& scratch)
+    {
+      return !scratch.budget || scratch.budget->spend();
+    }
 
-        if (currentNode == nullptr) {
-          break;
-        }
-      }
+    static bool exhausted(const QueryScratch_t& scratch)
+    {
+      return scratch.budget && scratch.budget->exhausted();
+    }
 
-      if (currentNode != nullptr) {
-        if (currentNode->isEndOfWord()) {
-          return { true, *currentNode->getValues() };
-        }
+    /*
+    ** Whether a node at this distance still leads to a word of a length the query can match : `remaining` characters of the
+    ** query are left, and a word `r` levels below the node costs at least |remaining - r| more edits. Always true for a
+    ** prefix (remaining < 0), any longer word completing it.
+    */
+    bool reachesWord(Node_t node, int editDistance, int remaining) const
+    {
+      if (remaining < 0) {
+        return true;
       }
 
-      return { false, this->m_emptyResponse };
+      WordDepths_t depths = m_nodes.getWordDepths(node);
+      int slack = m_fuzzyLimitThreshold - editDistance;
+      return depths.min <= remaining + slack && depths.max + slack >= remaining;
     }
 
-    std::priority_queue<TrieResponse_t, std::vector<TrieResponse_t>, TrieResponseComparator_t> searchSimilarKeyword(std::string& keyword)
+    /*
+    ** The match addiction of `buildNewSet` below its matched child, `currentChildDistance` being the distance the child got
+    ** in the set (-1 when it was left out). Returns the amount of nodes reached. It stays out of the per-child code, which
+    ** is then small enough to be inlined in the child loop of every store.
+    */
+    template <typename Relax>
+    std::size_t expandMatch(Node_t childOfcurActiveNode, int currentChildDistance, QueryScratch_t& scratch, Relax& relax) const
     {
-      std::priority_queue<TrieResponse_t, std::vector<TrieResponse_t>, TrieResponseComparator_t> ocurrencesQueue;
-
-      std::transform(keyword.begin(), keyword.end(), keyword.begin(), ::tolower);
-
-      std::set<ActiveNode_t> lastActiveNodes = this->m_activeNodeSet;
+      /*
+      **  I've to fetch the children and the entire set of children to the active node if
+      **  and only if the dist( father, getChildRecursive(father)) ) < threshold;
+      */
+      // std::cout << "\t\tIt's children will be verifieds to be added to the set : \n";
 
-      wchar_t chart[keyword.size()];
-      push_string_to_wchar(chart, keyword);
+      // a queue to save which node is on the way, each one with the distance of its children (one per level below P)
+      std::vector<std::pair<Node_t, int>>& toRecover = scratch.expansion;
+      toRecover.clear();
 
-      for (unsigned int i = 0; i < wcslen(chart); i++) {
-        lastActiveNodes = buildNewSet(lastActiveNodes, m_characterMap[chart[i]]);
+      if (currentChildDistance >= 0 && currentChildDistance < m_fuzzyLimitThreshold) {
+        toRecover.emplace_back(childOfcurActiveNode, currentChildDistance + 1); // adding the current matched node to the queue
       }
 
-      for (auto node : lastActiveNodes) {
+      // while we got some node to recover...
+      for (std::size_t head = 0; head < toRecover.size(); head++) {
+        // recover the current node from the queue
+        Node_t currentNode = toRecover[head].first;
+        int childDistance = toRecover[head].second;
+        // std::cout << "\t\tCurrent node : " << m_reverseCharacterMap[currentNode->getContent()] << '\n';
+
+        // for each child of the current node
+        m_nodes.forEachChild(currentNode, [&](Node_t child) {
+
+          // we add this child to the active node set, once we can face it as a addiction operation inside the boundary imposed by the search
+          // if there was this child within the activeNode, we have to keep the minor operation distance
+          // (none of the subtree can reach a word when the child cannot)
+          if (relax(child, childDistance) < 0) {
+            return;
+          }
 
-        if (node.node->isEndOfWord()) {
-          for (auto& _target : *node.node->getValues()) {
-            ocurrencesQueue.emplace(_target, node.editDistance);
+          // and put it if and only if the currentDistance is lesser than the thresould (the memory and processment thank!)
+          if (childDistance < m_fuzzyLimitThreshold) {
+            toRecover.emplace_back(child, childDistance + 1);
           }
-        }
+        });
       }
-
-      return ocurrencesQueue;
+      return toRecover.size();
     }
 
-    std::priority_queue<TrieResponse_t, std::vector<TrieResponse_t>, TrieResponseComparator_t> autocomplete(std::string& keyword)
+    /*
+    ** Builds on `activeNodeSet` the active nodes of the prefix extended by `curChar`. The sets are flat vectors and the
+    ** duplicated nodes are found through the stamped index of the scratch, so no memory is allocated once the buffers have grown.
+    ** When the query matches whole words, `remaining` is the amount of its characters after `curChar`, and the nodes which
+    ** cannot reach a word of a compatible length (see `reachesWord`) are left out with the subtrees of the match addiction
+    ** below them : every node derived from them later would be in their subtree, so it could not reach such a word either.
+    */
+    void buildNewSet(const ActiveNodeSet_t& set, unsigned int curChar, ActiveNodeSet_t& activeNodeSet, QueryScratch_t& scratch, int remaining = -1) const
     {
-      std::priority_queue<TrieResponse_t, std::vector<TrieResponse_t>, TrieResponseComparator_t> ocurrencesQueue;
-      std::priority_queue<ActiveNode_t, std::vector<ActiveNode_t>, ActiveNodeComparator_t> activeList;
+      activeNodeSet.clear();
+      scratch.members.reset(m_nodes.nodeCount());
+      std::size_t expanded = 0; // nodes reached by the match addiction
 
-      std::transform(keyword.begin(), keyword.end(), keyword.begin(), ::tolower);
+      /*
+      ** adds the node to the set, or lowers its distance when it was already there; returns the resulting distance, which
+      ** is -1 when the node is not added because it cannot reach a word
+      */
+      auto relax = [&](Node_t node, int editDistance) -> int {
+        uint32_t id = m_nodes.getId(node);
+        uint32_t slot = scratch.members.find(id);
 
-      std::set<ActiveNode_t> lastActiveNodes = this->m_activeNodeSet;
+        if (slot == StampedIndex_t::kNone) {
+          if (!reachesWord(node, editDistance, remaining)) {
+            return -1;
+          }
+          scratch.members.set(id, static_cast<uint32_t>(activeNodeSet.size()));
+          activeNodeSet.emplace_back(node, editDistance);
+          return editDistance;
+        }
+
+        // guaranteed by addendum 1
+        if (activeNodeSet[slot].editDistance > editDistance) {
+          activeNodeSet[slot].editDistance = editDistance;
+        }
+        return activeNodeSet[slot].editDistance;
+      };
+
+      /*
+      ** Considering node N
+      ** We can transform the content of this node for the currentWord by first adding a character. (Prebuilt Addiction)
+      */
+      // std::cout << "\nBuilding node for " << m_reverseCharacterMap[curChar] << '\n';
+      for (auto curActiveNode = set.begin(); curActiveNode != set.end(); curActiveNode++) {
+        if (curActiveNode->editDistance < m_fuzzyLimitThreshold) {
+          // std::cout << " * Updating distance for node " << m_reverseCharacterMap[curActiveNode->node->getContent()] << " from " << curActiveNode->editDistance << " to " << curActiveNode->editDistance + 1 << '\n';
+          relax(curActiveNode->node, curActiveNode->editDistance + 1);
+        }
+      }
+
+      /*
+      ** Considering no+de P (child of N)
+      ** -  C1. Different character from `curChar` : (Posbuilt Substitution Addiction)
+      **    We can transform this character of P for the current character by substitution, relative to ED(N), then, we have to add P to
+      **    the set if and only if ED(N)+1 [previously calculated and updated] < threshold
+      **
+      ** -  C2. Equals character from `curChar` : (Posbuilt Match Addiction)
+      **    If this node character match with `curChar`, it means that we got to add it with ED(N) (indeed, when we got a match, we have ED=0) [1]
+      **    Once doing it, we have to add the descendant nodes of P (called here `PChild`) with distance PChild = ED(P) + DeepthFrom(P, PChild) < threshold
+      **
+      ** Addendum [1] - I must update the distance only if the new distance is lower than the last distance (it happens when a previously father node have been calculated)
+      */
+
+      for (auto curActiveNode = set.begin(); curActiveNode != set.end(); curActiveNode++) {
+
+        // std::cout << "\nScanning children of node " << m_reverseCharacterMap[curActiveNode->node->getContent()] << '\n';
+
+        m_nodes.forEachChild(curActiveNode->node, [&](Node_t childOfcurActiveNode) {
+          // std::cout << " * Node " << m_reverseCharacterMap[childOfcurActiveNode->getContent()] << " found ";
+          if (m_nodes.getContent(childOfcurActiveNode) != curChar) { // case 1
+            // std::cout << " and haven't matched with the character,";
+            if (curActiveNode->editDistance < m_fuzzyLimitThreshold) { // verify if ED(N)+1 < P
+              // std::cout << " but it's edit distance can be increased and it would be added to the set";
+              int newEditDistance = curActiveNode->editDistance + 1; // the new edit distance for the child
+
+              // add the child, or keep the lowest distance when there was a activeNode marked on this node before
+              relax(childOfcurActiveNode, newEditDistance);
+            }
+            // std::cout << '\n';
+          } else { // case 2
+            // std::cout << " and it matches with the character, so will be added to the set\n";
+            // add the child, or keep the lowest distance when it was already added before (the previous one may be lower)
+            int currentChildDistance = relax(childOfcurActiveNode, curActiveNode->editDistance); // -1 skips the expansion
+
+            expanded += expandMatch(childOfcurActiveNode, currentChildDistance, scratch, relax);
+          }
+        });
+      }
+      // std::cout << "\n\n";
+
+      if (scratch.stats) {
+        scratch.stats->activeNodes.push_back(static_cast<uint32_t>(activeNodeSet.size()));
+        scratch.stats->expandedNodes.push_back(static_cast<uint32_t>(expanded));
+      }
+    }
+
+    static QueryScratch_t& threadScratch()
+    {
+      static thread_local QueryScratch_t scratch;
+      return scratch;
+    }
+
+    // character codes of a keyword, the same conversion done by the query methods
+    void encodeKeyword(const std::string& keyword, std::vector<unsigned int>& codes) const
+    {
+      this->m_tables->characterMap.encode(keyword, codes);
+    }
+
+    /*
+    ** Replays the keyword from the initial active node set, the returned set lives on the scratch. With `wholeWords` the set
+    ** only keeps the nodes which lead to words the keyword matches whole (see `buildNewSet`), not to longer ones.
+    ** A budgeted query spends the nodes of a set before deriving the next one from it (`buildNewSet` is left without checks,
+    ** a step being short next to a whole walk), and gets an empty set when it runs out before the last character : the set
+    ** of a shorter prefix would answer another keyword.
+    ** The walk starts from the deepest prefix of the keyword held by the prefix table, when the trie has a current one.
+    */
+    const ActiveNodeSet_t& walkKeyword(const std::string& keyword, QueryScratch_t& scratch, bool wholeWords) const
+    {
+      encodeKeyword(keyword, scratch.codes);
+      return walkCodes(scratch, wholeWords);
+    }
+
+    // same as `walkKeyword`, for a keyword encoded on `scratch.codes` already
+    const ActiveNodeSet_t& walkCodes(QueryScratch_t& scratch, bool wholeWords) const
+    {
+      const ActiveNodeSet_t* lastActiveNodes = &this->m_activeNodeSet;
+      std::size_t i = 0;
+
+      if (m_prefixes && m_prefixes->generation() == m_generation) {
+        if (const ActiveNodeSet_t* cached = m_prefixes->find(scratch.codes.data(), scratch.codes.size(), i)) {
+          lastActiveNodes = cached;
+        }
+      }
+
+      for (; i < scratch.codes.size(); i++) {
+        ActiveNodeSet_t& nextActiveNodes = scratch.sets[i & 1];
+        if (scratch.budget && !scratch.budget->spend(lastActiveNodes->size())) {
+          nextActiveNodes.clear();
+          lastActiveNodes = &nextActiveNodes;
+          break;
+        }
+        int remaining = wholeWords ? static_cast<int>(scratch.codes.size() - i - 1) : -1;
+        buildNewSet(*lastActiveNodes, scratch.codes[i], nextActiveNodes, scratch, remaining);
+        lastActiveNodes = &nextActiveNodes;
+      }
+
+      if (scratch.stats) {
+        scratch.stats->markWalked();
+      }
+      return *lastActiveNodes;
+    }
+
+    // fn(PayloadView_t value, int editDistance, unsigned int score) for the words ending exactly on the active nodes (whole word fuzzy match)
+    template <typename Fn>
+    void visitSimilar(const ActiveNodeSet_t& activeNodes, QueryScratch_t& scratch, Fn fn) const
+    {
+      QueryStats_t* stats = scratch.stats;
+
+      for (auto& node : activeNodes) {
+        if (!withinBudget(scratch)) {
+          break;
+        }
+        if (stats) {
+          stats->visit(node.editDistance);
+        }
+        m_nodes.forEachValue(node.node, [&](PayloadView_t value, unsigned int score) {
+          fn(value, node.editDistance, score);
+          if (stats) {
+            stats->results++;
+          }
+        });
+      }
+    }
+
+    // same as `visitSimilar`, for at most `limit` values ordered by edit distance
+    template <typename Fn>
+    void visitTopSimilar(const ActiveNodeSet_t& activeNodes, std::size_t limit, QueryScratch_t& scratch, Fn fn) const
+    {
+      QueryStats_t* stats = scratch.stats;
+      std::size_t visited = 0;
+
+      // the distances are bounded by the fuzzy threshold, so a pass per distance is a bucket sort
+      for (int distance = 0; distance <= m_fuzzyLimitThreshold && visited < limit && !exhausted(scratch); distance++) {
+        for (auto& node : activeNodes) {
+          if (node.editDistance != distance) {
+            continue;
+          }
+          if (!withinBudget(scratch)) {
+            break;
+          }
+          if (stats) {
+            stats->visit(distance);
+          }
+          if (m_nodes.isEndOfWord(node.node)) {
+            m_nodes.forEachValue(node.node, [&](PayloadView_t value, unsigned int score) {
+              if (visited < limit) {
+                fn(value, distance, score);
+                visited++;
+              }
+            });
+
+            if (visited >= limit) {
+              break;
+            }
+          }
+        }
+      }
+
+      if (stats) {
+        stats->results = visited;
+      }
+    }
+
+    /*
+    ** fn(PayloadView_t value, int editDistance, unsigned int score) for every word below the active nodes (prefix fuzzy match).
+    ** The active nodes are expanded by increasing edit distance, and every word of a subtree takes the distance of the active
+    ** node which reached it first, so the first `limit` words visited are final.
+    */
+    template <typename Fn>
+    void visitCompletions(const ActiveNodeSet_t& activeNodes, std::size_t limit, QueryScratch_t& scratch, Fn fn) const
+    {
+      QueryStats_t* stats = scratch.stats;
+      std::size_t visited = 0;
+      ActiveNodeSet_t& activeList = scratch.order;
+      activeList.assign(activeNodes.begin(), activeNodes.end());
+      std::sort(activeList.begin(), activeList.end(), [this](const ActiveNode_t& n1, const ActiveNode_t& n2) { // std::stable_sort would allocate
+        return n1.editDistance != n2.editDistance ? n1.editDistance < n2.editDistance : m_nodes.getId(n1.node) < m_nodes.getId(n2.node);
+      });
+
+      std::vector<Node_t>& pQueue = scratch.pending;
+      scratch.visited.reset(m_nodes.nodeCount());
+
+      for (auto& aNode : activeList) {
+        if (visited >= limit || exhausted(scratch)) {
+          break;
+        }
+
+        if (!scratch.visited.insert(m_nodes.getId(aNode.node))) {
+          continue;
+        }
+
+        pQueue.clear();
+        pQueue.push_back(aNode.node);
+
+        for (std::size_t head = 0; head < pQueue.size() && visited < limit && withinBudget(scratch); head++) {
+          Node_t currentSeeker = pQueue[head];
+          if (stats) {
+            stats->visit(aNode.editDistance);
+          }
+
+          m_nodes.forEachValue(currentSeeker, [&](PayloadView_t oValue, unsigned int score) {
+            if (visited < limit) {
+              fn(oValue, aNode.editDistance, score);
+              visited++;
+            }
+          });
+
+          m_nodes.forEachChild(currentSeeker, [&](Node_t curChild) {
+            if (scratch.visited.insert(m_nodes.getId(curChild))) {
+              pQueue.push_back(curChild);
+            }
+          });
+        }
+
+        if (stats) {
+          stats->frontier(pQueue.size());
+        }
+      }
+
+      if (stats) {
+        stats->results = visited;
+      }
+    }
+
+    // the words ending exactly on the active nodes (whole word fuzzy match)
+    std::priority_queue<TrieResponse_t, std::vector<TrieResponse_t>, TrieResponseComparator_t> collectSimilar(const ActiveNodeSet_t& activeNodes, QueryScratch_t& scratch) const
+    {
+      std::priority_queue<TrieResponse_t, std::vector<TrieResponse_t>, TrieResponseComparator_t> ocurrencesQueue;
+      visitSimilar(activeNodes, scratch, [&](PayloadView_t value, int editDistance, unsigned int score) { ocurrencesQueue.emplace(value.str(), editDistance, score); });
+      return ocurrencesQueue;
+    }
+
+    // every word below the active nodes, each one with the lowest distance among its active ancestors (prefix fuzzy match)
+    std::priority_queue<TrieResponse_t, std::vector<TrieResponse_t>, TrieResponseComparator_t> collectCompletions(const ActiveNodeSet_t& activeNodes, QueryScratch_t& scratch) const
+    {
+      std::priority_queue<TrieResponse_t, std::vector<TrieResponse_t>, TrieResponseComparator_t> ocurrencesQueue;
+      visitCompletions(activeNodes, SIZE_MAX, scratch, [&](PayloadView_t value, int editDistance, unsigned int score) { ocurrencesQueue.emplace(value.str(), editDistance, score); });
+      return ocurrencesQueue;
+    }
+
+    // best-first version of `collectCompletions`, stopping on the first `limit` words
+    std::vector<TrieResponse_t> collectTopCompletions(const ActiveNodeSet_t& activeNodes, std::size_t limit, QueryScratch_t& scratch) const
+    {
+      std::vector<TrieResponse_t> responses;
+      visitCompletions(activeNodes, limit, scratch, [&](PayloadView_t value, int editDistance, unsigned int score) { responses.emplace_back(value.str(), editDistance, score); });
+      return responses;
+    }
+
+    /*
+    ** Best-first search ranked by `score - distancePenalty * editDistance` : every node carries the highest score of its subtree,
+    ** so a node entry bounds everything below it and whole subtrees which cannot beat the popped values are never expanded.
+    ** A node is expanded only once, from the entry with the lowest distance (which is also the one with the best bound).
+    ** fn(PayloadView_t value, int editDistance, unsigned int score) gets the best `limit` values, best first.
+    */
+    template <typename Fn>
+    void visitRankedCompletions(const ActiveNodeSet_t& activeNodes, std::size_t limit, QueryScratch_t& scratch, Fn fn) const
+    {
+      QueryStats_t* stats = scratch.stats;
+      std::size_t visited = 0;
+      std::vector<RankedEntry_t>& frontier = scratch.frontier;
+      frontier.clear();
+      scratch.visited.reset(m_nodes.nodeCount());
+
+      auto pushEntry = [&](const RankedEntry_t& entry) {
+        frontier.push_back(entry);
+        std::push_heap(frontier.begin(), frontier.end());
+      };
+
+      auto pushNode = [&](Node_t node, int editDistance) {
+        pushEntry({ int64_t(m_nodes.getMaxScore(node)) - m_distancePenalty * editDistance, editDistance, node, false, PayloadView_t(), 0 });
+      };
+
+      for (auto& aNode : activeNodes) {
+        pushNode(aNode.node, aNode.editDistance);
+      }
+
+      while (!frontier.empty() && visited < limit) {
+        std::pop_heap(frontier.begin(), frontier.end());
+        RankedEntry_t entry = frontier.back();
+        frontier.pop_back();
+
+        if (entry.isValue) {
+          fn(entry.value, entry.editDistance, entry.score);
+          visited++;
+          continue;
+        }
+
+        if (!scratch.visited.insert(m_nodes.getId(entry.node))) {
+          continue;
+        }
+        if (!withinBudget(scratch)) {
+          break; // the values given so far are the best ones, in order
+        }
+        if (stats) {
+          stats->visit(entry.editDistance);
+        }
+
+        m_nodes.forEachValue(entry.node, [&](PayloadView_t value, unsigned int score) {
+          pushEntry({ int64_t(score) - m_distancePenalty * entry.editDistance, entry.editDistance, entry.node, true, value, score });
+        });
+
+        m_nodes.forEachChild(entry.node, [&](Node_t child) {
+          if (!scratch.visited.contains(m_nodes.getId(child))) {
+            pushNode(child, entry.editDistance);
+          }
+        });
+
+        if (stats) {
+          stats->frontier(frontier.size());
+        }
+      }
+
+      if (stats) {
+        stats->results = visited;
+      }
+    }
+
+    std::vector<TrieResponse_t> collectRankedCompletions(const ActiveNodeSet_t& activeNodes, std::size_t limit, QueryScratch_t& scratch) const
+    {
+      std::vector<TrieResponse_t> responses;
+      visitRankedCompletions(activeNodes, limit, scratch, [&](PayloadView_t value, int editDistance, unsigned int score) { responses.emplace_back(value.str(), editDistance, score); });
+      return responses;
+    }
+
+    // fn(PayloadView_t value, int editDistance, unsigned int score) for the results of a query of this kind over the active nodes
+    template <typename Fn>
+    void visitResults(QueryKind_t kind, const ActiveNodeSet_t& activeNodes, std::size_t limit, QueryScratch_t& scratch, Fn fn) const
+    {
+      switch (kind) {
+        case kQuerySimilar:
+          visitSimilar(activeNodes, scratch, fn);
+          break;
+        case kQueryTopSimilar:
+          visitTopSimilar(activeNodes, limit, scratch, fn);
+          break;
+        case kQueryCompletions:
+          visitCompletions(activeNodes, limit, scratch, fn);
+          break;
+        default:
+          visitRankedCompletions(activeNodes, limit, scratch, fn);
+      }
+    }
+
+    /*
+    ** Whole word query answered by the deletion index : fn(PayloadView_t value, int editDistance, unsigned int score) for the
+    ** values of at most `limit` similar words, closest first. The index gives the words as codes, found again on the trie.
+    */
+    template <typename Fn>
+    void visitDeletionMatches(std::size_t limit, QueryScratch_t& scratch, Fn fn) const
+    {
+      if (!m_deletions) {
+        throw std::logic_error("the trie has no deletion index, see buildDeletionIndex");
+      }
+
+      QueryStats_t* stats = scratch.stats;
+      scratch.matches.clear();
+      m_deletions->forEachMatch(scratch.codes, m_fuzzyLimitThreshold, [&](const std::u32string& word, int editDistance) {
+        if (!withinBudget(scratch)) {
+          return; // the probes left are a few hash lookups, only the matches are dropped
+        }
+        Node_t node = this->m_lambdaNode;
+        for (char32_t code : word) {
+          node = m_nodes.getChild(node, code); // the index only holds words of the trie
+        }
+        scratch.matches.emplace_back(editDistance, node);
+        if (stats) {
+          stats->visit(editDistance);
+        }
+      });
+
+      if (stats) {
+        stats->markWalked();
+      }
+      visitMatches(limit, scratch, fn);
+    }
+
+    /*
+    ** Depth-first walk of the trie carrying, for the path down to every node, the edit distances of all the prefixes of the
+    ** keyword (`scratch.codes`). step(depth, code, depths, distance) derives the row of depth `depth` from the one above it,
+    ** sets `distance` to the distance of the whole keyword and returns a lower bound of the distance of the words below the
+    ** node (of depths `depths`, see `cellBound`). A subtree is left out once that bound is over `maxDistance`, when none of
+    ** its words has a length within `maxDistance` of the keyword, or when admits(depth, code) rules its first character out
+    ** from the row above it. The words within `maxDistance` go to `scratch.matches`.
+    */
+    template <typename Admits, typename Step>
+    void walkRows(int maxDistance, QueryScratch_t& scratch, Admits admits, Step step) const
+    {
+      QueryStats_t* stats = scratch.stats;
+      int length = static_cast<int>(scratch.codes.size());
+      std::vector<std::pair<Node_t, int>>& pending = scratch.descent;
+      pending.clear();
+
+      auto push = [&](Node_t node, int depth) {
+        if (!admits(depth, m_nodes.getContent(node))) {
+          return;
+        }
+        WordDepths_t depths = m_nodes.getWordDepths(node);
+        if (depths.min <= depths.max && depth + depths.min <= length + maxDistance && depth + depths.max + maxDistance >= length) {
+          pending.emplace_back(node, depth);
+        }
+      };
+      m_nodes.forEachChild(this->m_lambdaNode, [&](Node_t child) { push(child, 1); });
+
+      while (!pending.empty() && withinBudget(scratch)) {
+        Node_t node = pending.back().first;
+        int depth = pending.back().second;
+        pending.pop_back();
+
+        int distance = 0;
+        int lowest = step(depth, m_nodes.getContent(node), m_nodes.getWordDepths(node), distance);
+        if (stats) {
+          stats->visit(lowest);
+        }
+
+        if (distance <= maxDistance && m_nodes.isEndOfWord(node)) {
+          scratch.matches.emplace_back(distance, node);
+        }
+        if (lowest <= maxDistance) {
+          m_nodes.forEachChild(node, [&](Node_t child) { push(child, depth + 1); });
+        }
+      }
+    }
+
+    /*
+    ** Cheapest way to finish a word below the node from the cell of the keyword prefix `prefix` on its row : the path to the
+    ** word crosses the row on some cell, the rest of the keyword then costs at least the difference between its length and
+    ** the depth of the word below the node.
+    */
+    static int cellBound(int cell, int prefix, int length, WordDepths_t depths)
+    {
+      int rest = length - prefix;
+      return cell + std::max(0, std::max(rest - int(depths.max), int(depths.min) - rest));
+    }
+
+    /*
+    ** Levenshtein automaton of the keyword on `scratch.codes`, run over the trie by `walkRows` : the words within
+    ** `maxDistance` edits go to `scratch.matches` with their exact distance. Up to 64 codes, a row is two machine words
+    ** updated by a few bit operations per node (Myers / Hyyro), and only its cells on the diagonal band can be within
+    ** `maxDistance`; the longer keywords (and the empty one) get a plain dynamic programming row.
+    */
+    void walkAutomaton(int maxDistance, QueryScratch_t& scratch) const
+    {
+      const std::vector<unsigned int>& codes = scratch.codes;
+      int length = static_cast<int>(codes.size());
+      scratch.matches.clear();
+      if (maxDistance < 0) {
+        return;
+      }
+
+      if (length == 0 || length > 64) {
+        std::vector<int>& rows = scratch.rows; // rows[d * (length + 1) + i] : distance between the keyword prefix i and the path prefix d
+        rows.resize(length + 1);
+        for (int i = 0; i <= length; i++) {
+          rows[i] = i;
+        }
+
+        auto any = [](int, unsigned int) { return true; };
+        walkRows(maxDistance, scratch, any, [&](int depth, unsigned int code, WordDepths_t depths, int& distance) {
+          if (rows.size() < std::size_t(depth + 1) * (length + 1)) {
+            rows.resize(std::size_t(depth + 1) * (length + 1));
+          }
+          const int* above = &rows[std::size_t(depth - 1) * (length + 1)];
+          int* row = &rows[std::size_t(depth) * (length + 1)];
+          row[0] = depth;
+          int lowest = cellBound(row[0], 0, length, depths);
+          for (int i = 1; i <= length; i++) {
+            row[i] = std::min(std::min(above[i], row[i - 1]) + 1, above[i - 1] + (codes[i - 1] != code));
+            lowest = std::min(lowest, cellBound(row[i], i, length, depths));
+          }
+          distance = row[length];
+          return lowest;
+        });
+        return;
+      }
+
+      std::vector<uint64_t>& positions = scratch.positions;
+      std::fill(positions.begin(), positions.end(), 0);
+      for (int i = 0; i < length; i++) {
+        if (codes[i] >= positions.size()) {
+          positions.resize(codes[i] + 1, 0);
+        }
+        positions[codes[i]] |= uint64_t(1) << i;
+      }
+
+      std::vector<BitRow_t>& rows = scratch.bitRows;
+      rows.resize(1);
+      rows[0] = { ~uint64_t(0), 0, ~uint64_t(0), length };
+      uint64_t last = uint64_t(1) << (length - 1);
+
+      auto admits = [&](int depth, unsigned int code) {
+        uint64_t reach = rows[depth - 1].reach;
+        return reach == ~uint64_t(0) || (code < positions.size() && (positions[code] & reach));
+      };
+
+      walkRows(maxDistance, scratch, admits, [&](int depth, unsigned int code, WordDepths_t depths, int& distance) {
+        if (rows.size() <= std::size_t(depth)) {
+          rows.resize(depth + 1);
+        }
+        const BitRow_t& above = rows[depth - 1];
+        BitRow_t& row = rows[depth];
+        uint64_t match = code < positions.size() ? positions[code] : 0;
+
+        uint64_t vertical = match | above.negative;
+        uint64_t horizontal = (((match & above.positive) + above.positive) ^ above.positive) | match;
+        uint64_t up = above.negative | ~(horizontal | above.positive);
+        uint64_t down = above.positive & horizontal;
+        row.distance = above.distance + ((up & last) != 0) - ((down & last) != 0);
+        up = (up << 1) | 1; // the empty keyword prefix is `depth` edits away
+        down <<= 1;
+        row.positive = down | ~(vertical | up);
+        row.negative = up & vertical;
+        distance = row.distance;
+
+        // a cell off the band [depth - maxDistance, depth + maxDistance] is over maxDistance anyway
+        int from = std::max(depth - maxDistance, 0);
+        int to = std::min(depth + maxDistance, length);
+        if (from > to) {
+          return maxDistance + 1;
+        }
+        uint64_t below = from == 64 ? ~uint64_t(0) : (uint64_t(1) << from) - 1;
+        int cell = depth + __builtin_popcountll(row.positive & below) - __builtin_popcountll(row.negative & below);
+        int lowest = cellBound(cell, from, length, depths);
+        int lowestCell = cell;
+        row.reach = cell <= maxDistance && from < length ? uint64_t(1) << from : 0;
+        for (int i = from; i < to; i++) {
+          cell += int((row.positive >> i) & 1) - int((row.negative >> i) & 1);
+          lowest = std::min(lowest, cellBound(cell, i + 1, length, depths));
+          lowestCell = std::min(lowestCell, cell);
+          if (cell <= maxDistance && i + 1 < length) {
+            row.reach |= uint64_t(1) << (i + 1);
+          }
+        }
+
+        /*
+        ** A cell of the child row within maxDistance comes from a cell under it here, or from a cell at it through a match :
+        ** with every cell at maxDistance or over (and the first cell of the child over it), the child has to match a code
+        ** of the keyword where this row is at maxDistance.
+        */
+        if (lowestCell < maxDistance || depth + 1 <= maxDistance) {
+          row.reach = ~uint64_t(0);
+        }
+        return lowest;
+      });
+    }
+
+    // whole word query answered by `walkAutomaton`, as `visitDeletionMatches`
+    template <typename Fn>
+    void visitAutomatonMatches(std::size_t limit, QueryScratch_t& scratch, Fn fn) const
+    {
+      walkAutomaton(m_fuzzyLimitThreshold, scratch);
+      if (scratch.stats) {
+        scratch.stats->markWalked();
+      }
+      visitMatches(limit, scratch, fn);
+    }
+
+    // fn(PayloadView_t value, int editDistance, unsigned int score) for the values of at most `limit` words of `scratch.matches`, closest first
+    template <typename Fn>
+    void visitMatches(std::size_t limit, QueryScratch_t& scratch, Fn fn) const
+    {
+      std::vector<std::pair<int, Node_t>>& matches = scratch.matches;
+      std::sort(matches.begin(), matches.end(), [this](const std::pair<int, Node_t>& m1, const std::pair<int, Node_t>& m2) {
+        return m1.first != m2.first ? m1.first < m2.first : m_nodes.getId(m1.second) < m_nodes.getId(m2.second);
+      });
+
+      std::size_t visited = 0;
+      for (auto& match : matches) {
+        if (visited >= limit) {
+          break;
+        }
+        m_nodes.forEachValue(match.second, [&](PayloadView_t value, unsigned int score) {
+          if (visited < limit) {
+            fn(value, match.first, score);
+            visited++;
+          }
+        });
+      }
+
+      if (scratch.stats) {
+        scratch.stats->results = visited;
+      }
+    }
+
+    // fn(PayloadView_t value, int editDistance, unsigned int score) for the results of a query on the keyword of `scratch.codes`
+    template <typename Fn>
+    void visitCodes(QueryKind_t kind, FuzzyEngine_t engine, std::size_t limit, QueryScratch_t& scratch, Fn fn) const
+    {
+      bool wholeWords = kind == kQuerySimilar || kind == kQueryTopSimilar;
+      if (wholeWords && engine == kEngineDeletions) {
+        visitDeletionMatches(limit, scratch, fn);
+      } else if (wholeWords && engine == kEngineAutomaton) {
+        visitAutomatonMatches(limit, scratch, fn);
+      } else {
+        visitResults(kind, walkCodes(scratch, wholeWords), limit, scratch, fn);
+      }
+    }
+
+    /*
+    ** Runs a fuzzy query through the result cache when one is attached : a hit gives the cached values back without walking
+    ** the keyword, a miss runs the query and caches what fn received. Without a cache it is `visitCodes` over the keyword.
+    ** The engine only applies to the whole word queries.
+    */
+    template <typename Fn>
+    void answer(QueryKind_t kind, FuzzyEngine_t engine, const std::string& keyword, std::size_t limit, QueryScratch_t& scratch, Fn fn) const
+    {
+      ResultCache_t* cache = m_cache.get();
+      encodeKeyword(keyword, scratch.codes);
+      if (!cache) {
+        visitCodes(kind, engine, limit, scratch, fn);
+        return;
+      }
+
+      ResultCache_t::makeKey(kind, engine, m_fuzzyLimitThreshold, kind == kQuerySimilar ? SIZE_MAX : limit, scratch.codes, scratch.cacheKey);
+
+      if (cache->find(scratch.cacheKey, m_generation, scratch.cached)) {
+        if (scratch.stats) {
+          scratch.stats->markWalked();
+          scratch.stats->results = scratch.cached.size();
+        }
+        for (const CachedResponse_t& response : scratch.cached) {
+          fn(m_nodes.payload(response.payload), response.editDistance, response.score);
+        }
+        return;
+      }
+
+      scratch.cached.clear();
+      visitCodes(kind, engine, limit, scratch, [&](PayloadView_t value, int editDistance, unsigned int score) {
+        scratch.cached.push_back({ value.id, editDistance, score });
+        fn(value, editDistance, score);
+      });
+      if (!exhausted(scratch)) { // a partial result would be given back as a whole one
+        cache->insert(scratch.cacheKey, m_generation, scratch.cached);
+      }
+    }
+
+    // `answer` under the limits of `options`, returns how the query ended
+    template <typename Fn>
+    QueryStatus_t answerWithin(const QueryOptions_t& options, QueryKind_t kind, FuzzyEngine_t engine, const std::string& keyword, std::size_t limit, QueryScratch_t& scratch, Fn fn) const
+    {
+      QueryBudget_t budget(options);
+      BudgetScope_t scope(scratch.budget, budget);
+      answer(kind, engine, keyword, limit, scratch, fn);
+      return budget.status();
+    }
+
+    // the cached results of this trie are stale from now on
+    void touch()
+    {
+      this->m_generation = nextTrieGeneration();
+    }
+
+    // node reached by the exact keyword, decoding, folding and walking on the same pass
+    Node_t findKeyword(const std::string& keyword, QueryScratch_t& scratch) const
+    {
+      Node_t currentNode = this->m_lambdaNode;
+
+      this->m_tables->characterMap.encode(keyword.data(), keyword.size(), [&](uint32_t code) {
+        if (currentNode != Storage::nullNode()) {
+          currentNode = m_nodes.getChild(currentNode, code);
+        }
+      });
+
+      if (scratch.stats) {
+        scratch.stats->markWalked();
+      }
+      return currentNode;
+    }
+
+    // answers every keyword on the pool, results[i] being the answer of keywords[i]
+    template <typename Result, typename Query>
+    std::vector<Result> runBatch(const std::vector<std::string>& keywords, ThreadPool_t& pool, Query query) const
+    {
+      std::vector<Result> results(keywords.size());
+      pool.parallelFor(keywords.size(), [&](std::size_t i) { results[i] = query(keywords[i]); });
+      return results;
+    }
+
+    /*
+    ** Adds a word to `store`, which is the storage of this trie or a shard being built apart for it. `path` (when given)
+    ** receives the nodes of the word down to the fuzzy threshold, path[d] being the one at depth d.
+    */
+    void insertWord(Storage& store, PayloadView_t str, PayloadView_t content, unsigned int score, std::vector<Node_t>* path = nullptr) const
+    {
+      Node_t currentRoot = store.root();
+      if (path) {
+        path->assign(1, currentRoot);
+      }
+
+      static thread_local std::vector<unsigned int> codes; // the length of the word is needed before the walk
+      codes.clear();
+      this->m_tables->characterMap.encode(str.data, str.size, [&](uint32_t code) { codes.push_back(code); });
+      if (codes.empty()) {
+        return;
+      }
+
+      static thread_local std::vector<Node_t> nodes; // nodes[d] at depth d
+      nodes.assign(1, currentRoot);
+      for (std::size_t depth = 0; depth < codes.size(); depth++) {
+        currentRoot = store.insertNReturnChild(currentRoot, codes[depth]);
+        nodes.push_back(currentRoot);
+        if (path && path->size() <= activeDepth()) {
+          path->push_back(currentRoot);
+        }
+      }
+      store.addValue(currentRoot, content, score);
+
+      // the bounds go up once the path is complete, a radix store keeping those of a whole edge on its last character
+      for (std::size_t depth = 0; depth <= codes.size(); depth++) {
+        store.raiseMaxScore(nodes[depth], score); // every ancestor bounds the score of its subtree
+        store.widenWordDepths(nodes[depth], WordDepths_t::endOfWord(), codes.size() - depth); // and the length of its words
+      }
+    }
+
+    // fn(const std::vector<unsigned int>& codes) for every word of `store`, depth first
+    template <typename Fn>
+    static void forEachWord(const Storage& store, Fn fn)
+    {
+      std::vector<std::pair<Node_t, std::size_t>> pending; // (node, depth)
+      std::vector<unsigned int> codes;
+      pending.emplace_back(store.root(), 0);
+
+      while (!pending.empty()) {
+        Node_t node = pending.back().first;
+        std::size_t depth = pending.back().second;
+        pending.pop_back();
+
+        codes.resize(depth);
+        if (depth) {
+          codes.back() = store.getContent(node);
+        }
+        if (store.isEndOfWord(node)) {
+          fn(codes);
+        }
+        store.forEachChild(node, [&](Node_t child) { pending.emplace_back(child, depth + 1); });
+      }
+    }
+
+    /*
+    ** Moves the words of a shard into this trie : its subtrees are spliced under the lambda node when their first characters
+    ** are new here, otherwise the shard is copied node by node.
+    */
+    void mergeShard(Storage& shard)
+    {
+      touch();
+      if (m_deletions) {
+        forEachWord(shard, [&](const std::vector<unsigned int>& codes) { m_deletions->insert(codes); });
+      }
+      bool disjoint = true;
+      shard.forEachChild(shard.root(), [&](Node_t child) {
+        disjoint = disjoint && m_nodes.getChild(this->m_lambdaNode, shard.getContent(child)) == Storage::nullNode();
+      });
+
+      if (disjoint) {
+        m_nodes.splice(shard);
+        return;
+      }
+
+      std::stack<std::pair<Node_t, Node_t>> pending; // (shard node, node of this trie)
+      std::vector<std::pair<Node_t, Node_t>> copied; // the same, their bounds being raised once every word is in (see `insertWord`)
+      pending.emplace(shard.root(), this->m_lambdaNode);
+
+      while (!pending.empty()) {
+        Node_t shardNode = pending.top().first;
+        Node_t currentNode = pending.top().second;
+        pending.pop();
+
+        copied.emplace_back(shardNode, currentNode);
+        shard.forEachValue(shardNode, [&](PayloadView_t value, unsigned int score) { m_nodes.addValue(currentNode, value, score); });
+        shard.forEachChild(shardNode, [&](Node_t child) { pending.emplace(child, m_nodes.insertNReturnChild(currentNode, shard.getContent(child))); });
+      }
+
+      for (auto& node : copied) {
+        m_nodes.raiseMaxScore(node.second, shard.getMaxScore(node.first));
+        m_nodes.widenWordDepths(node.second, shard.getWordDepths(node.first), 0);
+      }
+      shard = Storage();
+    }
+
+    // nodes from the lambda node to the end of `str` (path[d] at depth d), false when the word has no path on the trie
+    bool findPath(PayloadView_t str, std::vector<Node_t>& path) const
+    {
+      bool found = true;
+      path.assign(1, this->m_lambdaNode);
+
+      this->m_tables->characterMap.encode(str.data, str.size, [&](uint32_t code) {
+        Node_t child = found ? m_nodes.getChild(path.back(), code) : Storage::nullNode();
+        found = child != Storage::nullNode();
+        if (found) {
+          path.push_back(child);
+        }
+      });
+
+      return found && path.size() > 1;
+    }
+
+    // depth of the deepest nodes on the initial active node set
+    std::size_t activeDepth() const
+    {
+      return static_cast<std::size_t>(std::max(m_fuzzyLimitThreshold, 0));
+    }
+
+    // position of the node on the initial active node set (sorted by node), or where it would be inserted
+    std::size_t activePosition(Node_t node) const
+    {
+      return std::lower_bound(m_activeNodeSet.begin(), m_activeNodeSet.end(), ActiveNode_t(node, 0)) - m_activeNodeSet.begin();
+    }
+
+    bool isActive(Node_t node) const
+    {
+      std::size_t position = activePosition(node);
+      return position < m_activeNodeSet.size() && m_activeNodeSet[position].node == node;
+    }
+
+    void deactivate(Node_t node)
+    {
+      std::size_t position = activePosition(node);
+      if (position < m_activeNodeSet.size() && m_activeNodeSet[position].node == node) {
+        m_activeNodeSet.erase(m_activeNodeSet.begin() + position);
+      }
+    }
+
+    // a node of the band (with its children already decided) belongs to the initial active node set
+    bool qualifies(Node_t node, std::size_t depth) const
+    {
+      bool found = !m_onlyFinalWords || m_nodes.isEndOfWord(node);
+      if (!found && depth < activeDepth()) {
+        m_nodes.forEachChild(node, [&](Node_t child) { found = found || isActive(child); });
+      }
+      return found;
+    }
+
+    // adds the nodes of the path (path[d] at depth d) down to the threshold, when its deepest one there qualifies
+    void activatePath(const std::vector<Node_t>& path)
+    {
+      std::size_t deepest = std::min(path.size() - 1, activeDepth());
+      if (m_onlyFinalWords && !m_nodes.isEndOfWord(path[deepest])) {
+        return; // an end of word deeper than the threshold changes nothing, a shallower one is already on the set
+      }
+
+      for (std::size_t depth = 1; depth <= deepest; depth++) {
+        std::size_t position = activePosition(path[depth]);
+        if (position == m_activeNodeSet.size() || m_activeNodeSet[position].node != path[depth]) {
+          m_activeNodeSet.insert(m_activeNodeSet.begin() + position, ActiveNode_t(path[depth], static_cast<int>(depth)));
+        }
+      }
+    }
+
+    // removes the nodes of the path which do not lead to a final word within the threshold anymore (only final words)
+    void deactivatePath(const std::vector<Node_t>& path)
+    {
+      if (!m_onlyFinalWords) {
+        return;
+      }
+
+      for (std::size_t depth = std::min(path.size() - 1, activeDepth()); depth > 0; depth--) {
+        if (qualifies(path[depth], depth)) {
+          return; // so do its ancestors
+        }
+        deactivate(path[depth]);
+      }
+    }
+
+    /*
+    ** Adds the nodes of depth ]from, threshold] to the initial active node set, the shallower ones being already decided.
+    ** Without `m_onlyFinalWords` the walk starts at depth `from`, whose nodes are all on the set; otherwise it starts at the
+    ** lambda node, since a final word of the new band also brings in its ancestors.
+    */
+    void extendActiveBand(std::size_t from)
+    {
+      struct BandNode_t {
+        Node_t node;
+        uint32_t parent; // index on `band`, UINT32_MAX for the starting nodes
+        std::size_t depth;
+        bool marked; // on the set, or to be added to it
+      };
+
+      std::vector<BandNode_t> band;
+      if (m_onlyFinalWords || from == 0) {
+        band.push_back({ this->m_lambdaNode, UINT32_MAX, 0, true });
+      } else {
+        for (const ActiveNode_t& active : m_activeNodeSet) {
+          if (static_cast<std::size_t>(active.editDistance) == from) {
+            band.push_back({ active.node, UINT32_MAX, from, true });
+          }
+        }
+      }
+
+      for (std::size_t head = 0; head < band.size(); head++) {
+        if (band[head].depth < activeDepth()) {
+          m_nodes.forEachChild(band[head].node, [&](Node_t child) { band.push_back({ child, static_cast<uint32_t>(head), band[head].depth + 1, false }); });
+        }
+
+        if (band[head].depth > from && (!m_onlyFinalWords || m_nodes.isEndOfWord(band[head].node))) {
+          for (uint32_t current = static_cast<uint32_t>(head); current != UINT32_MAX && !band[current].marked; current = band[current].parent) {
+            band[current].marked = true;
+          }
+        }
+      }
+
+      ActiveNodeSet_t added;
+      for (const BandNode_t& current : band) {
+        if (current.marked && current.parent != UINT32_MAX && (current.depth > from || !isActive(current.node))) {
+          added.emplace_back(current.node, static_cast<int>(current.depth));
+        }
+      }
+
+      std::sort(added.begin(), added.end());
+      std::size_t middle = m_activeNodeSet.size();
+      m_activeNodeSet.insert(m_activeNodeSet.end(), added.begin(), added.end());
+      std::inplace_merge(m_activeNodeSet.begin(), m_activeNodeSet.begin() + middle, m_activeNodeSet.end());
+    }
+
+    /*
+    ** Drops the nodes deeper than the threshold from the initial active node set; with `m_onlyFinalWords` the nodes kept
+    ** only for a final word of the dropped band go too, deepest first.
+    */
+    void shrinkActiveBand()
+    {
+      auto outside = [&](const ActiveNode_t& active) { return static_cast<std::size_t>(active.editDistance) > activeDepth(); };
+      m_activeNodeSet.erase(std::remove_if(m_activeNodeSet.begin(), m_activeNodeSet.end(), outside), m_activeNodeSet.end());
+
+      for (std::size_t depth = activeDepth(); m_onlyFinalWords && depth > 0; depth--) {
+        std::vector<Node_t> dropped;
+        for (const ActiveNode_t& active : m_activeNodeSet) {
+          if (static_cast<std::size_t>(active.editDistance) == depth && !qualifies(active.node, depth)) {
+            dropped.push_back(active.node);
+          }
+        }
+        for (Node_t node : dropped) {
+          deactivate(node);
+        }
+      }
+    }
+
+    bool hasChildren(Node_t node) const
+    {
+      bool children = false;
+      m_nodes.forEachChild(node, [&](Node_t) { children = true; });
+      return children;
+    }
+
+    /*
+    ** Drops the nodes of the path left without values nor children, from the end of the word up, then lowers the best score
+    ** of the remaining ones to what their subtrees still hold.
+    */
+    void prunePath(std::vector<Node_t>& path)
+    {
+      while (path.size() > 1 && !m_nodes.isEndOfWord(path.back()) && !hasChildren(path.back())) {
+        Node_t leaf = path.back();
+        path.pop_back();
+
+        deactivate(leaf); // its id is about to be given to another node
+        m_nodes.removeChild(path.back(), m_nodes.getContent(leaf));
+      }
+
+      for (std::size_t i = path.size(); i-- > 0;) {
+        unsigned int best = 0;
+        WordDepths_t depths = m_nodes.isEndOfWord(path[i]) ? WordDepths_t::endOfWord() : WordDepths_t();
+        m_nodes.forEachValue(path[i], [&](PayloadView_t, unsigned int score) { best = std::max(best, score); });
+        m_nodes.forEachChild(path[i], [&](Node_t child) {
+          best = std::max(best, m_nodes.getMaxScore(child));
+          depths.widen(m_nodes.getWordDepths(child), 1);
+        });
+        m_nodes.setMaxScore(path[i], best);
+        m_nodes.setWordDepths(path[i], depths);
+      }
+    }
+
+    // adds the word to the deletion index, when there is one
+    void fileWord(const std::string& str)
+    {
+      if (m_deletions) {
+        std::vector<unsigned int> codes;
+        encodeKeyword(str, codes);
+        m_deletions->insert(codes);
+      }
+    }
+
+    void unfileWord(const std::string& str)
+    {
+      if (m_deletions) {
+        std::vector<unsigned int> codes;
+        encodeKeyword(str, codes);
+        m_deletions->remove(codes);
+      }
+    }
+
+    friend class BasicAutocompleteSession_t<Storage>;
+    friend class BasicBulkLoader_t<Storage>;
+    friend class BasicCorrector_t<Storage>;
+
+
+    // finds the active node set of `other` on this trie, which holds the same words, by walking both side by side down to its deepest node
+    template <typename Source>
+    void copyActiveNodes(const BasicTrie_t<Source>& other)
+    {
+      typedef typename BasicTrie_t<Source>::Node_t SourceNode_t;
+      std::unordered_map<SourceNode_t, Node_t> copies; // node of `other` -> the same node here
+      std::vector<std::tuple<SourceNode_t, Node_t, int>> pending; // (node of `other`, node here, depth)
+      int depth = 0;
+
+      for (auto& active : other.m_activeNodeSet) {
+        depth = std::max(depth, active.editDistance);
+      }
 
-      wchar_t chart[keyword.size()];
-      push_string_to_wchar(chart, keyword);
+      if (!other.m_activeNodeSet.empty()) {
+        pending.emplace_back(other.m_lambdaNode, this->m_lambdaNode, 0);
+      }
+      while (!pending.empty()) {
+        SourceNode_t source = std::get<0>(pending.back());
+        Node_t target = std::get<1>(pending.back());
+        int level = std::get<2>(pending.back());
+        pending.pop_back();
+
+        copies.emplace(source, target);
+        if (level < depth) {
+          other.m_nodes.forEachChild(source, [&](SourceNode_t child) {
+            pending.emplace_back(child, m_nodes.getChild(target, other.m_nodes.getContent(child)), level + 1);
+          });
+        }
+      }
 
-      for (unsigned int i = 0; i < wcslen(chart); i++) {
-        lastActiveNodes = buildNewSet(lastActiveNodes, m_characterMap[chart[i]]);
+      m_activeNodeSet.reserve(other.m_activeNodeSet.size());
+      for (auto& active : other.m_activeNodeSet) {
+        m_activeNodeSet.emplace_back(copies.at(active.node), active.editDistance, active.positionDistance);
       }
+      std::sort(m_activeNodeSet.begin(), m_activeNodeSet.end()); // ordered by node, as `buildActiveNodeSet` leaves it
+    }
+
+    /*
+    ** The trie of `other` on other nodes holding the same words (see `freeze`), with its settings, stats collector, result
+    ** cache, deletion index and active node set. The payload ids are the same, so it keeps the generation of its source.
+    */
+    template <typename Source>
+    BasicTrie_t(const BasicTrie_t<Source>& other, Storage&& nodes)
+    : m_nodes(std::move(nodes))
+    , m_lambdaNode(m_nodes.root())
+    , m_tables(other.m_tables)
+    , m_onlyFinalWords(other.m_onlyFinalWords)
+    , m_searchLimitThreshold(other.m_searchLimitThreshold)
+    , m_fuzzyLimitThreshold(other.m_fuzzyLimitThreshold)
+    , m_distancePenalty(other.m_distancePenalty)
+    , m_stats(other.m_stats)
+    , m_cache(other.m_cache)
+    , m_deletions(other.m_deletions ? new DeletionIndex_t(*other.m_deletions) : nullptr)
+    , m_generation(other.m_generation)
+    {
+      copyActiveNodes(other);
+    }
+  public:
+    /*
+    ** `score` ranks the value on `autocompleteRanked` (popularity, frequency...). The nodes of the word down to the fuzzy
+    ** threshold join the initial active node set, so it never has to be rebuilt after an insertion.
+    */
+    void putIndividualWord(const std::string& str, const std::string& content, unsigned int score = 0)
+    {
+      insertWord(m_nodes, PayloadView_t(str), PayloadView_t(content), score, &m_editPath);
+      activatePath(m_editPath);
+      fileWord(str);
+      touch();
+    }
+
+    /*
+    ** The edits below keep the initial active node set and the deletion index up to date too. They give the nodes of removed words to later
+    ** insertions and drop the bytes of the values left unused, so they invalidate the views, the sessions and the results taken before.
+    */
 
-      for (auto node : lastActiveNodes) {
-        activeList.push(node);
+    // removes the word with every value it holds, false when it is not on the trie
+    bool removeWord(const std::string& str)
+    {
+      std::vector<Node_t> path;
+      if (!findPath(PayloadView_t(str), path) || !m_nodes.isEndOfWord(path.back())) {
+        return false;
       }
 
-      std::unordered_set<TrieNode_t*> visitedNode;
+      m_nodes.clearValues(path.back());
+      prunePath(path);
+      deactivatePath(path);
+      unfileWord(str);
+      touch();
+      return true;
+    }
+
+    // removes a single value of the word, false when the word does not hold it
+    bool removeValue(const std::string& str, const std::string& content)
+    {
+      std::vector<Node_t> path;
+      if (!findPath(PayloadView_t(str), path) || !m_nodes.removeValue(path.back(), PayloadView_t(content))) {
+        return false;
+      }
 
-      while (!activeList.empty()) {
+      bool emptied = !m_nodes.isEndOfWord(path.back());
+      prunePath(path);
+      deactivatePath(path);
+      if (emptied) {
+        unfileWord(str);
+      }
+      touch();
+      return true;
+    }
 
-        auto aNode = activeList.top();
-        activeList.pop();
+    // the word is left with `content` as its only value, being inserted when it is not on the trie
+    void updateWord(const std::string& str, const std::string& content, unsigned int score = 0)
+    {
+      std::vector<Node_t> path;
+      if (!findPath(PayloadView_t(str), path)) {
+        putIndividualWord(str, content, score);
+        return;
+      }
 
-        if (visitedNode.find(aNode.node) == visitedNode.end()) {
-          std::queue<TrieNode_t*> pQueue;
-          pQueue.push(aNode.node);
+      m_nodes.clearValues(path.back());
+      m_nodes.addValue(path.back(), PayloadView_t(content), score);
+      prunePath(path); // nothing is pruned, only the best scores are recomputed
+      activatePath(path);
+      fileWord(str);
+      touch();
+    }
 
-          while (!pQueue.empty()) {
-            auto currentSeeker = pQueue.front();
-            visitedNode.insert(currentSeeker);
-            pQueue.pop();
+    /*
+    ** Recomputes the initial active node set : every node down to the fuzzy threshold, or only the final words there and
+    ** their ancestors. The insertions, the removals and `setFuzzyLimitThreshold` keep it up to date afterwards, so this is
+    ** only needed to switch `_onlyFinalWords` or after building a trie without the set (`BasicBulkLoader_t`).
+    */
+    void buildActiveNodeSet(bool _onlyFinalWords)
+    {
+      this->m_onlyFinalWords = _onlyFinalWords;
+      m_activeNodeSet.assign(1, ActiveNode_t(this->m_lambdaNode, 0));
+      extendActiveBand(0);
+      touch();
+    }
 
-            if (currentSeeker->isEndOfWord()) {
-              for (auto oValue : *currentSeeker->getValues()) {
-                ocurrencesQueue.emplace(oValue, aNode.editDistance);
-              }
-            }
+    // the tables are immutable : the loaders below give this trie a changed copy, the tries sharing the former tables keep them
+    void encodeCharacters(const std::string& filename)
+    {
+      std::shared_ptr<TextTables_t> tables = std::make_shared<TextTables_t>(*m_tables);
+      tables->encodeCharacters(filename);
+      this->m_tables = tables;
+    }
 
-            for (TrieNode_t* curChild : currentSeeker->getChildren()) {
-              if (visitedNode.find(curChild) == visitedNode.end()) {
-                pQueue.emplace(curChild);
-              }
-            }
+    void addStopWords(const std::string& filename)
+    {
+      std::shared_ptr<TextTables_t> tables = std::make_shared<TextTables_t>(*m_tables);
+      tables->addStopWords(filename);
+      this->m_tables = tables;
+    }
+
+    bool isStopWord(std::string str) const
+    {
+      return m_tables->isStopWord(std::move(str));
+    }
+
+    std::shared_ptr<const TextTables_t> textTables() const
+    {
+      return this->m_tables;
+    }
+
+    // Trie_t public methods
+
+    // loads the stopwords of "./stopwords" and the charmap of "charmap.cm"
+    BasicTrie_t()
+    : BasicTrie_t(TextTables_t::load("charmap.cm", "./stopwords"))
+    {
+    }
+
+    // an empty trie on the given charmap and stopwords, which several tries can share
+    explicit BasicTrie_t(std::shared_ptr<const TextTables_t> tables)
+    : m_lambdaNode(m_nodes.root())
+    , m_tables(tables)
+    , m_onlyFinalWords(false)
+    , m_searchLimitThreshold(5)
+    , m_fuzzyLimitThreshold(1)
+    , m_distancePenalty(int64_t(1) << 32)
+    , m_generation(nextTrieGeneration())
+    {
+      if (!tables) {
+        throw std::logic_error("a trie needs a charmap and stopword tables");
+      }
+      m_activeNodeSet.emplace_back(this->m_lambdaNode, 0);
+    }
+
+    /*
+    ** Deep copy with the same node and payload ids, settings, stats collector, result cache, deletion index and active node set (found again
+    ** on the copy by walking both tries side by side down to its deepest node). The copy answers the same, so it keeps the
+    ** generation of its source and their unchanged states share the cached results.
+    */
+    BasicTrie_t(const BasicTrie_t& other)
+    : m_nodes(other.m_nodes)
+    , m_lambdaNode(m_nodes.root())
+    , m_tables(other.m_tables)
+    , m_onlyFinalWords(other.m_onlyFinalWords)
+    , m_searchLimitThreshold(other.m_searchLimitThreshold)
+    , m_fuzzyLimitThreshold(other.m_fuzzyLimitThreshold)
+    , m_distancePenalty(other.m_distancePenalty)
+    , m_stats(other.m_stats)
+    , m_cache(other.m_cache)
+    , m_deletions(other.m_deletions ? new DeletionIndex_t(*other.m_deletions) : nullptr)
+    , m_generation(other.m_generation)
+    {
+      copyActiveNodes(other);
+    }
+
+    /*
+    ** Opens a trie saved by `save`, the nodes and values are answered straight from the mapped file,
+    ** only the character map, the stopwords and the active node set are loaded on memory.
+    */
+    explicit BasicTrie_t(std::shared_ptr<const IndexFile_t> index)
+    : m_nodes(index)
+    , m_lambdaNode(m_nodes.root())
+    , m_onlyFinalWords(index->header().flags & kIndexOnlyFinalWords)
+    , m_searchLimitThreshold(index->header().searchLimitThreshold)
+    , m_fuzzyLimitThreshold(index->header().fuzzyLimitThreshold)
+    , m_distancePenalty(int64_t(1) << 32)
+    , m_generation(nextTrieGeneration())
+    {
+      std::shared_ptr<TextTables_t> tables = std::make_shared<TextTables_t>();
+      const IndexCharacter_t* characters = index->section<IndexCharacter_t>(kSectionCharmap);
+      for (std::size_t i = 0; i < index->sectionCount<IndexCharacter_t>(kSectionCharmap); i++) {
+        tables->characterMap.define(characters[i].character, characters[i].code);
+      }
+
+      characters = index->section<IndexCharacter_t>(kSectionReverseCharmap);
+      for (std::size_t i = 0; i < index->sectionCount<IndexCharacter_t>(kSectionReverseCharmap); i++) {
+        tables->reverseCharacterMap.emplace(characters[i].code, static_cast<char>(characters[i].character));
+      }
+
+      std::istringstream stopwords(std::string(index->section<char>(kSectionStopwords), index->header().sections[kSectionStopwords].size));
+      std::string currentLine;
+      while (std::getline(stopwords, currentLine)) {
+        tables->stopWords.insert(currentLine);
+      }
+      m_tables = tables;
+
+      const IndexActiveNode_t* activeNodes = index->section<IndexActiveNode_t>(kSectionActiveNodes);
+      for (std::size_t i = 0; i < index->sectionCount<IndexActiveNode_t>(kSectionActiveNodes); i++) {
+        m_activeNodeSet.emplace_back(activeNodes[i].node, activeNodes[i].editDistance);
+      }
+      std::sort(m_activeNodeSet.begin(), m_activeNodeSet.end()); // the ids of the file are not in the order of the saved nodes
+    }
+
+    /*
+    ** Writes the whole structure (nodes in breadth-first order, values, charmap, stopwords and the current active node set)
+    ** to an index file which can be mapped back by `MappedTrie_t`.
+    */
+    void save(const std::string& filename) const
+    {
+      IndexWriter_t writer(m_searchLimitThreshold, m_fuzzyLimitThreshold, m_onlyFinalWords ? kIndexOnlyFinalWords : 0);
+      std::vector<Node_t> order; // order[id] is the node which will get the id
+      std::unordered_map<Node_t, uint32_t> ids;
+
+      order.reserve(m_nodes.nodeCount());
+      order.push_back(this->m_lambdaNode);
+      ids.emplace(this->m_lambdaNode, 0);
+
+      for (std::size_t id = 0; id < m_nodes.payloadCount(); id++) {
+        writer.addPayload(m_nodes.payload(static_cast<uint32_t>(id)));
+      }
+
+      for (std::size_t id = 0; id < order.size(); id++) {
+        Node_t currentNode = order[id];
+        ArenaNode_t record(m_nodes.getContent(currentNode));
+        record.maxScore = m_nodes.getMaxScore(currentNode);
+        record.wordDepths = m_nodes.getWordDepths(currentNode);
+        record.firstEdge = static_cast<uint32_t>(writer.edges.size());
+
+        m_nodes.forEachChild(currentNode, [&](Node_t child) {
+          ArenaEdge_t edge;
+          edge.code = m_nodes.getContent(child);
+          edge.node = static_cast<uint32_t>(order.size());
+          writer.edges.push_back(edge);
+          ids.emplace(child, edge.node);
+          order.push_back(child);
+          record.edgeCount++;
+        });
+        record.edgeCapacity = record.edgeCount;
+
+        if (m_nodes.isEndOfWord(currentNode)) {
+          IndexValueSlot_t slot;
+          slot.firstRef = static_cast<uint32_t>(writer.valueRefs.size());
+          m_nodes.forEachValue(currentNode, [&](PayloadView_t value, unsigned int score) { writer.addValue(value.id, score); });
+          slot.count = static_cast<uint32_t>(writer.valueRefs.size()) - slot.firstRef;
+          record.valueSlot = static_cast<uint32_t>(writer.valueSlots.size());
+          writer.valueSlots.push_back(slot);
+        }
+
+        writer.nodes.push_back(record);
+      }
+
+      m_tables->characterMap.forEachDefined([&](uint32_t character, uint32_t code) { writer.charmap.push_back({ character, code }); });
+      for (auto& character : m_tables->reverseCharacterMap) {
+        writer.reverseCharmap.push_back({ static_cast<unsigned char>(character.second), character.first });
+      }
+      for (auto& stopword : m_tables->stopWords) {
+        writer.stopwords += stopword + '\n';
+      }
+      for (auto& activeNode : m_activeNodeSet) {
+        writer.activeNodes.push_back({ ids[activeNode.node], activeNode.editDistance });
+      }
+
+      writer.write(filename);
+    }
+
+    /*
+    ** Compiles the trie into a read-only one whose nodes are the minimized automaton of its words (`DawgNodeStore_t`) : the
+    ** common suffixes are stored once and the values move to a table indexed by word id. It answers every query the same,
+    ** with the same settings, cache and active node set; later changes of this trie do not reach it.
+    */
+    BasicTrie_t<DawgNodeStore_t> freeze() const
+    {
+      return BasicTrie_t<DawgNodeStore_t>(*this, DawgNodeStore_t(m_nodes));
+    }
+
+    void printTrie() const
+    {
+      Node_t currentNode;
+      std::set<Node_t> visited;
+
+      std::stack<Node_t> nodeStack;
+      nodeStack.push(this->m_lambdaNode);
+
+      while (!nodeStack.empty()) {
+        currentNode = nodeStack.top();
+
+        if (visited.find(currentNode) == visited.end()) {
+          visited.insert(currentNode);
+          auto character = this->m_tables->reverseCharacterMap.find(m_nodes.getContent(currentNode));
+          std::cout << "[" << (character != this->m_tables->reverseCharacterMap.end() ? character->second : '#') << (m_nodes.isEndOfWord(currentNode) ? "'" : " ");
+          std::vector<Node_t> children;
+          m_nodes.forEachChild(currentNode, [&](Node_t child) { children.push_back(child); });
+
+          while (!children.empty()) {
+            nodeStack.push(children.back());
+            children.pop_back();
           }
+
+        } else {
+          nodeStack.pop();
+          std::cout << "]";
+        }
+      }
+    }
+
+    /*
+    ** The query methods are const and keep their working memory on a per-thread scratch, so a trie can be shared by any
+    ** amount of threads as long as nobody modifies it meanwhile. The charmap already folds the case of the keywords.
+    */
+    std::pair<bool, std::vector<std::string>> searchKeyword(const std::string& keyword) const
+    {
+      QueryScratch_t& scratch = threadScratch();
+      QueryProbe_t probe(m_stats.get(), scratch.stats, scratch.record, kQueryExact, keyword);
+      Node_t currentNode = findKeyword(keyword, scratch);
+
+      if (currentNode != Storage::nullNode()) {
+        if (m_nodes.isEndOfWord(currentNode)) {
+          std::vector<std::string> values;
+          m_nodes.forEachValue(currentNode, [&](PayloadView_t value, unsigned int) { values.push_back(value.str()); });
+          if (scratch.stats) {
+            scratch.stats->results = values.size();
+          }
+          return { true, values };
         }
       }
 
+      return { false, this->m_emptyResponse };
+    }
+
+    /*
+    ** View forms of the queries : the results are written over `responses` (cleared first) as views on the interned payloads,
+    ** so a caller reusing the same vector gets its answers without a single allocation. The views are valid while the trie is
+    ** not modified, and `payload(value.id)` gives the same bytes back.
+    */
+    bool searchKeyword(const std::string& keyword, std::vector<PayloadView_t>& values) const
+    {
+      QueryScratch_t& scratch = threadScratch();
+      QueryProbe_t probe(m_stats.get(), scratch.stats, scratch.record, kQueryExact, keyword);
+      Node_t currentNode = findKeyword(keyword, scratch);
+
+      values.clear();
+      if (currentNode != Storage::nullNode()) {
+        m_nodes.forEachValue(currentNode, [&](PayloadView_t value, unsigned int) { values.push_back(value); });
+      }
+      if (scratch.stats) {
+        scratch.stats->results = values.size();
+      }
+      return !values.empty();
+    }
+
+    void searchSimilarKeywordTopK(const std::string& keyword, std::size_t limit, std::vector<TrieResponseView_t>& responses, FuzzyEngine_t engine = kEngineActiveNodes) const
+    {
+      QueryScratch_t& scratch = threadScratch();
+      QueryProbe_t probe(m_stats.get(), scratch.stats, scratch.record, kQueryTopSimilar, keyword);
+      responses.clear();
+      answer(kQueryTopSimilar, engine, keyword, limit, scratch, [&](PayloadView_t value, int editDistance, unsigned int score) { responses.emplace_back(value, editDistance, score); });
+    }
+
+    void autocompleteTopK(const std::string& keyword, std::size_t limit, std::vector<TrieResponseView_t>& responses) const
+    {
+      QueryScratch_t& scratch = threadScratch();
+      QueryProbe_t probe(m_stats.get(), scratch.stats, scratch.record, kQueryCompletions, keyword);
+      responses.clear();
+      answer(kQueryCompletions, kEngineActiveNodes, keyword, limit, scratch, [&](PayloadView_t value, int editDistance, unsigned int score) { responses.emplace_back(value, editDistance, score); });
+    }
+
+    void autocompleteRanked(const std::string& keyword, std::size_t limit, std::vector<TrieResponseView_t>& responses) const
+    {
+      QueryScratch_t& scratch = threadScratch();
+      QueryProbe_t probe(m_stats.get(), scratch.stats, scratch.record, kQueryRanked, keyword);
+      responses.clear();
+      answer(kQueryRanked, kEngineActiveNodes, keyword, limit, scratch, [&](PayloadView_t value, int editDistance, unsigned int score) { responses.emplace_back(value, editDistance, score); });
+    }
+
+    /*
+    ** Budgeted forms of the queries : the walk of the keyword and the collection of the results check `options` every few
+    ** nodes (deadline, node budget, cancellation) and stop once it runs out, giving back the results found so far with the
+    ** reason. Those are true matches at their exact distance and come in the usual order, closest (or best ranked) first for
+    ** the active node sets; a query stopped before the end of its keyword has none. A limit of SIZE_MAX asks for every
+    ** result, as `searchSimilarKeyword` and `autocomplete` do. The partial results are never cached.
+    */
+    QueryStatus_t searchSimilarKeywordTopK(const std::string& keyword, std::size_t limit, std::vector<TrieResponseView_t>& responses, const QueryOptions_t& options, FuzzyEngine_t engine = kEngineActiveNodes) const
+    {
+      QueryScratch_t& scratch = threadScratch();
+      QueryProbe_t probe(m_stats.get(), scratch.stats, scratch.record, kQueryTopSimilar, keyword);
+      responses.clear();
+      return answerWithin(options, kQueryTopSimilar, engine, keyword, limit, scratch, [&](PayloadView_t value, int editDistance, unsigned int score) { responses.emplace_back(value, editDistance, score); });
+    }
+
+    QueryStatus_t autocompleteTopK(const std::string& keyword, std::size_t limit, std::vector<TrieResponseView_t>& responses, const QueryOptions_t& options) const
+    {
+      QueryScratch_t& scratch = threadScratch();
+      QueryProbe_t probe(m_stats.get(), scratch.stats, scratch.record, kQueryCompletions, keyword);
+      responses.clear();
+      return answerWithin(options, kQueryCompletions, kEngineActiveNodes, keyword, limit, scratch, [&](PayloadView_t value, int editDistance, unsigned int score) { responses.emplace_back(value, editDistance, score); });
+    }
+
+    QueryStatus_t autocompleteRanked(const std::string& keyword, std::size_t limit, std::vector<TrieResponseView_t>& responses, const QueryOptions_t& options) const
+    {
+      QueryScratch_t& scratch = threadScratch();
+      QueryProbe_t probe(m_stats.get(), scratch.stats, scratch.record, kQueryRanked, keyword);
+      responses.clear();
+      return answerWithin(options, kQueryRanked, kEngineActiveNodes, keyword, limit, scratch, [&](PayloadView_t value, int editDistance, unsigned int score) { responses.emplace_back(value, editDistance, score); });
+    }
+
+    QueryResult_t searchSimilarKeywordTopK(const std::string& keyword, std::size_t limit, const QueryOptions_t& options, FuzzyEngine_t engine = kEngineActiveNodes) const
+    {
+      QueryScratch_t& scratch = threadScratch();
+      QueryProbe_t probe(m_stats.get(), scratch.stats, scratch.record, kQueryTopSimilar, keyword);
+      QueryResult_t result;
+      result.status = answerWithin(options, kQueryTopSimilar, engine, keyword, limit, scratch, [&](PayloadView_t value, int editDistance, unsigned int score) { result.responses.emplace_back(value.str(), editDistance, score); });
+      return result;
+    }
+
+    QueryResult_t autocompleteTopK(const std::string& keyword, std::size_t limit, const QueryOptions_t& options) const
+    {
+      QueryScratch_t& scratch = threadScratch();
+      QueryProbe_t probe(m_stats.get(), scratch.stats, scratch.record, kQueryCompletions, keyword);
+      QueryResult_t result;
+      result.status = answerWithin(options, kQueryCompletions, kEngineActiveNodes, keyword, limit, scratch, [&](PayloadView_t value, int editDistance, unsigned int score) { result.responses.emplace_back(value.str(), editDistance, score); });
+      return result;
+    }
+
+    QueryResult_t autocompleteRanked(const std::string& keyword, std::size_t limit, const QueryOptions_t& options) const
+    {
+      QueryScratch_t& scratch = threadScratch();
+      QueryProbe_t probe(m_stats.get(), scratch.stats, scratch.record, kQueryRanked, keyword);
+      QueryResult_t result;
+      result.status = answerWithin(options, kQueryRanked, kEngineActiveNodes, keyword, limit, scratch, [&](PayloadView_t value, int editDistance, unsigned int score) { result.responses.emplace_back(value.str(), editDistance, score); });
+      return result;
+    }
+
+    // the interned payload with this id, ids being dense on [0, payloadCount())
+    PayloadView_t payload(uint32_t id) const
+    {
+      return m_nodes.payload(id);
+    }
+
+    std::size_t payloadCount() const
+    {
+      return m_nodes.payloadCount();
+    }
+
+    /*
+    ** The whole word queries are answered by the active node sets of the trie unless `engine` asks for the deletion index
+    ** (built first by `buildDeletionIndex`) or the automaton. The engines find the same words at the same distances, unless
+    ** the initial active node set only holds the final words (see `buildActiveNodeSet`) : the deletion index and the
+    ** automaton always find every word in the threshold.
+    */
+    std::priority_queue<TrieResponse_t, std::vector<TrieResponse_t>, TrieResponseComparator_t> searchSimilarKeyword(const std::string& keyword, FuzzyEngine_t engine = kEngineActiveNodes) const
+    {
+      QueryScratch_t& scratch = threadScratch();
+      QueryProbe_t probe(m_stats.get(), scratch.stats, scratch.record, kQuerySimilar, keyword);
+      std::priority_queue<TrieResponse_t, std::vector<TrieResponse_t>, TrieResponseComparator_t> ocurrencesQueue;
+      answer(kQuerySimilar, engine, keyword, SIZE_MAX, scratch, [&](PayloadView_t value, int editDistance, unsigned int score) { ocurrencesQueue.emplace(value.str(), editDistance, score); });
+      return ocurrencesQueue;
+    }
+
+    std::priority_queue<TrieResponse_t, std::vector<TrieResponse_t>, TrieResponseComparator_t> autocomplete(const std::string& keyword) const
+    {
+      QueryScratch_t& scratch = threadScratch();
+      QueryProbe_t probe(m_stats.get(), scratch.stats, scratch.record, kQueryCompletions, keyword);
+      std::priority_queue<TrieResponse_t, std::vector<TrieResponse_t>, TrieResponseComparator_t> ocurrencesQueue;
+      answer(kQueryCompletions, kEngineActiveNodes, keyword, SIZE_MAX, scratch, [&](PayloadView_t value, int editDistance, unsigned int score) { ocurrencesQueue.emplace(value.str(), editDistance, score); });
       return ocurrencesQueue;
     }
 
+    // at most `limit` similar words, closest first (the search limit threshold when not given)
+    std::vector<TrieResponse_t> searchSimilarKeywordTopK(const std::string& keyword, std::size_t limit, FuzzyEngine_t engine = kEngineActiveNodes) const
+    {
+      QueryScratch_t& scratch = threadScratch();
+      QueryProbe_t probe(m_stats.get(), scratch.stats, scratch.record, kQueryTopSimilar, keyword);
+      std::vector<TrieResponse_t> responses;
+      answer(kQueryTopSimilar, engine, keyword, limit, scratch, [&](PayloadView_t value, int editDistance, unsigned int score) { responses.emplace_back(value.str(), editDistance, score); });
+      return responses;
+    }
+
+    /*
+    ** Similar words within `maxDistance` edits whatever the fuzzy threshold, from a single automaton walk : responses[d] holds
+    ** the values exactly d edits away, so responses[0..t] answers every threshold t up to `maxDistance`.
+    */
+    std::vector<std::vector<TrieResponse_t>> searchSimilarKeywordByDistance(const std::string& keyword, int maxDistance) const
+    {
+      QueryScratch_t& scratch = threadScratch();
+      QueryProbe_t probe(m_stats.get(), scratch.stats, scratch.record, kQuerySimilar, keyword);
+      std::vector<std::vector<TrieResponse_t>> responses(static_cast<std::size_t>(std::max(maxDistance + 1, 0)));
+
+      encodeKeyword(keyword, scratch.codes);
+      walkAutomaton(maxDistance, scratch);
+      if (scratch.stats) {
+        scratch.stats->markWalked();
+      }
+      visitMatches(SIZE_MAX, scratch, [&](PayloadView_t value, int editDistance, unsigned int score) { responses[editDistance].emplace_back(value.str(), editDistance, score); });
+      return responses;
+    }
+
+    std::vector<TrieResponse_t> searchSimilarKeywordTopK(const std::string& keyword) const
+    {
+      return searchSimilarKeywordTopK(keyword, static_cast<std::size_t>(std::max(m_searchLimitThreshold, 0)));
+    }
+
+    // at most `limit` completions, closest first, without walking the whole subtree of a short prefix
+    std::vector<TrieResponse_t> autocompleteTopK(const std::string& keyword, std::size_t limit) const
+    {
+      QueryScratch_t& scratch = threadScratch();
+      QueryProbe_t probe(m_stats.get(), scratch.stats, scratch.record, kQueryCompletions, keyword);
+      std::vector<TrieResponse_t> responses;
+      answer(kQueryCompletions, kEngineActiveNodes, keyword, limit, scratch, [&](PayloadView_t value, int editDistance, unsigned int score) { responses.emplace_back(value.str(), editDistance, score); });
+      return responses;
+    }
+
+    std::vector<TrieResponse_t> autocompleteTopK(const std::string& keyword) const
+    {
+      return autocompleteTopK(keyword, static_cast<std::size_t>(std::max(m_searchLimitThreshold, 0)));
+    }
+
+    // at most `limit` completions ordered by score and edit distance (see `setDistancePenalty`)
+    std::vector<TrieResponse_t> autocompleteRanked(const std::string& keyword, std::size_t limit) const
+    {
+      QueryScratch_t& scratch = threadScratch();
+      QueryProbe_t probe(m_stats.get(), scratch.stats, scratch.record, kQueryRanked, keyword);
+      std::vector<TrieResponse_t> responses;
+      answer(kQueryRanked, kEngineActiveNodes, keyword, limit, scratch, [&](PayloadView_t value, int editDistance, unsigned int score) { responses.emplace_back(value.str(), editDistance, score); });
+      return responses;
+    }
+
+    std::vector<TrieResponse_t> autocompleteRanked(const std::string& keyword) const
+    {
+      return autocompleteRanked(keyword, static_cast<std::size_t>(std::max(m_searchLimitThreshold, 0)));
+    }
+
+    /*
+    ** Allocation-free forms of `searchSimilarKeyword` and `autocompleteTopK` : fn(PayloadView_t value, int editDistance, unsigned int score)
+    ** is called for each result, the views being valid while the trie is not modified. fn runs on the scratch of the query,
+    ** so it must not start another query on the same thread.
+    */
+    template <typename Fn>
+    void forEachSimilarKeyword(const std::string& keyword, Fn fn, FuzzyEngine_t engine = kEngineActiveNodes) const
+    {
+      QueryScratch_t& scratch = threadScratch();
+      QueryProbe_t probe(m_stats.get(), scratch.stats, scratch.record, kQuerySimilar, keyword);
+      answer(kQuerySimilar, engine, keyword, SIZE_MAX, scratch, fn);
+    }
+
+    template <typename Fn>
+    void forEachCompletion(const std::string& keyword, std::size_t limit, Fn fn) const
+    {
+      QueryScratch_t& scratch = threadScratch();
+      QueryProbe_t probe(m_stats.get(), scratch.stats, scratch.record, kQueryCompletions, keyword);
+      answer(kQueryCompletions, kEngineActiveNodes, keyword, limit, scratch, fn);
+    }
+
+    /*
+    ** Batch forms of the queries : the keywords are spread over the pool and results[i] answers keywords[i].
+    ** `searchSimilarKeywordTopKBatch` with SIZE_MAX gives every similar word, as `searchSimilarKeyword` does.
+    */
+    std::vector<std::pair<bool, std::vector<std::string>>> searchKeywordBatch(const std::vector<std::string>& keywords, ThreadPool_t& pool) const
+    {
+      return runBatch<std::pair<bool, std::vector<std::string>>>(keywords, pool, [this](const std::string& keyword) { return searchKeyword(keyword); });
+    }
+
+    std::vector<std::vector<TrieResponse_t>> searchSimilarKeywordTopKBatch(const std::vector<std::string>& keywords, std::size_t limit, ThreadPool_t& pool, FuzzyEngine_t engine = kEngineActiveNodes) const
+    {
+      return runBatch<std::vector<TrieResponse_t>>(keywords, pool, [this, limit, engine](const std::string& keyword) { return searchSimilarKeywordTopK(keyword, limit, engine); });
+    }
+
+    std::vector<std::vector<TrieResponse_t>> autocompleteTopKBatch(const std::vector<std::string>& keywords, std::size_t limit, ThreadPool_t& pool) const
+    {
+      return runBatch<std::vector<TrieResponse_t>>(keywords, pool, [this, limit](const std::string& keyword) { return autocompleteTopK(keyword, limit); });
+    }
+
+    std::vector<std::vector<TrieResponse_t>> autocompleteRankedBatch(const std::vector<std::string>& keywords, std::size_t limit, ThreadPool_t& pool) const
+    {
+      return runBatch<std::vector<TrieResponse_t>>(keywords, pool, [this, limit](const std::string& keyword) { return autocompleteRanked(keyword, limit); });
+    }
+
+    /*
+    ** Score lost by a ranked completion per edit. The default (2^32) is above any score, so the results are ordered by distance and then
+    ** by score; with a lower penalty a popular word can outrank a closer one.
+    */
+    void setDistancePenalty(int64_t penalty)
+    {
+      this->m_distancePenalty = penalty;
+      touch();
+    }
+
+    int64_t distancePenalty() const
+    {
+      return this->m_distancePenalty;
+    }
+
     void setSearchLimitThreshold(int limit)
     {
       this->m_searchLimitThreshold = limit;
     }
 
+    int searchLimitThreshold() const
+    {
+      return this->m_searchLimitThreshold;
+    }
+
+    int fuzzyLimitThreshold() const
+    {
+      return this->m_fuzzyLimitThreshold;
+    }
+
+    // the initial active node set gains or loses the depth band between the previous threshold and this one
     void setFuzzyLimitThreshold(int limit)
     {
+      std::size_t previous = activeDepth();
       this->m_fuzzyLimitThreshold = limit;
+
+      if (activeDepth() > previous) {
+        extendActiveBand(previous);
+      } else if (activeDepth() < previous) {
+        shrinkActiveBand();
+      }
+      touch();
+    }
+
+    /*
+    ** Every query answered from now on records what it did (see `QueryStats_t`) on the collector, which can be shared by
+    ** several tries. A null collector turns the recording off, leaving a single test per character on the engine.
+    */
+    void setStatsCollector(std::shared_ptr<StatsCollector_t> stats)
+    {
+      this->m_stats = stats;
+    }
+
+    std::shared_ptr<StatsCollector_t> statsCollector() const
+    {
+      return this->m_stats;
+    }
+
+    /*
+    ** The fuzzy queries (similar words and completions, owning, view and callback forms) are answered from the cache when it
+    ** holds the same query (kind, threshold, limit and folded keyword) for the current state of the trie; every modification
+    ** leaves the earlier results behind. A cache can be shared by several tries, or by the copies of a `BasicVersionedTrie_t`.
+    ** A null cache turns it off.
+    */
+    void setResultCache(std::shared_ptr<ResultCache_t> cache)
+    {
+      this->m_cache = cache;
+    }
+
+    std::shared_ptr<ResultCache_t> resultCache() const
+    {
+      return this->m_cache;
+    }
+
+    /*
+    ** Files every word of the trie on a deletion index covering up to `maxDistance` edits (see `DeletionIndex_t`), which the
+    ** edits and `BasicBulkLoader_t` keep up to date afterwards. The whole word queries use it when they ask for
+    ** kEngineDeletions, with a fuzzy threshold up to `maxDistance`. A negative distance drops the index.
+    */
+    void buildDeletionIndex(int maxDistance)
+    {
+      if (maxDistance < 0) {
+        this->m_deletions.reset();
+        return;
+      }
+
+      std::unique_ptr<DeletionIndex_t> index(new DeletionIndex_t(maxDistance));
+      forEachWord(m_nodes, [&](const std::vector<unsigned int>& codes) { index->insert(codes); });
+      this->m_deletions = std::move(index);
+    }
+
+    // distance covered by the deletion index, -1 without one
+    int deletionIndexDistance() const
+    {
+      return m_deletions ? m_deletions->maxDistance() : -1;
+    }
+
+    /*
+    ** Builds a table of ready-made active node sets (see `BasicPrefixTable_t`) for every prefix of one and two characters,
+    ** where the sets grown from the initial one are the largest, then for the `frequentPrefixes` longer prefixes seen most
+    ** often on `queryLog` (a past query per entry). The fuzzy queries then replay only the characters after the deepest
+    ** prefix of their keyword found there. The sets are taken in that order until `maxBytes` is spent, 0 dropping the table;
+    ** returns the amount of prefixes it holds, its memory being part of the `indexBytes` of `memoryUsage`.
+    ** The sets hold every node of the prefix, so the whole word queries starting from one skip the pruning of its first
+    ** characters (see `buildNewSet`) : they find the same words at the same distances, the ties of a bounded query may differ.
+    ** The table answers for the trie it was built on : any modification (or threshold change) leaves it unused until it is
+    ** built again, and the copies of the trie do not take it.
+    */
+    std::size_t buildPrefixTable(std::size_t maxBytes, const std::vector<std::string>& queryLog = std::vector<std::string>(), std::size_t frequentPrefixes = 0)
+    {
+      this->m_prefixes.reset();
+      if (maxBytes == 0) {
+        return 0;
+      }
+
+      // the prefixes are walked as queries (`buildNewSet` keeps a single caller), each one from the deepest filed before it
+      this->m_prefixes.reset(new PrefixTable_t(maxBytes, m_generation));
+      QueryScratch_t& scratch = threadScratch();
+      auto file = [&](const std::vector<unsigned int>& prefix) {
+        scratch.codes = prefix;
+        return this->m_prefixes->add(prefix.data(), prefix.size(), walkCodes(scratch, false));
+      };
+
+      std::set<unsigned int> alphabet;
+      m_tables->characterMap.forEachDefined([&](uint32_t, uint32_t code) { alphabet.insert(code); });
+
+      for (unsigned int first : alphabet) {
+        file({ first });
+      }
+      for (unsigned int first : alphabet) {
+        for (unsigned int second : alphabet) {
+          if (!this->m_prefixes->fits(0)) {
+            break;
+          }
+          file({ first, second });
+        }
+      }
+
+      // the longer prefixes of the log by count, the most frequent first (then in code order, so the table is reproducible)
+      std::map<std::vector<unsigned int>, std::size_t> counts;
+      std::vector<unsigned int> codes;
+      for (const std::string& query : queryLog) {
+        encodeKeyword(query, codes);
+        for (std::size_t length = 3; length <= codes.size(); length++) {
+          counts[std::vector<unsigned int>(codes.begin(), codes.begin() + length)]++;
+        }
+      }
+
+      typedef std::pair<std::size_t, const std::vector<unsigned int>*> Frequency_t;
+      std::vector<Frequency_t> frequent;
+      for (auto& count : counts) {
+        frequent.emplace_back(count.second, &count.first);
+      }
+      std::stable_sort(frequent.begin(), frequent.end(), [](const Frequency_t& a, const Frequency_t& b) { return a.first > b.first; });
+
+      for (std::size_t i = 0; i < std::min(frequentPrefixes, frequent.size()) && this->m_prefixes->fits(0); i++) {
+        file(*frequent[i].second);
+      }
+      return this->m_prefixes->size();
+    }
+
+    // repacks the node storage once the insertions are done (no-op for the pointer layout)
+    void shrinkToFit()
+    {
+      m_nodes.shrinkToFit();
+      touch();
+    }
+
+    MemoryUsage_t memoryUsage() const
+    {
+      MemoryUsage_t usage = m_nodes.memoryUsage();
+      usage.nodeBytes += m_activeNodeSet.capacity() * sizeof(ActiveNode_t);
+      if (m_deletions) {
+        usage.indexBytes = m_deletions->memoryUsage();
+      }
+      if (m_prefixes) {
+        usage.indexBytes += m_prefixes->memoryUsage();
+      }
+      return usage;
     }
   };
+
+  typedef BasicTrie_t<PointerNodeStore_t> Trie_t; // one heap node per character, children on a std::map
+  typedef BasicTrie_t<ArenaNodeStore_t> ArenaTrie_t; // contiguous nodes addressed by 32-bit ids, children on sorted arrays
+  typedef BasicTrie_t<MappedNodeStore_t> MappedTrie_t; // read-only, answers straight from a mapped index file
+  typedef BasicTrie_t<RadixNodeStore_t> RadixTrie_t; // the single-child chains of characters collapsed on labeled edges
+  typedef BasicTrie_t<DawgNodeStore_t> FrozenTrie_t; // read-only, the minimized automaton of the words (see `freeze`)
 }
 #endif
@@ -0,0 +1,62 @@
+#ifndef _ZYNTHETIC_UTF8_
+#define _ZYNTHETIC_UTF8_
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace trie {
+
+  /*
+  ** Decodes the UTF-8 character at `current` and moves past it. It keeps no state besides the arguments, so unlike
+  ** `mbsrtowcs` it does not depend on the process locale and can run on any thread.
+  ** A byte which does not start a valid sequence (stray continuation, overlong form, surrogate...) is taken as a Latin-1
+  ** character, so text in the legacy encoding still maps.
+  */
+  inline uint32_t nextCodePoint(const unsigned char*& current, const unsigned char* end)
+  {
+    uint32_t lead = *current;
+
+    if (lead < 0x80) {
+      current++;
+      return lead;
+    }
+
+    std::size_t length = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 0;
+    uint32_t codePoint = lead & (0x7F >> length);
+    bool valid = length != 0 && length <= static_cast<std::size_t>(end - current) && lead < 0xF5;
+
+    for (std::size_t i = 1; valid && i < length; i++) {
+      valid = (current[i] & 0xC0) == 0x80;
+      codePoint = (codePoint << 6) | (current[i] & 0x3F);
+    }
+
+    static const uint32_t shortest[5] = { 0, 0, 0x80, 0x800, 0x10000 }; // lowest code point of each length, below it is overlong
+    valid = valid && codePoint >= shortest[length] && codePoint <= 0x10FFFF && (codePoint < 0xD800 || codePoint > 0xDFFF);
+
+    if (valid) {
+      current += length;
+      return codePoint;
+    }
+    current++;
+    return lead;
+  }
+
+  // fn(uint32_t codePoint) for every character of an UTF-8 string (see `nextCodePoint`)
+  template <typename Fn>
+  void forEachCodePoint(const char* data, std::size_t size, Fn fn)
+  {
+    const unsigned char* current = reinterpret_cast<const unsigned char*>(data);
+    const unsigned char* end = current + size;
+
+    while (current != end) {
+      fn(nextCodePoint(current, end));
+    }
+  }
+
+  template <typename Fn>
+  void forEachCodePoint(const std::string& str, Fn fn)
+  {
+    forEachCodePoint(str.data(), str.size(), fn);
+  }
+}
+#endif
@@ -0,0 +1,171 @@
+#ifndef _ZYNTHETIC_VERSIONED_TRIE_
+#define _ZYNTHETIC_VERSIONED_TRIE_
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "trie.hpp"
+
+namespace trie {
+
+  // a change given to `BasicVersionedTrie_t::apply`
+  struct TrieEdit_t {
+    enum Kind_t {
+      kInsert, // adds `content` to the word (`putIndividualWord`)
+      kUpdate, // leaves `content` as the only value of the word (`updateWord`)
+      kRemoveValue, // removes `content` from the word (`removeValue`)
+      kRemoveWord // removes the word with every value (`removeWord`)
+    };
+
+    Kind_t kind;
+    std::string word;
+    std::string content;
+    unsigned int score;
+
+    TrieEdit_t(Kind_t _kind, std::string _word, std::string _content = std::string(), unsigned int _score = 0)
+    : kind(_kind)
+    , word(std::move(_word))
+    , content(std::move(_content))
+    , score(_score)
+    {
+    }
+  };
+
+  /*
+  ** A trie which can be edited while it answers queries. Readers take the current version with `snapshot` and query it
+  ** without any lock, for as long as they hold it; writers go through `apply`, one at a time, and never wait for them.
+  **
+  ** Two copies of the trie usually take turns (left-right) : the writer edits the copy nobody reads, publishes it as the new
+  ** version, then keeps the edits to replay them on the previous version for the next writer. So an edit costs two passes
+  ** over its words instead of a copy of the trie. When a reader still holds the previous version, the writer copies the
+  ** current one instead and leaves the previous one to its readers, the last of them freeing it (RCU) : the memory is one
+  ** trie per version still held, two once the snapshots are released.
+  */
+  template <typename Storage>
+  class BasicVersionedTrie_t {
+  public:
+    typedef BasicTrie_t<Storage> Trie_t;
+
+  private:
+    std::shared_ptr<const Trie_t> m_current; // the published version, only accessed through std::atomic_load / std::atomic_exchange
+    std::shared_ptr<Trie_t> m_published; // the writer's handle on the current version
+    std::shared_ptr<Trie_t> m_standby; // the previous version, `m_replay` behind the current one
+    std::vector<TrieEdit_t> m_replay;
+    std::mutex m_writeLock;
+    std::atomic<uint64_t> m_version;
+
+    // whether the standby copy can be edited, no snapshot of it being left
+    bool standbyFree() const
+    {
+      // a snapshot is only taken from m_current, so a count of 1 cannot grow back; the fence orders the reads of the
+      // last reader (released when it dropped its handle) before the edits
+      if (m_standby.use_count() != 1) {
+        return false;
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      return true;
+    }
+
+    static void applyEdit(Trie_t& trie, const TrieEdit_t& edit)
+    {
+      switch (edit.kind) {
+        case TrieEdit_t::kInsert:
+          trie.putIndividualWord(edit.word, edit.content, edit.score);
+          break;
+        case TrieEdit_t::kUpdate:
+          trie.updateWord(edit.word, edit.content, edit.score);
+          break;
+        case TrieEdit_t::kRemoveValue:
+          trie.removeValue(edit.word, edit.content);
+          break;
+        case TrieEdit_t::kRemoveWord:
+          trie.removeWord(edit.word);
+          break;
+      }
+    }
+
+  public:
+    // the first version, the second copy is made from it
+    explicit BasicVersionedTrie_t(std::unique_ptr<Trie_t> trie)
+    : m_version(0)
+    {
+      if (!trie) {
+        throw std::logic_error("a versioned trie needs a trie to start from");
+      }
+
+      m_standby.reset(new Trie_t(*trie));
+      m_published = std::move(trie);
+      m_current = m_published;
+    }
+
+    BasicVersionedTrie_t(const BasicVersionedTrie_t&) = delete;
+    BasicVersionedTrie_t& operator=(const BasicVersionedTrie_t&) = delete;
+
+    // the current version, which stays valid (and unchanged) while it is held
+    std::shared_ptr<const Trie_t> snapshot() const
+    {
+      return std::atomic_load(&m_current);
+    }
+
+    // number of batches published so far
+    uint64_t version() const
+    {
+      return m_version.load(std::memory_order_acquire);
+    }
+
+    // applies the edits in order and publishes the result as a single version, returns its number
+    uint64_t apply(const std::vector<TrieEdit_t>& edits)
+    {
+      std::lock_guard<std::mutex> guard(m_writeLock);
+      std::shared_ptr<Trie_t> next;
+
+      if (standbyFree()) {
+        next = std::move(m_standby);
+        for (const TrieEdit_t& edit : m_replay) {
+          applyEdit(*next, edit);
+        }
+      } else {
+        m_standby.reset(); // its readers free it
+        next.reset(new Trie_t(*m_published));
+      }
+      for (const TrieEdit_t& edit : edits) {
+        applyEdit(*next, edit);
+      }
+
+      std::atomic_exchange(&m_current, std::shared_ptr<const Trie_t>(next));
+      m_standby = std::move(m_published);
+      m_published = std::move(next);
+      m_replay = edits;
+
+      return m_version.fetch_add(1, std::memory_order_acq_rel) + 1;
+    }
+
+    uint64_t insert(const std::string& word, const std::string& content, unsigned int score = 0)
+    {
+      return apply({ TrieEdit_t(TrieEdit_t::kInsert, word, content, score) });
+    }
+
+    uint64_t updateWord(const std::string& word, const std::string& content, unsigned int score = 0)
+    {
+      return apply({ TrieEdit_t(TrieEdit_t::kUpdate, word, content, score) });
+    }
+
+    uint64_t removeValue(const std::string& word, const std::string& content)
+    {
+      return apply({ TrieEdit_t(TrieEdit_t::kRemoveValue, word, content) });
+    }
+
+    uint64_t removeWord(const std::string& word)
+    {
+      return apply({ TrieEdit_t(TrieEdit_t::kRemoveWord, word) });
+    }
+  };
+
+  typedef BasicVersionedTrie_t<PointerNodeStore_t> VersionedTrie_t;
+  typedef BasicVersionedTrie_t<ArenaNodeStore_t> ArenaVersionedTrie_t;
+  typedef BasicVersionedTrie_t<RadixNodeStore_t> RadixVersionedTrie_t;
+}
+#endif